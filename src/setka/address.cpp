@@ -26,275 +26,160 @@ SOFTWARE.
 
 #include "address.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <limits>
 
-#include <utki/config.hpp>
-#include <utki/span.hpp>
-#include <utki/string.hpp>
-
-#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX
-#	include <arpa/inet.h>
-#elif CFG_OS == CFG_OS_WINDOWS
-#	include <Ws2tcpip.h>
-#else
-#	error "Unknown OS"
-#endif
-
-#ifdef max
-#	undef max
-#endif
+#include <utki/debug.hpp>
 
 using namespace setka;
 
 namespace {
-bool is_ip_v4_string(const char* str)
-{
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	for (const char* p = str; *p != 0; ++p) {
-		if (*p == '.') {
-			return true;
-		}
-		if (*p == ':') {
-			return false;
-		}
-	}
-	return false;
-}
-} // namespace
-
-address::ip address::ip::parse(const char* str)
-{
-	if (is_ip_v4_string(str)) {
-		return ip::parse_v4(str);
-	} else {
-		return ip::parse_v6(str);
-	}
-}
-
-address::ip address::ip::parse_v4(const char* str)
-{
-	sockaddr_in a{};
-
-#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS
-	int res = inet_pton(AF_INET, str, &a.sin_addr);
-
-	if (res != 1) {
-		throw std::runtime_error("bad IP address format");
-	}
-
-#else
-#	error "Unknown OS"
-#endif
+using namespace setka::detail;
 
-	return {ntohl(a.sin_addr.s_addr)};
-}
-
-address::ip address::ip::parse_v6(const char* str)
+template <size_t capacity>
+class chars_buffer
 {
-#if CFG_OS == CFG_OS_WINDOWS
-	sockaddr_in6 aa{};
-	in6_addr& a = aa.sin6_addr;
-#else
-	in6_addr a{};
-#endif
-
-#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS
-	int res = inet_pton(AF_INET6, str, &a);
-
-	if (res != 1) {
-		throw std::runtime_error("bad IP address format");
+	std::array<char, capacity> chars;
+	size_t size = 0;
+
+public:
+	void push(char c) noexcept
+	{
+		ASSERT(this->size < this->chars.size())
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		this->chars[this->size] = c;
+		++this->size;
 	}
 
-#else
-#	error "Unknown OS"
-#endif
-
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
-	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
-	return {
-		a.s6_addr[0],
-		a.s6_addr[1],
-		a.s6_addr[2],
-		a.s6_addr[3],
-		a.s6_addr[4],
-		a.s6_addr[5], // NOLINT
-		a.s6_addr[6], // NOLINT
-		a.s6_addr[7], // NOLINT
-		a.s6_addr[8], // NOLINT
-		a.s6_addr[9], // NOLINT
-		a.s6_addr[10], // NOLINT
-		a.s6_addr[11], // NOLINT
-		a.s6_addr[12], // NOLINT
-		a.s6_addr[13], // NOLINT
-		a.s6_addr[14], // NOLINT
-		a.s6_addr[15] // NOLINT
-	};
-#else
-	return {
-		a.__in6_u.__u6_addr8[0], // NOLINT
-		a.__in6_u.__u6_addr8[1], // NOLINT
-		a.__in6_u.__u6_addr8[2], // NOLINT
-		a.__in6_u.__u6_addr8[3], // NOLINT
-		a.__in6_u.__u6_addr8[4], // NOLINT
-		a.__in6_u.__u6_addr8[5], // NOLINT
-		a.__in6_u.__u6_addr8[6], // NOLINT
-		a.__in6_u.__u6_addr8[7], // NOLINT
-		a.__in6_u.__u6_addr8[8], // NOLINT
-		a.__in6_u.__u6_addr8[9], // NOLINT
-		a.__in6_u.__u6_addr8[10], // NOLINT
-		a.__in6_u.__u6_addr8[11], // NOLINT
-		a.__in6_u.__u6_addr8[12], // NOLINT
-		a.__in6_u.__u6_addr8[13], // NOLINT
-		a.__in6_u.__u6_addr8[14], // NOLINT
-		a.__in6_u.__u6_addr8[15] // NOLINT
-	};
-#endif
-}
-
-address::address(const char* host_str, uint16_t p) :
-	host(address::ip::parse(host_str)),
-	port(p)
-{}
-
-address::address(const char* str)
-{
-	if (*str == 0) { // if zero length string
-		throw std::runtime_error("bad IP address format");
+	void push_dec(uint32_t value) noexcept
+	{
+		std::array<char, std::numeric_limits<uint32_t>::digits10 + 1> digits{};
+		size_t n = 0;
+		do {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			digits[n] = char('0' + value % decimal_base);
+			++n;
+			value /= decimal_base;
+		} while (value != 0);
+
+		while (n != 0) {
+			--n;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			this->push(digits[n]);
+		}
 	}
 
-	if (*str == '[') { // IPv6 with port
-		// NOLINTNEXTLINE
-		std::array<char, (4 * 6 + 6 + (3 * 4 + 3) + 1)> buf;
-
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		++str;
-
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
-		char* dst = nullptr;
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		for (dst = buf.data(); *str != ']'; ++dst, ++str) {
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			if (*str == 0 || !utki::overlaps(utki::make_span(buf), dst + 1)) {
-				throw std::runtime_error("bad IP address format");
+	// writes hexadecimal number without leading zeros
+	void push_hex(uint16_t value) noexcept
+	{
+		constexpr std::string_view hex_digits = "0123456789abcdef";
+		bool started = false;
+		for (unsigned shift = hex_digit_bits * (max_ip_v6_part_digits - 1);; shift -= hex_digit_bits) {
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			unsigned d = (value >> shift) & 0xf;
+			if (d != 0 || started || shift == 0) {
+				this->push(hex_digits[d]);
+				started = true;
+			}
+			if (shift == 0) {
+				break;
 			}
-
-			*dst = *str;
 		}
+	}
 
-		ASSERT(utki::overlaps(utki::make_span(buf), dst))
-		*dst = 0; // null-terminate
-
-		this->host = ip::parse_v6(buf.data());
-
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		++str; // move to port ':' separator
-	} else {
-		// IPv4 or IPv6 without port
-
-		if (is_ip_v4_string(str)) {
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
-			std::array<char, (3 * 4 + 3 + 1)> buf;
-
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
-			char* dst = nullptr;
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			for (dst = buf.data(); *str != ':' && *str != 0; ++dst, ++str) {
-				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-				if (!utki::overlaps(utki::make_span(buf), dst + 1)) {
-					throw std::runtime_error("bad IP address format");
+	void push_ip(const address::ip& ip) noexcept
+	{
+		if (ip.is_v4()) {
+			for (unsigned i = num_ip_v4_parts;;) {
+				--i;
+				this->push_dec((ip.get_v4() >> (utki::byte_bits * i)) & utki::byte_mask);
+				if (i == 0) {
+					break;
 				}
-
-				*dst = *str;
+				this->push('.');
 			}
-
-			ASSERT(utki::overlaps(utki::make_span(buf), dst))
-			*dst = 0; // null-terminate
-
-			this->host = ip::parse_v4(buf.data());
-		} else {
-			// IPv6 without port
-			this->host = ip::parse_v6(str);
-			this->port = 0;
 			return;
 		}
-	}
 
-	// parse port
-
-	if (*str != ':') {
-		if (*str == 0) {
-			this->port = 0;
-			return;
-		} else {
-			//		TRACE(<< "no colon, *ip = " << (*ip) << std::endl)
-			throw std::runtime_error("bad IP address format");
+		std::array<uint16_t, num_ip_v6_parts> parts{};
+		for (size_t i = 0; i != parts.size(); ++i) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			parts[i] = uint16_t((ip.quad[i / 2] >> (i % 2 == 0 ? utki::byte_bits * 2 : 0)) & ip_v6_part_mask);
 		}
-	}
-
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	++str;
 
-	constexpr auto max_port_digits = 5;
-
-	// move to the end of port number, maximum 5 digits.
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	for (unsigned i = 0; '0' <= *str && *str <= '9' && i < max_port_digits; ++i, ++str) {
-	}
-	if ('0' <= *str && *str <= '9') { // if still have one more digit
-		//		TRACE(<< "still have one more digit" << std::endl)
-		throw std::runtime_error("bad IP address format");
-	}
-
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	--str;
-
-	uint32_t port = 0;
-
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	for (unsigned i = 0; *str != ':'; ++i, --str) {
-		uint32_t pow = 1;
-		for (unsigned j = 0; j < i; ++j) {
-			pow *= utki::to_int(utki::integer_base::dec);
+		// find the longest run of zero parts, RFC 5952 requires it to be at least 2 parts long
+		// and if there are several runs of the same length, the first one is compressed
+		size_t gap_begin = parts.size();
+		size_t gap_size = 1;
+		for (size_t i = 0; i != parts.size();) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (parts[i] != 0) {
+				++i;
+				continue;
+			}
+			size_t begin = i;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			for (; i != parts.size() && parts[i] == 0; ++i) {
+			}
+			if (i - begin > gap_size) {
+				gap_begin = begin;
+				gap_size = i - begin;
+			}
 		}
 
-		ASSERT('0' <= *str && *str <= '9')
-
-		port += (*str - '0') * pow;
+		for (size_t i = 0; i != parts.size();) {
+			if (i == gap_begin) {
+				this->push(':');
+				this->push(':');
+				i += gap_size;
+				continue;
+			}
+			if (i != 0 && i != gap_begin + gap_size) {
+				this->push(':');
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			this->push_hex(parts[i]);
+			++i;
+		}
 	}
 
-	if (port > std::numeric_limits<uint16_t>::max()) {
-		//		TRACE(<< "port number is bigger than 0xffff" << std::endl)
-		throw std::runtime_error("bad IP address format");
+	std::to_chars_result copy_to(char* first, char* last) const noexcept
+	{
+		if (size_t(last - first) < this->size) {
+			return {last, std::errc::value_too_large};
+		}
+		return {std::copy_n(this->chars.data(), this->size, first), std::errc()};
 	}
+};
+} // namespace
 
-	this->port = uint16_t(port);
+std::to_chars_result address::ip::to_chars(char* first, char* last) const noexcept
+{
+	chars_buffer<ip::max_chars> buf;
+	buf.push_ip(*this);
+	return buf.copy_to(first, last);
 }
 
 std::string address::ip::to_string() const
 {
-	std::stringstream ss;
-	if (this->is_v4()) {
-		for (unsigned i = 4;;) {
-			--i;
-			ss << (((this->get_v4()) >> (utki::byte_bits * i)) & utki::byte_mask);
-			if (i == 0) {
-				break;
-			}
-			ss << '.';
-		}
-	} else {
-		constexpr auto num_ip_v6_parts = 8;
+	std::array<char, max_chars> buf{};
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto res = this->to_chars(buf.data(), buf.data() + buf.size());
+	ASSERT(res.ec == std::errc())
+	return {buf.data(), res.ptr};
+}
 
-		ss << std::hex;
-		for (unsigned i = num_ip_v6_parts;;) {
-			--i;
-			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers, cppcoreguidelines-pro-bounds-constant-array-index)
-			ss << ((this->quad[(i * 2) / 4] >> (16 * (i % 2))) & 0xffff);
-			if (i == 0) {
-				break;
-			}
-			ss << ':';
-		}
+std::to_chars_result address::to_chars(char* first, char* last) const noexcept
+{
+	chars_buffer<address::max_chars> buf;
+	if (this->host.is_v4()) {
+		buf.push_ip(this->host);
+	} else {
+		buf.push('[');
+		buf.push_ip(this->host);
+		buf.push(']');
 	}
-	return ss.str();
+	buf.push(':');
+	buf.push_dec(this->port);
+	return buf.copy_to(first, last);
 }
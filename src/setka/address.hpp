@@ -27,8 +27,13 @@ SOFTWARE.
 #pragma once
 
 #include <array>
+#include <charconv>
 #include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include <utki/config.hpp>
 #include <utki/types.hpp>
@@ -55,12 +60,12 @@ public:
 		 * For example, if address is 1234:5678:9345:4243:2222:3333:1111:2342, then
 		 * quad[0] = 0x12345678, quad[1] = 0x93454243, quad[2] = 0x22223333, quad[3] = 0x11112342.
 		 */
-		std::array<uint32_t, 4> quad;
+		std::array<uint32_t, 4> quad{};
 
 		/**
-		 * @brief Creates an undefined ip object.
+		 * @brief Creates an all zeroes ip object.
 		 */
-		ip() noexcept = default;
+		constexpr ip() noexcept = default;
 
 		/**
 		 * @brief Creates a ip object using given IPv6 quads.
@@ -70,7 +75,7 @@ public:
 		 * @param q2 - second quad.
 		 * @param q3 - third quad.
 		 */
-		ip(uint32_t q0, uint32_t q1, uint32_t q2, uint32_t q3) :
+		constexpr ip(uint32_t q0, uint32_t q1, uint32_t q2, uint32_t q3) noexcept :
 			quad({
 				{q0, q1, q2, q3}
         })
@@ -81,7 +86,7 @@ public:
 		 * Construct and initialize the object to an IPv6 mapped IPv4 address.
 		 * @param h - IPv4 host to use for initialization.
 		 */
-		ip(uint32_t h) :
+		constexpr ip(uint32_t h) noexcept :
 			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
 			ip(0, 0, 0xffff, h)
 		{}
@@ -98,7 +103,16 @@ public:
 		 * @param a6 - sixth number.
 		 * @param a7 - sevens number.
 		 */
-		ip(uint16_t a0, uint16_t a1, uint16_t a2, uint16_t a3, uint16_t a4, uint16_t a5, uint16_t a6, uint16_t a7) :
+		constexpr ip(
+			uint16_t a0,
+			uint16_t a1,
+			uint16_t a2,
+			uint16_t a3,
+			uint16_t a4,
+			uint16_t a5,
+			uint16_t a6,
+			uint16_t a7
+		) noexcept :
 			ip((uint32_t(a0) << (utki::byte_bits * 2)) | uint32_t(a1),
 			   (uint32_t(a2) << (utki::byte_bits * 2)) | uint32_t(a3),
 			   (uint32_t(a4) << (utki::byte_bits * 2)) | uint32_t(a5),
@@ -125,22 +139,24 @@ public:
 		 * @param a14 - 14th byte of the IPv6 address.
 		 * @param a15 - 15th byte of the IPv6 address.
 		 */
-		ip(uint8_t a0,
-		   uint8_t a1,
-		   uint8_t a2,
-		   uint8_t a3,
-		   uint8_t a4,
-		   uint8_t a5,
-		   uint8_t a6,
-		   uint8_t a7,
-		   uint8_t a8,
-		   uint8_t a9,
-		   uint8_t a10,
-		   uint8_t a11,
-		   uint8_t a12,
-		   uint8_t a13,
-		   uint8_t a14,
-		   uint8_t a15) :
+		constexpr ip(
+			uint8_t a0,
+			uint8_t a1,
+			uint8_t a2,
+			uint8_t a3,
+			uint8_t a4,
+			uint8_t a5,
+			uint8_t a6,
+			uint8_t a7,
+			uint8_t a8,
+			uint8_t a9,
+			uint8_t a10,
+			uint8_t a11,
+			uint8_t a12,
+			uint8_t a13,
+			uint8_t a14,
+			uint8_t a15
+		) noexcept :
 			ip((uint16_t(a0) << utki::byte_bits) | uint16_t(a1),
 			   (uint16_t(a2) << utki::byte_bits) | uint16_t(a3),
 			   (uint16_t(a4) << utki::byte_bits) | uint16_t(a5),
@@ -151,6 +167,12 @@ public:
 			   (uint16_t(a14) << utki::byte_bits) | uint16_t(a15))
 		{}
 
+		/**
+		 * @brief Maximum number of characters written by to_chars().
+		 * It is the length of the fully expanded IPv6 address, e.g. "1234:5678:9abc:def0:1234:5678:9abc:def0".
+		 */
+		constexpr static size_t max_chars = 39;
+
 		/**
 		 * @brief Parse IP address from string.
 		 * String may contain either IPv4 or IPv6 address.
@@ -158,7 +180,7 @@ public:
 		 * @return ip object initialized to a parsed address.
 		 * @throw std::runtime_error if string does not contain well formed IPv4 or IPv6 address.
 		 */
-		static ip parse(const char* str);
+		constexpr static ip parse(std::string_view str);
 
 		/**
 		 * @brief Parse IPv4 from string.
@@ -167,23 +189,37 @@ public:
 		 * @return ip object initialized to a parsed address.
 		 * @throw std::runtime_error if string does not contain well formed IPv4 address.
 		 */
-		static ip parse_v4(const char* str);
+		constexpr static ip parse_v4(std::string_view str);
 
 		/**
 		 * @brief Parse IPv6 from string.
 		 * String may contain only IPv6 address.
-		 * @param ip - string containing IPv6 address.
+		 * @param str - string containing IPv6 address.
 		 * @return ip object initialized to a parsed address.
 		 * @throw std::runtime_error if string does not contain well formed IPv6 address.
 		 */
-		static ip parse_v6(const char* ip);
+		constexpr static ip parse_v6(std::string_view str);
+
+		/**
+		 * @brief Parse IP address from characters sequence.
+		 * Works similarly to std::from_chars(). The sequence must start with either IPv4 address in
+		 * dotted-decimal notation or IPv6 address in any of RFC 4291 text forms.
+		 * Parsing stops at the first character which is not a part of the address.
+		 * Does not throw and does not allocate memory. Can be evaluated at compile time.
+		 * @param first - beginning of the characters sequence.
+		 * @param last - end of the characters sequence.
+		 * @param value - ip object to store the parsed address to. Left unchanged in case of error.
+		 * @return ptr pointing to the first character not matching the address and default value of ec, on success.
+		 * @return first as ptr and std::errc::invalid_argument as ec, in case the address is malformed.
+		 */
+		constexpr static std::from_chars_result from_chars(const char* first, const char* last, ip& value) noexcept;
 
 		/**
 		 * @brief Check if it is a IPv4 mapped to IPv6.
 		 * @return true if this ip object holds IPv4 address mapped to IPv6.
 		 * @return false otherwise.
 		 */
-		bool is_v4() const noexcept
+		constexpr bool is_v4() const noexcept
 		{
 			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
 			return this->quad[2] == 0xffff && this->quad[1] == 0 && this->quad[0] == 0;
@@ -194,7 +230,7 @@ public:
 		 * @return IPv4 host if this is a IPv4 mapped to IPv6.
 		 * @return undefined value otherwise.
 		 */
-		uint32_t get_v4() const noexcept
+		constexpr uint32_t get_v4() const noexcept
 		{
 			return this->quad[3];
 		}
@@ -205,7 +241,7 @@ public:
 		 * @return true if this IP address is not a zero address.
 		 * @return false if this IP address is all zeroes.
 		 */
-		bool is_valid() const noexcept
+		constexpr bool is_valid() const noexcept
 		{
 			if (this->is_v4()) {
 				return this->get_v4() != 0;
@@ -220,14 +256,141 @@ public:
 		 * @return true if two IP addresses are identical.
 		 * @return false otherwise.
 		 */
-		bool operator==(const ip& h)
+		constexpr bool operator==(const ip& h) const noexcept
+		{
+			// std::array::operator==() is not constexpr in C++17
+			return this->quad[0] == h.quad[0] && this->quad[1] == h.quad[1] && this->quad[2] == h.quad[2] &&
+				this->quad[3] == h.quad[3];
+		}
+
+		constexpr bool operator!=(const ip& h) const noexcept
 		{
-			return this->quad == h.quad;
+			return !this->operator==(h);
 		}
 
+		/**
+		 * @brief Compare two IP host addresses.
+		 * Addresses are ordered as 128-bit unsigned numbers, so IPv4 addresses, being mapped to IPv6,
+		 * are ordered the same way as 32-bit IPv4 numbers, and a subnet is a contiguous range.
+		 * @param h - IP host address to compare this IP host address to.
+		 * @return true if this IP address is less than the given one.
+		 * @return false otherwise.
+		 */
+		constexpr bool operator<(const ip& h) const noexcept
+		{
+			for (size_t i = 0; i != this->quad.size(); ++i) {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+				if (this->quad[i] != h.quad[i]) {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+					return this->quad[i] < h.quad[i];
+				}
+			}
+			return false;
+		}
+
+		constexpr bool operator>(const ip& h) const noexcept
+		{
+			return h.operator<(*this);
+		}
+
+		constexpr bool operator<=(const ip& h) const noexcept
+		{
+			return !h.operator<(*this);
+		}
+
+		constexpr bool operator>=(const ip& h) const noexcept
+		{
+			return !this->operator<(h);
+		}
+
+		/**
+		 * @brief Check if this is an unspecified address.
+		 * @return true if this IP address is "::" or "0.0.0.0".
+		 * @return false otherwise.
+		 */
+		constexpr bool is_unspecified() const noexcept
+		{
+			return !this->is_valid();
+		}
+
+		/**
+		 * @brief Check if this is a loopback address.
+		 * @return true if this IP address is "::1" or belongs to 127.0.0.0/8 subnet.
+		 * @return false otherwise.
+		 */
+		constexpr bool is_loopback() const noexcept
+		{
+			if (this->is_v4()) {
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				return (this->get_v4() >> (utki::byte_bits * 3)) == 127;
+			}
+			return *this == ip(0, 0, 0, 1);
+		}
+
+		/**
+		 * @brief Check if this is a multicast address.
+		 * @return true if this IP address belongs to ff00::/8 or 224.0.0.0/4 subnet.
+		 * @return false otherwise.
+		 */
+		constexpr bool is_multicast() const noexcept
+		{
+			if (this->is_v4()) {
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				return (this->get_v4() >> 28) == 0xe;
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			return (this->quad[0] >> (utki::byte_bits * 3)) == 0xff;
+		}
+
+		/**
+		 * @brief Check if this is a link-local address.
+		 * @return true if this IP address belongs to fe80::/10 or 169.254.0.0/16 subnet.
+		 * @return false otherwise.
+		 */
+		constexpr bool is_link_local() const noexcept
+		{
+			if (this->is_v4()) {
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				return (this->get_v4() >> (utki::byte_bits * 2)) == 0xa9fe;
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			return (this->quad[0] >> 22) == (0xfe80 >> 6);
+		}
+
+		/**
+		 * @brief Check if this is a private network address.
+		 * @return true if this IP address belongs to one of the RFC 1918 subnets 10.0.0.0/8, 172.16.0.0/12,
+		 *         192.168.0.0/16, or to the RFC 4193 unique local subnet fc00::/7.
+		 * @return false otherwise.
+		 */
+		constexpr bool is_private() const noexcept
+		{
+			if (this->is_v4()) {
+				auto h = this->get_v4();
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				return (h >> 24) == 10 || (h >> 20) == 0xac1 || (h >> 16) == 0xc0a8;
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			return (this->quad[0] >> 25) == (0xfc >> 1);
+		}
+
+		/**
+		 * @brief Write this IP host address to characters buffer.
+		 * Works similarly to std::to_chars(). IPv4 address is written in dotted-decimal notation,
+		 * IPv6 address is written in RFC 5952 canonical form, i.e. lowercase hexadecimal digits
+		 * without leading zeros and with the longest run of zero groups compressed to "::".
+		 * No more than max_chars characters is written. The string is not null-terminated.
+		 * Does not throw and does not allocate memory.
+		 * @param first - beginning of the buffer.
+		 * @param last - end of the buffer.
+		 * @return pointer past the last written character as ptr and default value of ec, on success.
+		 * @return last as ptr and std::errc::value_too_large as ec, if the buffer is too small.
+		 */
+		std::to_chars_result to_chars(char* first, char* last) const noexcept;
+
 		/**
 		 * @brief Convert this IP host address to string.
-		 * @return String representing an IP host address.
+		 * @return String representing an IP host address, see to_chars().
 		 */
 		std::string to_string() const;
 	};
@@ -235,17 +398,24 @@ public:
 	ip host{}; ///< IPv6 address
 	uint16_t port = 0; ///< IP port number
 
+	/**
+	 * @brief Maximum number of characters written by to_chars().
+	 * It is the length of IPv6 address with port, e.g. "[1234:5678:9abc:def0:1234:5678:9abc:def0]:65535".
+	 */
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	constexpr static size_t max_chars = ip::max_chars + 8;
+
 	/**
 	 * @brief Construct IP address with undefined host and port.
 	 */
-	address() noexcept = default;
+	constexpr address() noexcept = default;
 
 	/**
 	 * @brief Create IPv4-address specifying exact IP-address and port number.
 	 * @param h - IPv4 address. For example, 0x7f000001 represents "127.0.0.1" IP address value.
 	 * @param p - IP port number.
 	 */
-	address(uint32_t h, uint16_t p) noexcept :
+	constexpr address(uint32_t h, uint16_t p) noexcept :
 		host(h),
 		port(p)
 	{}
@@ -262,7 +432,7 @@ public:
 	 * @param h4 - 4th triplet of IPv4 address.
 	 * @param p - IP port number.
 	 */
-	address(uint8_t h1, uint8_t h2, uint8_t h3, uint8_t h4, uint16_t p) noexcept :
+	constexpr address(uint8_t h1, uint8_t h2, uint8_t h3, uint8_t h4, uint16_t p) noexcept :
 		host(
 			(uint32_t(h1) << (utki::byte_bits * 3)) | (uint32_t(h2) << (utki::byte_bits * 2)) |
 			(uint32_t(h3) << utki::byte_bits) | uint32_t(h4)
@@ -275,7 +445,7 @@ public:
 	 * @param h - host to use for construction.
 	 * @param p - port to use for construction.
 	 */
-	address(ip h, uint16_t p) noexcept :
+	constexpr address(ip h, uint16_t p) noexcept :
 		host(h),
 		port(p)
 	{}
@@ -283,22 +453,59 @@ public:
 	/**
 	 * @brief Create IP address specifying IP host address as string and port number.
 	 * The string passed as argument should contain properly formatted IPv4 or IPv6 host address.
-	 * @param host_str - IPv4 or IPv6 host address null-terminated string. Example: "127.0.0.1".
+	 * @param host_str - IPv4 or IPv6 host address string. Example: "127.0.0.1".
 	 * @param p - IP port number.
-	 * @throw Badip_addressFormatExc - when passed string does not contain properly formatted IP address.
+	 * @throw std::runtime_error - when passed string does not contain properly formatted IP address.
 	 */
-	address(const char* host_str, uint16_t p);
+	constexpr address(std::string_view host_str, uint16_t p);
+
+	constexpr address(const char* host_str, uint16_t p) :
+		address(std::string_view(host_str), p)
+	{}
 
 	/**
 	 * @brief Create IP address specifying IP host address and IP port as string.
 	 * The string passed for parsing should contain the IP host address with the port number.
 	 * If there is no port number specified after the IP-address the format of the IP-address
 	 * is regarded as invalid and corresponding exception is thrown.
-	 * @param str - null-terminated string representing IP address with port number, e.g. "127.0.0.1:80" or
+	 * @param str - string representing IP address with port number, e.g. "127.0.0.1:80" or
 	 * "[42f4:234a::23]:432".
-	 * @throw Badip_addressFormatExc - when passed string does not contain properly formatted IP-address.
+	 * @throw std::runtime_error - when passed string does not contain properly formatted IP-address.
 	 */
-	address(const char* str);
+	constexpr address(std::string_view str);
+
+	constexpr address(const char* str) :
+		address(std::string_view(str))
+	{}
+
+	/**
+	 * @brief Parse IP address with port from characters sequence.
+	 * Works similarly to std::from_chars(). Accepted forms are "127.0.0.1:80", "[42f4:234a::23]:432",
+	 * "127.0.0.1", "[42f4:234a::23]" and "42f4:234a::23". Missing port number is parsed as 0.
+	 * The port number can have at most 5 digits.
+	 * Does not throw and does not allocate memory. Can be evaluated at compile time.
+	 * @param first - beginning of the characters sequence.
+	 * @param last - end of the characters sequence.
+	 * @param value - address object to store the parsed address to. Left unchanged in case of error.
+	 * @return ptr pointing to the first character not matching the address and default value of ec, on success.
+	 * @return first as ptr and std::errc::invalid_argument as ec, in case the address is malformed.
+	 * @return ptr pointing past the port number and std::errc::result_out_of_range as ec,
+	 *         in case the port number does not fit into 16 bits.
+	 */
+	constexpr static std::from_chars_result from_chars(const char* first, const char* last, address& value) noexcept;
+
+	/**
+	 * @brief Write this IP address with port to characters buffer.
+	 * Works similarly to std::to_chars(). IPv4 address is written as "127.0.0.1:80",
+	 * IPv6 address is written as "[42f4:234a::23]:432", see ip::to_chars().
+	 * No more than max_chars characters is written. The string is not null-terminated.
+	 * Does not throw and does not allocate memory.
+	 * @param first - beginning of the buffer.
+	 * @param last - end of the buffer.
+	 * @return pointer past the last written character as ptr and default value of ec, on success.
+	 * @return last as ptr and std::errc::value_too_large as ec, if the buffer is too small.
+	 */
+	std::to_chars_result to_chars(char* first, char* last) const noexcept;
 
 	/**
 	 * @brief compares two IP addresses for equality.
@@ -306,9 +513,492 @@ public:
 	 * @return true if hosts and ports of the two IP addresses are equal accordingly.
 	 * @return false otherwise.
 	 */
-	bool operator==(const address& ip)
+	constexpr bool operator==(const address& ip) const noexcept
 	{
 		return this->host == ip.host && this->port == ip.port;
 	}
+
+	constexpr bool operator!=(const address& ip) const noexcept
+	{
+		return !this->operator==(ip);
+	}
+
+	/**
+	 * @brief Compare two IP addresses.
+	 * Addresses are ordered by host first and then by port.
+	 * @param ip - IP address to compare with.
+	 * @return true if this IP address is less than the given one.
+	 * @return false otherwise.
+	 */
+	constexpr bool operator<(const address& ip) const noexcept
+	{
+		if (this->host != ip.host) {
+			return this->host < ip.host;
+		}
+		return this->port < ip.port;
+	}
+
+	constexpr bool operator>(const address& ip) const noexcept
+	{
+		return ip.operator<(*this);
+	}
+
+	constexpr bool operator<=(const address& ip) const noexcept
+	{
+		return !ip.operator<(*this);
+	}
+
+	constexpr bool operator>=(const address& ip) const noexcept
+	{
+		return !this->operator<(ip);
+	}
+};
+
+namespace detail {
+
+constexpr auto num_ip_v4_parts = 4;
+constexpr auto num_ip_v6_parts = 8;
+constexpr auto max_ip_v4_part_digits = 3;
+constexpr auto max_ip_v6_part_digits = 4;
+constexpr auto max_port_digits = 5;
+constexpr auto decimal_base = 10;
+constexpr auto hex_digit_bits = 4;
+constexpr auto ip_v6_part_mask = 0xffff;
+
+struct parse_result {
+	size_t size; // number of parsed characters
+	std::errc ec;
+};
+
+constexpr bool is_digit(char c) noexcept
+{
+	return '0' <= c && c <= '9';
+}
+
+constexpr int hex_digit_value(char c) noexcept
+{
+	if (is_digit(c)) {
+		return c - '0';
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	if ('a' <= c && c <= 'f') {
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		return c - 'a' + 10;
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	if ('A' <= c && c <= 'F') {
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+// The address is IPv4 if its first non-hexadecimal character is '.'.
+constexpr bool is_ip_v4_string(std::string_view str) noexcept
+{
+	for (char c : str) {
+		if (hex_digit_value(c) < 0) {
+			return c == '.';
+		}
+	}
+	return false;
+}
+
+// Parses IPv4 address in dotted-decimal notation.
+// Same as inet_pton(), does not allow leading zeros in address parts.
+constexpr parse_result parse_ip_v4(std::string_view str, uint32_t& out) noexcept
+{
+	uint32_t value = 0;
+	size_t i = 0;
+
+	for (unsigned part = 0; part != num_ip_v4_parts; ++part) {
+		if (part != 0) {
+			if (i == str.size() || str[i] != '.') {
+				return {0, std::errc::invalid_argument};
+			}
+			++i;
+		}
+
+		size_t start = i;
+		uint32_t n = 0;
+		for (; i != str.size() && is_digit(str[i]); ++i) {
+			if (i - start == max_ip_v4_part_digits) {
+				return {0, std::errc::invalid_argument};
+			}
+			n = n * decimal_base + uint32_t(str[i] - '0');
+		}
+
+		if (i == start || n > utki::byte_mask || (str[start] == '0' && i - start != 1)) {
+			return {0, std::errc::invalid_argument};
+		}
+
+		value = (value << utki::byte_bits) | n;
+	}
+
+	out = value;
+	return {i, std::errc()};
+}
+
+// Parses IPv6 address in any of the RFC 4291 text forms,
+// i.e. full, compressed with "::" and with trailing IPv4 address.
+constexpr parse_result parse_ip_v6(std::string_view str, address::ip& out) noexcept
+{
+	std::array<uint16_t, num_ip_v6_parts> parts{};
+	size_t num_parts = 0;
+
+	constexpr auto no_gap = std::numeric_limits<size_t>::max();
+
+	// index of the part which goes right after "::"
+	size_t gap_part = no_gap;
+
+	// index of the character which goes right after "::"
+	size_t gap_end = no_gap;
+
+	size_t i = 0;
+
+	if (str.size() >= 2 && str[0] == ':' && str[1] == ':') {
+		gap_part = 0;
+		i = 2;
+		gap_end = i;
+	}
+
+	while (num_parts != num_ip_v6_parts) {
+		size_t start = i;
+		uint32_t n = 0;
+		for (; i != str.size(); ++i) {
+			int d = hex_digit_value(str[i]);
+			if (d < 0) {
+				break;
+			}
+			if (i - start == max_ip_v6_part_digits) {
+				return {0, std::errc::invalid_argument};
+			}
+			n = (n << hex_digit_bits) | uint32_t(d);
+		}
+
+		if (i == start) {
+			if (start == gap_end) {
+				// address ends with "::"
+				break;
+			}
+			return {0, std::errc::invalid_argument};
+		}
+
+		if (i != str.size() && str[i] == '.') {
+			// trailing IPv4 address
+			if (num_parts > num_ip_v6_parts - 2) {
+				return {0, std::errc::invalid_argument};
+			}
+
+			uint32_t v4 = 0;
+			auto res = parse_ip_v4(str.substr(start), v4);
+			if (res.ec != std::errc()) {
+				return {0, std::errc::invalid_argument};
+			}
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			parts[num_parts] = uint16_t(v4 >> (utki::byte_bits * 2));
+			++num_parts;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			parts[num_parts] = uint16_t(v4 & ip_v6_part_mask);
+			++num_parts;
+			i = start + res.size;
+			break;
+		}
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		parts[num_parts] = uint16_t(n);
+		++num_parts;
+
+		if (num_parts == num_ip_v6_parts) {
+			break;
+		}
+
+		if (i + 1 < str.size() && str[i] == ':' && str[i + 1] == ':') {
+			if (gap_part != no_gap) {
+				return {0, std::errc::invalid_argument};
+			}
+			gap_part = num_parts;
+			i += 2;
+			gap_end = i;
+		} else if (i != str.size() && str[i] == ':') {
+			++i;
+		} else {
+			break;
+		}
+	}
+
+	if (gap_part == no_gap) {
+		if (num_parts != num_ip_v6_parts) {
+			return {0, std::errc::invalid_argument};
+		}
+	} else {
+		// "::" stands for at least one zero part
+		if (num_parts == num_ip_v6_parts) {
+			return {0, std::errc::invalid_argument};
+		}
+
+		// move parts which go after "::" to the end,
+		// std::copy_backward() and std::fill() are not constexpr in C++17
+		auto gap_size = num_ip_v6_parts - num_parts;
+		for (size_t j = num_parts; j != gap_part;) {
+			--j;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			parts[j + gap_size] = parts[j];
+		}
+		for (size_t j = gap_part; j != gap_part + gap_size; ++j) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			parts[j] = 0;
+		}
+	}
+
+	out = address::ip(parts[0], parts[1], parts[2], parts[3], parts[4], parts[5], parts[6], parts[7]); // NOLINT
+	return {i, std::errc()};
+}
+
+constexpr parse_result parse_ip(std::string_view str, address::ip& out) noexcept
+{
+	if (is_ip_v4_string(str)) {
+		uint32_t v4 = 0;
+		auto res = parse_ip_v4(str, v4);
+		if (res.ec == std::errc()) {
+			out = address::ip(v4);
+		}
+		return res;
+	} else {
+		return parse_ip_v6(str, out);
+	}
+}
+
+// Parses port number of at most 5 digits. Empty port number is parsed as 0.
+constexpr parse_result parse_port(std::string_view str, uint16_t& out) noexcept
+{
+	uint32_t port = 0;
+	size_t i = 0;
+	for (; i != str.size() && is_digit(str[i]); ++i) {
+		if (i < max_port_digits) {
+			port = port * decimal_base + uint32_t(str[i] - '0');
+		}
+	}
+
+	if (i > max_port_digits || port > std::numeric_limits<uint16_t>::max()) {
+		return {i, std::errc::result_out_of_range};
+	}
+
+	out = uint16_t(port);
+	return {i, std::errc()};
+}
+
+struct address_parse_result {
+	parse_result res;
+	bool has_port;
 };
+
+constexpr address_parse_result parse_address(std::string_view str, address& out) noexcept
+{
+	address a;
+	size_t i = 0;
+
+	if (!str.empty() && str[0] == '[') {
+		// IPv6 with port
+		auto res = parse_ip_v6(str.substr(1), a.host);
+		if (res.ec != std::errc()) {
+			return {res, false};
+		}
+		i = 1 + res.size;
+
+		if (i == str.size() || str[i] != ']') {
+			return {
+				{0, std::errc::invalid_argument},
+				false
+			};
+		}
+		++i;
+	} else if (is_ip_v4_string(str)) {
+		auto res = parse_ip(str, a.host);
+		if (res.ec != std::errc()) {
+			return {res, false};
+		}
+		i = res.size;
+	} else {
+		// IPv6 without port
+		auto res = parse_ip_v6(str, a.host);
+		if (res.ec == std::errc()) {
+			out = a;
+		}
+		return {res, false};
+	}
+
+	if (i == str.size() || str[i] != ':') {
+		out = a;
+		return {
+			{i, std::errc()},
+			false
+		};
+	}
+	++i;
+
+	auto res = parse_port(str.substr(i), a.port);
+	if (res.ec == std::errc()) {
+		out = a;
+	}
+	return {
+		{i + res.size, res.ec},
+		true
+	};
+}
+
+// Mixes IPv6 address and the seed into a 64-bit hash value.
+// IPv4 addresses differ only in the lowest 64 bits and those are mixed by a bijective function,
+// so that distinct IPv4 addresses never collide before the hash value is truncated to the table size.
+constexpr uint64_t hash_ip(const address::ip& h, uint64_t seed) noexcept
+{
+	constexpr auto half_bits = 32;
+
+	uint64_t high = (uint64_t(h.quad[0]) << half_bits) | h.quad[1];
+	uint64_t low = (uint64_t(h.quad[2]) << half_bits) | h.quad[3];
+
+	// constants of the MurmurHash3 64-bit finalizer
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	uint64_t x = ((low ^ seed) * 0xff51afd7ed558ccdULL) ^ high;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	x ^= x >> 33;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	x ^= x >> 33;
+	return x;
+}
+
+} // namespace detail
+
+constexpr address::ip address::ip::parse(std::string_view str)
+{
+	ip ret;
+	auto res = detail::parse_ip(str, ret);
+	if (res.ec != std::errc() || res.size != str.size()) {
+		throw std::runtime_error("bad IP address format");
+	}
+	return ret;
+}
+
+constexpr address::ip address::ip::parse_v4(std::string_view str)
+{
+	uint32_t v4 = 0;
+	auto res = detail::parse_ip_v4(str, v4);
+	if (res.ec != std::errc() || res.size != str.size()) {
+		throw std::runtime_error("bad IP address format");
+	}
+	return {v4};
+}
+
+constexpr address::ip address::ip::parse_v6(std::string_view str)
+{
+	ip ret;
+	auto res = detail::parse_ip_v6(str, ret);
+	if (res.ec != std::errc() || res.size != str.size()) {
+		throw std::runtime_error("bad IP address format");
+	}
+	return ret;
+}
+
+constexpr std::from_chars_result address::ip::from_chars(const char* first, const char* last, ip& value) noexcept
+{
+	auto res = detail::parse_ip(std::string_view(first, size_t(last - first)), value);
+	if (res.ec != std::errc()) {
+		return {first, res.ec};
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return {first + res.size, std::errc()};
+}
+
+constexpr address::address(std::string_view host_str, uint16_t p) :
+	host(address::ip::parse(host_str)),
+	port(p)
+{}
+
+constexpr address::address(std::string_view str)
+{
+	auto res = detail::parse_address(str, *this);
+
+	// characters after the port number are ignored
+	if (res.res.ec != std::errc() || (!res.has_port && res.res.size != str.size())) {
+		throw std::runtime_error("bad IP address format");
+	}
+}
+
+constexpr std::from_chars_result address::from_chars(const char* first, const char* last, address& value) noexcept
+{
+	auto res = detail::parse_address(std::string_view(first, size_t(last - first)), value).res;
+	if (res.ec == std::errc::invalid_argument) {
+		return {first, res.ec};
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return {first + res.size, res.ec};
+}
+
+/**
+ * @brief User-defined literals for IP addresses.
+ * Parsing is done at compile time when the literal is used in a constant expression,
+ * in that case malformed address results in compilation error.
+ * @code
+ * using namespace setka::literals;
+ * constexpr auto server = "[2001:db8::1]:443"_addr;
+ * constexpr auto dns = "8.8.8.8"_ip;
+ * @endcode
+ */
+namespace literals {
+
+/**
+ * @brief Parse IP address with port.
+ * See address::address(std::string_view).
+ */
+constexpr address operator""_addr(const char* str, size_t size)
+{
+	return address(std::string_view(str, size));
+}
+
+/**
+ * @brief Parse IP host address.
+ * See address::ip::parse().
+ */
+constexpr address::ip operator""_ip(const char* str, size_t size)
+{
+	return address::ip::parse(std::string_view(str, size));
+}
+
+} // namespace literals
+
 } // namespace setka
+
+namespace std {
+
+/**
+ * @brief Hash function for IP host address.
+ * The hash function is fast, but not keyed. For hash tables keyed by addresses coming from
+ * untrusted peers use setka::keyed_address_hash to protect against hash flooding attacks.
+ */
+template <>
+struct hash<setka::address::ip> {
+	size_t operator()(const setka::address::ip& h) const noexcept
+	{
+		return size_t(setka::detail::hash_ip(h, 0));
+	}
+};
+
+/**
+ * @brief Hash function for IP address.
+ * See std::hash<setka::address::ip>.
+ */
+template <>
+struct hash<setka::address> {
+	size_t operator()(const setka::address& a) const noexcept
+	{
+		// IPv4 mapped to IPv6 addresses have zeroes in the highest 16 bits of the lower half,
+		// so putting the port there keeps distinct IPv4 address and port pairs distinct
+		constexpr auto port_shift = 48;
+		return size_t(setka::detail::hash_ip(a.host, uint64_t(a.port) << port_shift));
+	}
+};
+
+} // namespace std
@@ -0,0 +1,429 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <utki/debug.hpp>
+
+#include "address.hpp"
+#include "keyed_address_hash.hpp"
+
+namespace setka {
+
+/**
+ * @brief Hash map keyed by IP address.
+ * Open addressing hash map with Robin Hood probing and backward shift deletion.
+ * All entries are held in a single flat array, so finding an entry costs one hash computation and
+ * usually a single cache miss, while std::unordered_map allocates a separate node for each entry.
+ * The map is intended for holding per-peer state.
+ * Inserting and removing entries invalidates pointers to values held by the map.
+ * Probe distances of entries are limited. If a new key cannot be placed while the table is not full,
+ * then the keys collide and growing the table does not help, so the insertion fails with an exception.
+ * With the default keyed hash function a remote peer cannot choose colliding addresses.
+ * @tparam mapped_type - type of values, must be move constructible and move assignable.
+ * @tparam key_type - type of keys, setka::address or setka::address::ip.
+ * @tparam hasher_type - hash function. The unkeyed std::hash is faster, but it must not be used
+ *                       for keys coming from untrusted peers.
+ */
+template <typename mapped_type, typename key_type = address, typename hasher_type = keyed_address_hash>
+class address_map
+{
+	struct entry {
+		key_type key;
+		mapped_type value;
+	};
+
+	// storage for an entry which is constructed and destroyed explicitly
+	union slot {
+		entry e;
+
+		slot() noexcept {}
+
+		slot(const slot&) = delete;
+		slot& operator=(const slot&) = delete;
+
+		slot(slot&&) = delete;
+		slot& operator=(slot&&) = delete;
+
+		~slot() noexcept {}
+	};
+
+	// distance of an entry from its ideal slot plus one, 0 means the slot is empty
+	using distance_type = uint8_t;
+
+	constexpr static const distance_type max_distance = std::numeric_limits<distance_type>::max();
+
+	constexpr static const size_t min_capacity = 16;
+
+	constexpr static const size_t not_found = std::numeric_limits<size_t>::max();
+
+	std::unique_ptr<slot[]> slots;
+	std::vector<distance_type> distances;
+
+	size_t num_entries = 0;
+
+	hasher_type hasher;
+
+	size_t index_mask() const noexcept
+	{
+		return this->distances.size() - 1;
+	}
+
+	// maximum load factor is 7/8
+	constexpr static size_t max_size_for_capacity(size_t capacity) noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		return capacity - capacity / 8;
+	}
+
+	size_t find_index(const key_type& key) const noexcept
+	{
+		if (this->num_entries == 0) {
+			return not_found;
+		}
+
+		size_t i = this->hasher(key) & this->index_mask();
+
+		// stored distances are always less than max_distance, so the loop always ends
+		for (distance_type d = 1; this->distances[i] >= d; ++d) {
+			if (this->distances[i] == d && this->slots[i].e.key == key) {
+				return i;
+			}
+			i = (i + 1) & this->index_mask();
+		}
+		return not_found;
+	}
+
+	// Checks if an entry with the given hash value can be put to the table without reaching the
+	// probe distance limit. Follows the probing done by place() without moving the entries.
+	bool can_place(size_t hash) const noexcept
+	{
+		if (this->capacity() == 0) {
+			return false;
+		}
+
+		size_t i = hash & this->index_mask();
+
+		for (distance_type d = 1; d != max_distance; ++d) {
+			auto distance = this->distances[i];
+
+			if (distance == 0) {
+				return true;
+			}
+
+			if (distance < d) {
+				d = distance;
+			}
+
+			i = (i + 1) & this->index_mask();
+		}
+		return false;
+	}
+
+	// Puts the entry to the table, the entry key must not be in the table.
+	// Returns false if the probe distance limit is reached, in this case the passed entry object
+	// holds an entry which is not in the table, which can be different from the originally passed one.
+	bool place(entry& e)
+	{
+		size_t i = this->hasher(e.key) & this->index_mask();
+
+		for (distance_type d = 1; d != max_distance; ++d) {
+			auto& distance = this->distances[i];
+
+			if (distance == 0) {
+				new (&this->slots[i].e) entry(std::move(e));
+				distance = d;
+				return true;
+			}
+
+			// take the slot from an entry which is closer to its ideal slot
+			if (distance < d) {
+				std::swap(e, this->slots[i].e);
+				std::swap(d, distance);
+			}
+
+			i = (i + 1) & this->index_mask();
+		}
+		return false;
+	}
+
+	void rehash(size_t new_capacity)
+	{
+		ASSERT((new_capacity & (new_capacity - 1)) == 0)
+		ASSERT(max_size_for_capacity(new_capacity) >= this->num_entries)
+
+		auto old_slots = std::move(this->slots);
+		auto old_distances = std::move(this->distances);
+
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays)
+		this->slots = std::make_unique<slot[]>(new_capacity);
+		this->distances.assign(new_capacity, 0);
+
+		// Entries sharing a probe sequence in the smaller table are split among several probe sequences
+		// in the bigger table, so the probe distances do not grow and all the entries are placed.
+		for (size_t i = 0; i != old_distances.size(); ++i) {
+			if (old_distances[i] == 0) {
+				continue;
+			}
+			[[maybe_unused]] bool placed = this->place(old_slots[i].e);
+			ASSERT(placed)
+			old_slots[i].e.~entry();
+		}
+	}
+
+public:
+	/**
+	 * @brief Create empty map.
+	 * Memory is not allocated until the first entry is inserted.
+	 * @param hasher - hash function object.
+	 */
+	explicit address_map(hasher_type hasher = hasher_type()) :
+		hasher(std::move(hasher))
+	{}
+
+	address_map(const address_map&) = delete;
+	address_map& operator=(const address_map&) = delete;
+
+	address_map(address_map&& m) noexcept :
+		slots(std::move(m.slots)),
+		distances(std::exchange(m.distances, {})),
+		num_entries(std::exchange(m.num_entries, 0)),
+		hasher(std::move(m.hasher))
+	{}
+
+	address_map& operator=(address_map&& m) noexcept
+	{
+		this->clear();
+		this->slots = std::move(m.slots);
+		this->distances = std::exchange(m.distances, {});
+		this->num_entries = std::exchange(m.num_entries, 0);
+		this->hasher = std::move(m.hasher);
+		return *this;
+	}
+
+	~address_map() noexcept
+	{
+		this->clear();
+	}
+
+	/**
+	 * @brief Get number of entries in the map.
+	 * @return Number of entries.
+	 */
+	size_t size() const noexcept
+	{
+		return this->num_entries;
+	}
+
+	bool empty() const noexcept
+	{
+		return this->num_entries == 0;
+	}
+
+	/**
+	 * @brief Get number of slots in the table.
+	 * @return Number of slots.
+	 */
+	size_t capacity() const noexcept
+	{
+		return this->distances.size();
+	}
+
+	/**
+	 * @brief Reserve memory for given number of entries.
+	 * @param size - number of entries to reserve memory for.
+	 */
+	void reserve(size_t size)
+	{
+		size_t capacity = min_capacity;
+		while (max_size_for_capacity(capacity) < size) {
+			capacity *= 2;
+		}
+		if (capacity > this->capacity()) {
+			this->rehash(capacity);
+		}
+	}
+
+	/**
+	 * @brief Remove all entries from the map.
+	 * Allocated memory is not freed.
+	 */
+	void clear() noexcept
+	{
+		for (size_t i = 0; i != this->distances.size(); ++i) {
+			if (this->distances[i] != 0) {
+				this->slots[i].e.~entry();
+				this->distances[i] = 0;
+			}
+		}
+		this->num_entries = 0;
+	}
+
+	/**
+	 * @brief Find value by key.
+	 * @param key - key to find.
+	 * @return Pointer to the value, if the key is in the map.
+	 * @return nullptr, if the key is not in the map.
+	 */
+	mapped_type* find(const key_type& key) noexcept
+	{
+		auto i = this->find_index(key);
+		if (i == not_found) {
+			return nullptr;
+		}
+		return &this->slots[i].e.value;
+	}
+
+	const mapped_type* find(const key_type& key) const noexcept
+	{
+		auto i = this->find_index(key);
+		if (i == not_found) {
+			return nullptr;
+		}
+		return &this->slots[i].e.value;
+	}
+
+	bool contains(const key_type& key) const noexcept
+	{
+		return this->find_index(key) != not_found;
+	}
+
+	/**
+	 * @brief Insert entry if the key is not in the map.
+	 * @param key - key to insert.
+	 * @param args - arguments to construct the value from, if the key is not in the map.
+	 * @return Pair of pointer to the value of the key and a flag telling whether the entry was inserted.
+	 * @throw std::runtime_error - if the key collides with too many keys of the map, the map is not changed.
+	 */
+	template <typename... args_type>
+	std::pair<mapped_type*, bool> try_emplace(const key_type& key, args_type&&... args)
+	{
+		if (auto value = this->find(key)) {
+			return {value, false};
+		}
+
+		if (this->num_entries == max_size_for_capacity(this->capacity())) {
+			this->rehash(this->capacity() == 0 ? min_capacity : this->capacity() * 2);
+		}
+
+		size_t hash = this->hasher(key);
+
+		// Growing the table is only done while it is at least half full, otherwise an attacker sending colliding
+		// keys would make the table grow until memory is exhausted.
+		while (!this->can_place(hash)) {
+			if (this->num_entries < max_size_for_capacity(this->capacity()) / 2) {
+				throw std::runtime_error("address_map::try_emplace(): too many colliding keys");
+			}
+			this->rehash(this->capacity() * 2);
+		}
+
+		entry e{key, mapped_type(std::forward<args_type>(args)...)};
+		[[maybe_unused]] bool placed = this->place(e);
+		ASSERT(placed)
+		++this->num_entries;
+
+		// the entry could have been moved by the following insertions during Robin Hood probing
+		auto i = this->find_index(key);
+		ASSERT(i != not_found)
+		return {&this->slots[i].e.value, true};
+	}
+
+	/**
+	 * @brief Get value by key, inserting default constructed value if the key is not in the map.
+	 * @param key - key to get value for.
+	 * @return Reference to the value.
+	 */
+	mapped_type& operator[](const key_type& key)
+	{
+		return *this->try_emplace(key).first;
+	}
+
+	/**
+	 * @brief Remove entry from the map.
+	 * @param key - key of the entry to remove.
+	 * @return true if the entry was removed.
+	 * @return false if the key is not in the map.
+	 */
+	bool erase(const key_type& key)
+	{
+		auto i = this->find_index(key);
+		if (i == not_found) {
+			return false;
+		}
+
+		this->slots[i].e.~entry();
+
+		// shift following entries back to their ideal slots
+		for (size_t next = (i + 1) & this->index_mask(); this->distances[next] > 1;
+			 i = next, next = (next + 1) & this->index_mask())
+		{
+			new (&this->slots[i].e) entry(std::move(this->slots[next].e));
+			this->slots[next].e.~entry();
+			this->distances[i] = distance_type(this->distances[next] - 1);
+		}
+
+		this->distances[i] = 0;
+		--this->num_entries;
+		return true;
+	}
+
+	/**
+	 * @brief Call function for each entry of the map.
+	 * Entries are visited in unspecified order. The function must not insert or remove entries.
+	 * @param func - function to call, it takes key and reference to value as arguments.
+	 */
+	template <typename function_type>
+	void for_each(function_type&& func)
+	{
+		for (size_t i = 0; i != this->distances.size(); ++i) {
+			if (this->distances[i] != 0) {
+				func(static_cast<const key_type&>(this->slots[i].e.key), this->slots[i].e.value);
+			}
+		}
+	}
+
+	template <typename function_type>
+	void for_each(function_type&& func) const
+	{
+		for (size_t i = 0; i != this->distances.size(); ++i) {
+			if (this->distances[i] != 0) {
+				func(static_cast<const key_type&>(this->slots[i].e.key),
+					 static_cast<const mapped_type&>(this->slots[i].e.value));
+			}
+		}
+	}
+};
+
+} // namespace setka
@@ -0,0 +1,207 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "connection_table.hpp"
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+#	include <unistd.h>
+#endif
+
+using namespace setka;
+
+connection_table::~connection_table() noexcept
+{
+	for (auto& s : this->slots) {
+		if (s.handle == socket::invalid_socket) {
+			continue;
+		}
+#if CFG_OS == CFG_OS_WINDOWS
+		closesocket(s.handle);
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+		::close(s.handle);
+#else
+#	error "Unsupported OS"
+#endif
+	}
+}
+
+connection_table::connection_table(connection_table&& t) noexcept :
+	slots(std::move(t.slots)),
+	free_head(t.free_head),
+	num_connections(t.num_connections)
+{
+	// moved-from vector is not guaranteed to be empty
+	t.slots.clear();
+	t.free_head = invalid_index;
+	t.num_connections = 0;
+}
+
+connection_table& connection_table::operator=(connection_table&& t) noexcept
+{
+	// connections previously held by this table are closed by destructor of the temporary
+	connection_table tmp(std::move(t));
+	std::swap(this->slots, tmp.slots);
+	std::swap(this->free_head, tmp.free_head);
+	std::swap(this->num_connections, tmp.num_connections);
+	return *this;
+}
+
+const connection_table::slot& connection_table::get_slot(id i) const
+{
+	if (!this->contains(i)) {
+		throw std::logic_error("connection_table: connection id is not valid");
+	}
+	return this->slots[i.index];
+}
+
+connection_table::slot& connection_table::get_slot(id i)
+{
+	if (!this->contains(i)) {
+		throw std::logic_error("connection_table: connection id is not valid");
+	}
+	return this->slots[i.index];
+}
+
+bool connection_table::contains(id i) const noexcept
+{
+	if (i.index >= this->slots.size()) {
+		return false;
+	}
+	const auto& s = this->slots[i.index];
+	return s.handle != socket::invalid_socket && s.generation == i.generation;
+}
+
+connection_table::id connection_table::insert(tcp_socket&& s, uint32_t state)
+{
+	if (s.is_empty()) {
+		throw std::logic_error("connection_table::insert(): socket is empty");
+	}
+
+	uint32_t index = 0;
+	if (this->free_head == invalid_index) {
+		if (this->slots.size() >= invalid_index) {
+			throw std::length_error("connection_table::insert(): table is full");
+		}
+		index = uint32_t(this->slots.size());
+		this->slots.emplace_back();
+	} else {
+		index = this->free_head;
+		this->free_head = this->slots[index].state;
+	}
+
+	auto& sl = this->slots[index];
+
+#if CFG_OS == CFG_OS_WINDOWS
+	sl.handle = s.win_sock;
+	s.win_sock = socket::invalid_socket;
+	s.close_event_for_waitable();
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	sl.handle = s.handle;
+	s.handle = socket::invalid_socket;
+#else
+#	error "Unsupported OS"
+#endif
+
+	sl.state = state;
+	s.reset_address_cache();
+
+	++this->num_connections;
+
+	return {index, sl.generation};
+}
+
+tcp_socket connection_table::extract(id i)
+{
+	auto& sl = this->get_slot(i);
+
+	tcp_socket s;
+
+#if CFG_OS == CFG_OS_WINDOWS
+	s.create_event_for_waitable();
+	s.win_sock = sl.handle;
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	s.handle = sl.handle;
+#else
+#	error "Unsupported OS"
+#endif
+
+	sl.handle = socket::invalid_socket;
+	++sl.generation;
+	sl.state = this->free_head;
+	this->free_head = i.index;
+
+	ASSERT(this->num_connections != 0)
+	--this->num_connections;
+
+	return s;
+}
+
+void connection_table::close(id i)
+{
+	// the extracted socket is closed by its destructor
+	this->extract(i);
+}
+
+connection_table::waitable_entry::waitable_entry(const connection_table& table, id i)
+{
+	const auto& sl = table.get_slot(i);
+
+#if CFG_OS == CFG_OS_WINDOWS
+	this->create_event_for_waitable();
+	this->win_sock = sl.handle;
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	this->handle = sl.handle;
+#else
+#	error "Unsupported OS"
+#endif
+}
+
+connection_table::waitable_entry::~waitable_entry() noexcept
+{
+	// release the socket descriptor without closing it, since the connection is owned by the table
+#if CFG_OS == CFG_OS_WINDOWS
+	this->win_sock = invalid_socket;
+	this->close_event_for_waitable();
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	this->handle = invalid_socket;
+#else
+#	error "Unsupported OS"
+#endif
+}
+
+#if CFG_OS == CFG_OS_WINDOWS
+void connection_table::waitable_entry::set_waiting_flags(utki::flags<opros::ready> waiting_flags)
+{
+	long flags = FD_CLOSE;
+	if (waiting_flags.get(opros::ready::read)) {
+		flags |= FD_READ;
+	}
+	if (waiting_flags.get(opros::ready::write)) {
+		flags |= FD_WRITE | FD_CONNECT;
+	}
+	this->set_waiting_events_for_windows(flags);
+}
+#endif
@@ -0,0 +1,246 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#include "socket.hpp"
+#include "tcp_socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief Compact table of TCP connections.
+ * The table holds raw socket descriptors of connected TCP sockets in a densely packed
+ * array of slots, each slot also holds a user defined state value. This allows holding
+ * millions of connections without the overhead of a full tcp_socket object per connection.
+ * Connections are addressed by identifiers which consist of slot index and slot generation,
+ * so that an identifier of a removed connection never refers to a connection which later
+ * reuses the same slot.
+ */
+class connection_table
+{
+public:
+	/**
+	 * @brief Connection identifier.
+	 */
+	struct id {
+		uint32_t index = std::numeric_limits<uint32_t>::max();
+		uint32_t generation = 0;
+
+		bool operator==(const id& i) const noexcept
+		{
+			return this->index == i.index && this->generation == i.generation;
+		}
+
+		bool operator!=(const id& i) const noexcept
+		{
+			return !this->operator==(i);
+		}
+	};
+
+private:
+	struct slot {
+		socket::socket_type handle = socket::invalid_socket;
+		uint32_t generation = 0;
+
+		// user state if slot is occupied, index of the next free slot if slot is free
+		uint32_t state = 0;
+	};
+
+	std::vector<slot> slots;
+
+	constexpr static const uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+	uint32_t free_head = invalid_index;
+
+	size_t num_connections = 0;
+
+	const slot& get_slot(id i) const;
+	slot& get_slot(id i);
+
+public:
+	connection_table() = default;
+
+	connection_table(const connection_table&) = delete;
+	connection_table& operator=(const connection_table&) = delete;
+
+	/**
+	 * @brief Move constructor.
+	 * The moved-from table becomes empty.
+	 * @param t - table to move connections from.
+	 */
+	connection_table(connection_table&& t) noexcept;
+
+	/**
+	 * @brief Move assignment.
+	 * Closes connections held by this table and moves connections from the other table.
+	 * The moved-from table becomes empty.
+	 * @param t - table to move connections from.
+	 * @return Reference to this table.
+	 */
+	connection_table& operator=(connection_table&& t) noexcept;
+
+	/**
+	 * @brief Destructor.
+	 * Closes all the connections held by the table.
+	 */
+	~connection_table() noexcept;
+
+	/**
+	 * @brief Reserve memory for given number of connections.
+	 * @param capacity - number of connections to reserve memory for.
+	 */
+	void reserve(size_t capacity)
+	{
+		this->slots.reserve(capacity);
+	}
+
+	/**
+	 * @brief Get number of connections held by the table.
+	 * @return Number of connections.
+	 */
+	size_t size() const noexcept
+	{
+		return this->num_connections;
+	}
+
+	/**
+	 * @brief Move connected socket to the table.
+	 * The table takes ownership of the socket descriptor, the socket object becomes empty.
+	 * @param s - non-empty socket to move to the table.
+	 * @param state - initial user state value of the connection.
+	 * @return Identifier of the connection within the table.
+	 */
+	id insert(tcp_socket&& s, uint32_t state = 0);
+
+	/**
+	 * @brief Move connection out of the table.
+	 * @param i - identifier of the connection.
+	 * @return Socket object which owns the connection.
+	 */
+	tcp_socket extract(id i);
+
+	/**
+	 * @brief Close the connection and remove it from the table.
+	 * @param i - identifier of the connection.
+	 */
+	void close(id i);
+
+	/**
+	 * @brief Check if the table contains the connection.
+	 * @param i - identifier of the connection.
+	 * @return true if the connection is in the table.
+	 * @return false otherwise, for example if the connection was removed from the table.
+	 */
+	bool contains(id i) const noexcept;
+
+	/**
+	 * @brief Get user state of the connection.
+	 * @param i - identifier of the connection.
+	 * @return User state value.
+	 */
+	uint32_t get_state(id i) const
+	{
+		return this->get_slot(i).state;
+	}
+
+	/**
+	 * @brief Set user state of the connection.
+	 * @param i - identifier of the connection.
+	 * @param state - user state value.
+	 */
+	void set_state(id i, uint32_t state)
+	{
+		this->get_slot(i).state = state;
+	}
+
+	/**
+	 * @brief Send data to the connection.
+	 * Same as tcp_socket::send().
+	 * @param i - identifier of the connection.
+	 * @param buf - buffer with data to send.
+	 * @return the number of bytes actually sent.
+	 */
+	size_t send(id i, utki::span<const uint8_t> buf)
+	{
+		return tcp_socket::send(this->get_slot(i).handle, buf);
+	}
+
+	/**
+	 * @brief Receive data from the connection.
+	 * Same as tcp_socket::receive().
+	 * @param i - identifier of the connection.
+	 * @param buf - buffer where to put received data.
+	 * @return the number of bytes written to the buffer.
+	 */
+	size_t receive(id i, utki::span<uint8_t> buf)
+	{
+		return tcp_socket::receive(this->get_slot(i).handle, buf);
+	}
+
+	/**
+	 * @brief Waitable object for a connection of the table.
+	 * This object does not own the connection, it only allows adding the connection to opros::wait_set.
+	 * The waitable object must be removed from the wait set before the connection is removed from the table.
+	 */
+	class waitable_entry : public socket
+	{
+	public:
+		/**
+		 * @brief Create waitable object for the connection.
+		 * @param table - connection table.
+		 * @param i - identifier of the connection.
+		 */
+		waitable_entry(const connection_table& table, id i);
+
+		waitable_entry(const waitable_entry&) = delete;
+		waitable_entry& operator=(const waitable_entry&) = delete;
+
+		waitable_entry(waitable_entry&&) = delete;
+		waitable_entry& operator=(waitable_entry&&) = delete;
+
+		~waitable_entry() noexcept
+#if CFG_OS == CFG_OS_WINDOWS
+			override
+#endif
+			;
+
+#if CFG_OS == CFG_OS_WINDOWS
+
+	private:
+		void set_waiting_flags(utki::flags<opros::ready> waiting_flags) override;
+#endif
+	};
+};
+
+} // namespace setka
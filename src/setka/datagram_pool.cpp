@@ -0,0 +1,135 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "datagram_pool.hpp"
+
+#include <array>
+
+using namespace setka;
+
+utki::span<uint8_t> pooled_datagram::data() noexcept
+{
+	if (this->empty()) {
+		return {};
+	}
+	return this->pool->get_buffer(this->index).subspan(0, this->info.size);
+}
+
+utki::span<const uint8_t> pooled_datagram::data() const noexcept
+{
+	if (this->empty()) {
+		return {};
+	}
+	return this->pool->get_buffer(this->index).subspan(0, this->info.size);
+}
+
+void pooled_datagram::release() noexcept
+{
+	if (this->empty()) {
+		return;
+	}
+
+	// the queue capacity is equal to number of buffers, so there is always room for the released buffer
+	[[maybe_unused]] bool pushed = this->pool->free_buffers.push(std::move(this->index));
+	ASSERT(pushed)
+
+	this->pool = nullptr;
+}
+
+datagram_pool::datagram_pool(size_t num_buffers, size_t buffer_size) :
+	buffer_size(buffer_size),
+	memory(num_buffers * buffer_size),
+	free_buffers(num_buffers)
+{
+	if (buffer_size == 0) {
+		throw std::invalid_argument("datagram_pool::datagram_pool(): buffer size is 0");
+	}
+
+	for (size_t i = 0; i != num_buffers; ++i) {
+		this->free_buffers.push(size_t(i));
+	}
+}
+
+pooled_datagram datagram_pool::acquire()
+{
+	auto index = this->free_buffers.pop();
+	if (!index) {
+		return {};
+	}
+	return {*this, index.value()};
+}
+
+pooled_datagram datagram_pool::receive(udp_socket& socket)
+{
+	pooled_datagram d;
+	this->receive(socket, utki::make_span(&d, 1));
+	return d;
+}
+
+size_t datagram_pool::receive(udp_socket& socket, utki::span<pooled_datagram> out_datagrams)
+{
+	std::array<utki::span<uint8_t>, udp_socket::max_batch_size> bufs;
+	std::array<udp_socket::datagram_info, udp_socket::max_batch_size> infos;
+
+	size_t num_received = 0;
+
+	while (num_received != out_datagrams.size()) {
+		auto out = out_datagrams.subspan(num_received, std::min(out_datagrams.size() - num_received, bufs.size()));
+
+		size_t num_acquired = 0;
+		for (auto& d : out) {
+			d = this->acquire();
+			if (d.empty()) {
+				break;
+			}
+			bufs[num_acquired] = this->get_buffer(d.index);
+			++num_acquired;
+		}
+
+		size_t n = socket.receive_batch(
+			utki::make_span(bufs.data(), num_acquired),
+			utki::make_span(infos.data(), num_acquired)
+		);
+
+		for (size_t i = 0; i != n; ++i) {
+			out[i].info = infos[i];
+		}
+
+		// return unused buffers to the pool
+		for (size_t i = n; i != num_acquired; ++i) {
+			out[i].release();
+		}
+
+		num_received += n;
+
+		if (n != out.size()) {
+			// no more datagrams available or no free buffers
+			break;
+		}
+	}
+
+	return num_received;
+}
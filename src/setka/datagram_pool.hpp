@@ -0,0 +1,205 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#include "address.hpp"
+#include "mpmc_queue.hpp"
+#include "udp_socket.hpp"
+
+namespace setka {
+
+class datagram_pool;
+
+/**
+ * @brief Datagram held in a buffer of datagram_pool.
+ * Owning handle of the pool buffer. The handle is move-only, it can be passed to another thread,
+ * e.g. via mpmc_queue. The buffer is returned to the pool when the handle is destroyed or released.
+ * The handle must not outlive the pool.
+ */
+class pooled_datagram
+{
+	friend class datagram_pool;
+
+	datagram_pool* pool = nullptr;
+	size_t index = 0;
+
+	udp_socket::datagram_info info;
+
+	pooled_datagram(datagram_pool& pool, size_t index) :
+		pool(&pool),
+		index(index)
+	{}
+
+public:
+	/**
+	 * @brief Create empty handle.
+	 */
+	pooled_datagram() = default;
+
+	pooled_datagram(const pooled_datagram&) = delete;
+	pooled_datagram& operator=(const pooled_datagram&) = delete;
+
+	pooled_datagram(pooled_datagram&& d) noexcept :
+		pool(d.pool),
+		index(d.index),
+		info(d.info)
+	{
+		d.pool = nullptr;
+	}
+
+	pooled_datagram& operator=(pooled_datagram&& d) noexcept
+	{
+		this->release();
+		this->pool = d.pool;
+		this->index = d.index;
+		this->info = d.info;
+		d.pool = nullptr;
+		return *this;
+	}
+
+	~pooled_datagram()
+	{
+		this->release();
+	}
+
+	/**
+	 * @brief Check if the handle holds a buffer.
+	 * @return true if the handle is empty.
+	 */
+	bool empty() const noexcept
+	{
+		return this->pool == nullptr;
+	}
+
+	/**
+	 * @brief Get datagram data.
+	 * @return span of the received data. Empty span if the handle is empty.
+	 */
+	utki::span<uint8_t> data() noexcept;
+
+	/**
+	 * @brief Get datagram data.
+	 * @return span of the received data. Empty span if the handle is empty.
+	 */
+	utki::span<const uint8_t> data() const noexcept;
+
+	/**
+	 * @brief Get information about the received datagram.
+	 * Sender address, receive timestamp, truncation and original size of the datagram.
+	 * @return datagram information.
+	 */
+	const udp_socket::datagram_info& get_info() const noexcept
+	{
+		return this->info;
+	}
+
+	/**
+	 * @brief Return the buffer to the pool.
+	 * The handle becomes empty.
+	 */
+	void release() noexcept;
+};
+
+/**
+ * @brief Pool of fixed-size datagram buffers.
+ * All the buffers are allocated on construction. Datagrams are received directly to the pool buffers
+ * and returned as pooled_datagram handles, so no memory allocation or copying is needed to pass
+ * received datagrams to worker threads. Acquiring and releasing buffers is lock-free and thread-safe.
+ *
+ * If a received datagram does not fit the buffer, it is truncated, the datagram info reports
+ * the truncation and the original datagram size (on Linux), so that the buffer size can be adapted.
+ */
+class datagram_pool
+{
+	friend class pooled_datagram;
+
+	const size_t buffer_size;
+	std::vector<uint8_t> memory;
+
+	mpmc_queue<size_t> free_buffers;
+
+public:
+	/**
+	 * @brief Create pool.
+	 * @param num_buffers - number of buffers in the pool, must be a power of 2.
+	 * @param buffer_size - size of each buffer, must not be 0.
+	 */
+	datagram_pool(size_t num_buffers, size_t buffer_size);
+
+	datagram_pool(const datagram_pool&) = delete;
+	datagram_pool& operator=(const datagram_pool&) = delete;
+
+	datagram_pool(datagram_pool&&) = delete;
+	datagram_pool& operator=(datagram_pool&&) = delete;
+
+	~datagram_pool() = default;
+
+	size_t get_buffer_size() const noexcept
+	{
+		return this->buffer_size;
+	}
+
+	size_t get_num_buffers() const noexcept
+	{
+		return this->free_buffers.capacity();
+	}
+
+	/**
+	 * @brief Receive datagram to a pool buffer.
+	 * @param socket - socket to receive the datagram from.
+	 * @return handle of the received datagram.
+	 * @return empty handle if there is no datagram available or all the pool buffers are in use.
+	 */
+	pooled_datagram receive(udp_socket& socket);
+
+	/**
+	 * @brief Receive several datagrams to pool buffers.
+	 * Receives as many datagrams as available at the moment, but not more than number of output handles
+	 * and number of free pool buffers. Previous contents of the output handles are released.
+	 * On Linux, up to udp_socket::max_batch_size datagrams are received with a single system call.
+	 * @param socket - socket to receive the datagrams from.
+	 * @param out_datagrams - handles to store the received datagrams to.
+	 * @return number of datagrams received.
+	 */
+	size_t receive(udp_socket& socket, utki::span<pooled_datagram> out_datagrams);
+
+private:
+	pooled_datagram acquire();
+
+	utki::span<uint8_t> get_buffer(size_t index) noexcept
+	{
+		return utki::make_span(this->memory).subspan(index * this->buffer_size, this->buffer_size);
+	}
+};
+
+} // namespace setka
@@ -0,0 +1,228 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "endpoint.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+#	include <netinet/in.h>
+#endif
+
+#include <utki/debug.hpp>
+
+using namespace setka;
+
+endpoint::endpoint(const address& addr) noexcept :
+	storage{}
+{
+	if (addr.host.is_v4()) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto& a = reinterpret_cast<sockaddr_in&>(this->storage);
+		a.sin_family = AF_INET;
+		a.sin_addr.s_addr = htonl(addr.host.get_v4());
+		a.sin_port = htons(addr.port);
+		this->length = sizeof(a);
+	} else {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto& a = reinterpret_cast<sockaddr_in6&>(this->storage);
+		a.sin6_family = AF_INET6;
+#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
+	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[0] = addr.host.quad[0] >> (utki::byte_bits * 3);
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[1] = (addr.host.quad[0] >> (utki::byte_bits * 2)) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[2] = (addr.host.quad[0] >> utki::byte_bits) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[3] = addr.host.quad[0] & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[4] = addr.host.quad[1] >> (utki::byte_bits * 3);
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[5] = (addr.host.quad[1] >> (utki::byte_bits * 2)) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[6] = (addr.host.quad[1] >> utki::byte_bits) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[7] = addr.host.quad[1] & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[8] = addr.host.quad[2] >> (utki::byte_bits * 3);
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[9] = (addr.host.quad[2] >> (utki::byte_bits * 2)) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[10] = (addr.host.quad[2] >> utki::byte_bits) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[11] = addr.host.quad[2] & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[12] = addr.host.quad[3] >> (utki::byte_bits * 3);
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[13] = (addr.host.quad[3] >> (utki::byte_bits * 2)) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[14] = (addr.host.quad[3] >> utki::byte_bits) & utki::byte_mask;
+		// NOLINTNEXTLINE
+		a.sin6_addr.s6_addr[15] = addr.host.quad[3] & utki::byte_mask;
+#else
+		a.sin6_addr.__in6_u.__u6_addr32[0] = htonl(addr.host.quad[0]); // NOLINT
+		a.sin6_addr.__in6_u.__u6_addr32[1] = htonl(addr.host.quad[1]); // NOLINT
+		a.sin6_addr.__in6_u.__u6_addr32[2] = htonl(addr.host.quad[2]); // NOLINT
+		a.sin6_addr.__in6_u.__u6_addr32[3] = htonl(addr.host.quad[3]); // NOLINT
+#endif
+		a.sin6_port = htons(addr.port);
+		this->length = sizeof(a);
+	}
+}
+
+endpoint::endpoint(const sockaddr* socket_address, size_t socket_address_length) :
+	storage{}
+{
+	if (socket_address->sa_family == AF_INET) {
+		if (socket_address_length < sizeof(sockaddr_in)) {
+			throw std::invalid_argument("endpoint::endpoint(): socket address length is too small");
+		}
+		socket_address_length = sizeof(sockaddr_in);
+	} else if (socket_address->sa_family == AF_INET6) {
+		if (socket_address_length < sizeof(sockaddr_in6)) {
+			throw std::invalid_argument("endpoint::endpoint(): socket address length is too small");
+		}
+		socket_address_length = sizeof(sockaddr_in6);
+	} else {
+		throw std::invalid_argument("endpoint::endpoint(): unsupported address family");
+	}
+
+	memcpy(&this->storage, socket_address, socket_address_length);
+	this->length = length_type(socket_address_length);
+}
+
+address endpoint::to_address() const
+{
+	if (this->storage.ss_family == AF_INET) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& a = reinterpret_cast<const sockaddr_in&>(this->storage);
+		return {uint32_t(ntohl(a.sin_addr.s_addr)), uint16_t(ntohs(a.sin_port))};
+	} else if (this->storage.ss_family == AF_INET6) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& a = reinterpret_cast<const sockaddr_in6&>(this->storage);
+		return {
+			address::ip(
+#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
+	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
+				(uint32_t(a.sin6_addr.s6_addr[0]) << (utki::byte_bits * 3)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[1]) << (utki::byte_bits * 2)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[2]) << utki::byte_bits) // NOLINT
+					| uint32_t(a.sin6_addr.s6_addr[3]), // NOLINT
+				(uint32_t(a.sin6_addr.s6_addr[4]) << (utki::byte_bits * 3)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[5]) << (utki::byte_bits * 2)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[6]) << utki::byte_bits) // NOLINT
+					| uint32_t(a.sin6_addr.s6_addr[7]), // NOLINT
+				(uint32_t(a.sin6_addr.s6_addr[8]) << (utki::byte_bits * 3)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[9]) << (utki::byte_bits * 2)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[10]) << utki::byte_bits) // NOLINT
+					| uint32_t(a.sin6_addr.s6_addr[11]), // NOLINT
+				(uint32_t(a.sin6_addr.s6_addr[12]) << (utki::byte_bits * 3)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[13]) << (utki::byte_bits * 2)) // NOLINT
+					| (uint32_t(a.sin6_addr.s6_addr[14]) << utki::byte_bits) // NOLINT
+					| uint32_t(a.sin6_addr.s6_addr[15]) // NOLINT
+#else
+				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[0])), // NOLINT
+				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[1])), // NOLINT
+				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[2])), // NOLINT
+				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[3])) // NOLINT
+#endif
+			),
+			uint16_t(ntohs(a.sin6_port))
+		};
+	}
+
+	throw std::logic_error("endpoint::to_address(): endpoint is empty");
+}
+
+uint16_t endpoint::get_port() const noexcept
+{
+	if (this->storage.ss_family == AF_INET) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return uint16_t(ntohs(reinterpret_cast<const sockaddr_in&>(this->storage).sin_port));
+	} else if (this->storage.ss_family == AF_INET6) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return uint16_t(ntohs(reinterpret_cast<const sockaddr_in6&>(this->storage).sin6_port));
+	}
+	return 0;
+}
+
+endpoint endpoint::to_v6_mapped() const noexcept
+{
+	if (this->storage.ss_family != AF_INET) {
+		return *this;
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	const auto& a = reinterpret_cast<const sockaddr_in&>(this->storage);
+
+	endpoint ret;
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto& a6 = reinterpret_cast<sockaddr_in6&>(ret.storage);
+	a6.sin6_family = AF_INET6;
+	a6.sin6_port = a.sin_port;
+	a6.sin6_addr.s6_addr[10] = 0xff; // NOLINT
+	a6.sin6_addr.s6_addr[11] = 0xff; // NOLINT
+	memcpy(&a6.sin6_addr.s6_addr[12], &a.sin_addr, sizeof(a.sin_addr)); // NOLINT
+	ret.length = sizeof(a6);
+
+	return ret;
+}
+
+bool endpoint::operator==(const endpoint& e) const noexcept
+{
+	if (this->storage.ss_family != e.storage.ss_family) {
+		// dual-stack sockets report IPv4 senders as IPv4 mapped IPv6 endpoints,
+		// those are equal to IPv4 endpoints of the same address
+		if ((this->storage.ss_family == AF_INET && e.storage.ss_family == AF_INET6) ||
+			(this->storage.ss_family == AF_INET6 && e.storage.ss_family == AF_INET))
+		{
+			return this->to_v6_mapped() == e.to_v6_mapped();
+		}
+		return false;
+	}
+
+	if (this->storage.ss_family == AF_INET) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& a = reinterpret_cast<const sockaddr_in&>(this->storage);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& b = reinterpret_cast<const sockaddr_in&>(e.storage);
+		return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+	} else if (this->storage.ss_family == AF_INET6) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& a = reinterpret_cast<const sockaddr_in6&>(this->storage);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto& b = reinterpret_cast<const sockaddr_in6&>(e.storage);
+		return a.sin6_port == b.sin6_port && a.sin6_scope_id == b.sin6_scope_id &&
+			memcmp(&a.sin6_addr, &b.sin6_addr, sizeof(a.sin6_addr)) == 0;
+	}
+
+	// both are empty
+	return true;
+}
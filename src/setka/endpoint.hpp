@@ -0,0 +1,191 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <utki/config.hpp>
+
+#if CFG_OS == CFG_OS_WINDOWS
+#	include <winsock2.h>
+#	include <ws2tcpip.h>
+#	include <utki/windows.hpp>
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+#	include <sys/socket.h>
+#else
+#	error "Unsupported OS"
+#endif
+
+#include "address.hpp"
+
+namespace setka {
+
+/**
+ * @brief Network address in the OS native format.
+ * Holds a ready to use socket address structure (sockaddr_in or sockaddr_in6) along with its length.
+ * Converting setka::address to the native format and back involves byte reordering, so when
+ * the same address is used repeatedly, e.g. as a destination of many datagrams, it is cheaper
+ * to convert it to an endpoint once and pass the endpoint to the socket functions.
+ *
+ * IPv4 addresses (IPv4 mapped to IPv6 addresses) are held as sockaddr_in,
+ * all other addresses are held as sockaddr_in6.
+ */
+class endpoint
+{
+public:
+#if CFG_OS == CFG_OS_WINDOWS
+	using length_type = int;
+#else
+	using length_type = socklen_t;
+#endif
+
+private:
+	sockaddr_storage storage;
+	length_type length = 0;
+
+public:
+	/**
+	 * @brief Create empty endpoint.
+	 */
+	endpoint() noexcept :
+		storage{}
+	{}
+
+	/**
+	 * @brief Create endpoint from address.
+	 * @param addr - address to convert to the native format.
+	 */
+	explicit endpoint(const address& addr) noexcept;
+
+	/**
+	 * @brief Create endpoint from native socket address.
+	 * @param socket_address - socket address, its family must be AF_INET or AF_INET6.
+	 * @param socket_address_length - length of the socket address.
+	 * @throw std::invalid_argument - if address family is not supported or the length is invalid.
+	 */
+	endpoint(const sockaddr* socket_address, size_t socket_address_length);
+
+	/**
+	 * @brief Convert to address.
+	 * @return address held by the endpoint.
+	 * @throw std::logic_error - if the endpoint is empty.
+	 */
+	address to_address() const;
+
+	/**
+	 * @brief Get port number.
+	 * @return port number, in host byte order.
+	 */
+	uint16_t get_port() const noexcept;
+
+	/**
+	 * @brief Get address family.
+	 * @return AF_INET, AF_INET6 or AF_UNSPEC if the endpoint is empty.
+	 */
+	int get_family() const noexcept
+	{
+		return this->storage.ss_family;
+	}
+
+	bool empty() const noexcept
+	{
+		return this->length == 0;
+	}
+
+	/**
+	 * @brief Get native socket address.
+	 * @return pointer to the socket address structure.
+	 */
+	const sockaddr* data() const noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return reinterpret_cast<const sockaddr*>(&this->storage);
+	}
+
+	/**
+	 * @brief Get length of the native socket address.
+	 * @return length in bytes.
+	 */
+	length_type size() const noexcept
+	{
+		return this->length;
+	}
+
+	/**
+	 * @brief Convert IPv4 endpoint to IPv4 mapped to IPv6 endpoint.
+	 * Some systems require IPv4 addresses to be given as IPv4 mapped IPv6 addresses to dual-stack sockets.
+	 * @return endpoint holding sockaddr_in6. For non-IPv4 endpoint a copy of this endpoint.
+	 */
+	endpoint to_v6_mapped() const noexcept;
+
+	/**
+	 * @brief Compare endpoints.
+	 * IPv4 endpoint is equal to IPv4 mapped IPv6 endpoint of the same address and port,
+	 * so that senders reported by dual-stack sockets match endpoints created from IPv4 addresses.
+	 * @param e - endpoint to compare with.
+	 * @return true if the endpoints hold the same address and port.
+	 */
+	bool operator==(const endpoint& e) const noexcept;
+
+	bool operator!=(const endpoint& e) const noexcept
+	{
+		return !this->operator==(e);
+	}
+
+	/**
+	 * @brief Get writable socket address structure.
+	 * To be used for receiving a socket address from the OS, e.g. by recvfrom(),
+	 * followed by set_size() call.
+	 * @return pointer to the socket address structure.
+	 */
+	sockaddr* data() noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return reinterpret_cast<sockaddr*>(&this->storage);
+	}
+
+	/**
+	 * @brief Get capacity of the socket address structure.
+	 * @return size of the socket address structure in bytes.
+	 */
+	constexpr static length_type capacity() noexcept
+	{
+		return sizeof(sockaddr_storage);
+	}
+
+	/**
+	 * @brief Set length of the socket address.
+	 * To be used after the socket address structure was filled by the OS.
+	 * @param socket_address_length - length of the socket address.
+	 */
+	void set_size(length_type socket_address_length) noexcept
+	{
+		this->length = socket_address_length;
+	}
+};
+
+} // namespace setka
@@ -0,0 +1,436 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "ip_list_parser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include <utki/config.hpp>
+#include <utki/debug.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define SETKA_IP_LIST_PARSER_SSE2
+#	include <emmintrin.h>
+#endif
+
+using namespace setka;
+
+namespace {
+constexpr size_t block_size = 16;
+
+// items longer than that are malformed, longest IPv6 address with trailing IPv4 address is 45 characters
+constexpr size_t max_item_size = 64;
+
+constexpr size_t max_ip_v4_size = 15;
+
+// zero bytes before the first character of an item, so that 3 digits before the end of any octet can be read
+constexpr size_t digits_padding = 3;
+
+unsigned lowest_bit_index(uint64_t x) noexcept
+{
+	ASSERT(x != 0)
+#if CFG_COMPILER == CFG_COMPILER_GCC || CFG_COMPILER == CFG_COMPILER_CLANG
+	return unsigned(__builtin_ctzll(x));
+#else
+	unsigned ret = 0;
+	for (; (x & 1) == 0; x >>= 1) {
+		++ret;
+	}
+	return ret;
+#endif
+}
+
+constexpr uint64_t low_bits_mask(size_t num_bits) noexcept
+{
+	return num_bits >= std::numeric_limits<uint64_t>::digits ? ~uint64_t(0) : (uint64_t(1) << num_bits) - 1;
+}
+
+// Bitmasks of character classes, bit i corresponds to i-th character of an item.
+struct char_classes {
+	uint64_t digits = 0;
+	uint64_t hex_letters = 0;
+	uint64_t dots = 0;
+	uint64_t colons = 0;
+};
+
+struct item_scan {
+	// size of the item if it is not longer than max_item_size
+	size_t size = 0;
+	bool too_long = false;
+	char_classes classes;
+
+	// values of decimal digits in the first block of the item, zero for non-digit characters and padding
+	std::array<uint8_t, digits_padding + block_size> digit_values{};
+};
+
+// Finds the end of the item and classifies its characters.
+item_scan scan_item(std::string_view text, size_t begin, char delimiter) noexcept
+{
+	item_scan ret;
+
+	for (size_t offset = 0;; offset += block_size) {
+		size_t pos = begin + offset;
+		if (pos >= text.size()) {
+			ret.size = text.size() - begin;
+			break;
+		}
+
+		size_t num_chars = std::min(block_size, text.size() - pos);
+
+		uint64_t delimiters = 0;
+
+#ifdef SETKA_IP_LIST_PARSER_SSE2
+		__m128i v{};
+		if (num_chars == block_size) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(std::next(text.data(), pos)));
+		} else {
+			// do not read beyond the end of the text
+			std::array<char, block_size> buf{};
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			memcpy(buf.data(), text.data() + pos, num_chars);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf.data()));
+		}
+
+		auto to_mask = [](__m128i m) {
+			return uint64_t(unsigned(_mm_movemask_epi8(m)));
+		};
+
+		// SSE2 has only signed comparison, characters above 0x7f are negative, so they do not fall into the ranges
+		auto in_range = [](__m128i x, char low, char high) {
+			return _mm_and_si128(
+				_mm_cmpgt_epi8(x, _mm_set1_epi8(char(low - 1))),
+				_mm_cmplt_epi8(x, _mm_set1_epi8(char(high + 1)))
+			);
+		};
+
+		// setting 0x20 bit converts 'A'-'F' to 'a'-'f', and no other character is converted to 'a'-'f'
+		constexpr char lowercase_bit = 0x20;
+		__m128i lowercase = _mm_or_si128(v, _mm_set1_epi8(lowercase_bit));
+
+		__m128i digits_bytes = in_range(v, '0', '9');
+		uint64_t digits = to_mask(digits_bytes);
+		uint64_t hex_letters = to_mask(in_range(lowercase, 'a', 'f'));
+		uint64_t dots = to_mask(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+		uint64_t colons = to_mask(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+		delimiters = to_mask(_mm_cmpeq_epi8(v, _mm_set1_epi8(delimiter)));
+
+		if (offset == 0) {
+			__m128i values = _mm_and_si128(_mm_sub_epi8(v, _mm_set1_epi8('0')), digits_bytes);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(std::next(ret.digit_values.data(), digits_padding)), values);
+		}
+#else
+		uint64_t digits = 0;
+		uint64_t hex_letters = 0;
+		uint64_t dots = 0;
+		uint64_t colons = 0;
+		for (size_t i = 0; i != num_chars; ++i) {
+			char c = text[pos + i];
+			uint64_t bit = uint64_t(1) << i;
+			if (c == delimiter) {
+				delimiters |= bit;
+			}
+			if (detail::is_digit(c)) {
+				digits |= bit;
+				if (offset == 0) {
+					ret.digit_values[digits_padding + i] = uint8_t(c - '0');
+				}
+			} else if (detail::hex_digit_value(c) >= 0) {
+				hex_letters |= bit;
+			} else if (c == '.') {
+				dots |= bit;
+			} else if (c == ':') {
+				colons |= bit;
+			}
+		}
+#endif
+
+		ret.classes.digits |= digits << offset;
+		ret.classes.hex_letters |= hex_letters << offset;
+		ret.classes.dots |= dots << offset;
+		ret.classes.colons |= colons << offset;
+
+		delimiters &= low_bits_mask(num_chars);
+		if (delimiters != 0) {
+			ret.size = offset + lowest_bit_index(delimiters);
+			break;
+		}
+
+		if (num_chars != block_size) {
+			// end of text
+			ret.size = offset + num_chars;
+			break;
+		}
+
+		if (offset + block_size == max_item_size) {
+			ret.too_long = true;
+			return ret;
+		}
+	}
+
+	auto mask = low_bits_mask(ret.size);
+	ret.classes.digits &= mask;
+	ret.classes.hex_letters &= mask;
+	ret.classes.dots &= mask;
+	ret.classes.colons &= mask;
+
+	return ret;
+}
+
+size_t find_delimiter(std::string_view text, size_t pos, char delimiter) noexcept
+{
+#ifdef SETKA_IP_LIST_PARSER_SSE2
+	__m128i d = _mm_set1_epi8(delimiter);
+	for (; pos + block_size <= text.size(); pos += block_size) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+		auto m = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, d)));
+		if (m != 0) {
+			return pos + lowest_bit_index(m);
+		}
+	}
+#endif
+	auto i = text.find(delimiter, pos);
+	return i == std::string_view::npos ? text.size() : i;
+}
+
+// Parses dotted-decimal IPv4 address, positions of dots are known from the bitmask.
+// Octets are converted without data dependent branches, because random addresses have random number of digits
+// in octets, which makes the branches unpredictable.
+bool parse_ip_v4(size_t size, const item_scan& scan, uint32_t& out) noexcept
+{
+	const auto& classes = scan.classes;
+
+	if (size > max_ip_v4_size || (classes.digits | classes.dots) != low_bits_mask(size)) {
+		return false;
+	}
+
+	std::array<size_t, detail::num_ip_v4_parts> ends{};
+	auto dots = classes.dots;
+	for (size_t i = 0; i != ends.size() - 1; ++i) {
+		if (dots == 0) {
+			return false;
+		}
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		ends[i] = lowest_bit_index(dots);
+		dots &= dots - 1;
+	}
+	if (dots != 0) {
+		return false;
+	}
+	ends.back() = size;
+
+	auto digit = [&scan](size_t i) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		return uint32_t(scan.digit_values[digits_padding + i]);
+	};
+
+	constexpr std::array<uint32_t, 4> tens_weights = {0, 0, detail::decimal_base, detail::decimal_base};
+	constexpr std::array<uint32_t, 4> hundreds_weights = {0, 0, 0, detail::decimal_base * detail::decimal_base};
+
+	uint32_t value = 0;
+	bool error = false;
+	size_t begin = 0;
+	for (auto end : ends) {
+		size_t num_digits = end - begin;
+
+		// weights of digits are looked up by number of digits, octets of more than 3 digits are rejected anyway
+		auto weights_index = num_digits & (tens_weights.size() - 1);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		uint32_t n = digit(end - 1) + tens_weights[weights_index] * digit(end - 2) +
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			hundreds_weights[weights_index] * digit(end - 3);
+
+		bool leading_zero = (num_digits > 1) & (digit(begin) == 0);
+
+		// unsigned wrap around makes zero number of digits fail the check as well
+		error |= (num_digits - 1 > 2) | leading_zero | (n > utki::byte_mask);
+
+		value = (value << utki::byte_bits) | (n & utki::byte_mask);
+		begin = end + 1;
+	}
+
+	if (error) {
+		return false;
+	}
+
+	out = value;
+	return true;
+}
+
+// parses IPv6 address without trailing IPv4 address, positions of colons are known from the bitmask
+bool parse_ip_v6(std::string_view item, const char_classes& classes, address::ip& out) noexcept
+{
+	ASSERT(classes.dots == 0)
+
+	if ((classes.digits | classes.hex_letters | classes.colons) != low_bits_mask(item.size())) {
+		return false;
+	}
+
+	std::array<uint16_t, detail::num_ip_v6_parts> parts{};
+	size_t num_parts = 0;
+
+	constexpr auto no_gap = std::numeric_limits<size_t>::max();
+	size_t gap_part = no_gap;
+
+	size_t begin = 0;
+	if (item.size() >= 2 && item[0] == ':' && item[1] == ':') {
+		gap_part = 0;
+		begin = 2;
+	}
+
+	while (begin != item.size()) {
+		auto colons = classes.colons & ~low_bits_mask(begin);
+		size_t end = colons == 0 ? item.size() : lowest_bit_index(colons);
+		size_t num_digits = end - begin;
+
+		if (num_digits == 0 || num_digits > detail::max_ip_v6_part_digits || num_parts == parts.size()) {
+			return false;
+		}
+
+		uint32_t n = 0;
+		for (size_t i = begin; i != end; ++i) {
+			n = (n << detail::hex_digit_bits) | uint32_t(detail::hex_digit_value(item[i]));
+		}
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		parts[num_parts] = uint16_t(n);
+		++num_parts;
+
+		if (end == item.size()) {
+			break;
+		}
+
+		if (end + 1 != item.size() && item[end + 1] == ':') {
+			if (gap_part != no_gap) {
+				return false;
+			}
+			gap_part = num_parts;
+			begin = end + 2;
+		} else if (end + 1 == item.size()) {
+			// trailing single colon
+			return false;
+		} else {
+			begin = end + 1;
+		}
+	}
+
+	if (gap_part == no_gap) {
+		if (num_parts != parts.size()) {
+			return false;
+		}
+	} else {
+		if (num_parts == parts.size()) {
+			return false;
+		}
+		auto gap_size = parts.size() - num_parts;
+		std::copy_backward(
+			std::next(parts.begin(), ptrdiff_t(gap_part)),
+			std::next(parts.begin(), ptrdiff_t(num_parts)),
+			parts.end()
+		);
+		std::fill_n(std::next(parts.begin(), ptrdiff_t(gap_part)), gap_size, 0);
+	}
+
+	out = address::ip(parts[0], parts[1], parts[2], parts[3], parts[4], parts[5], parts[6], parts[7]); // NOLINT
+	return true;
+}
+
+std::errc parse_item(std::string_view item, const item_scan& scan, address::ip& out) noexcept
+{
+	const auto& classes = scan.classes;
+
+	if (classes.colons == 0) {
+		uint32_t v4 = 0;
+		if (!parse_ip_v4(item.size(), scan, v4)) {
+			return std::errc::invalid_argument;
+		}
+		out = address::ip(v4);
+		return std::errc();
+	}
+
+	if (classes.dots == 0) {
+		if (!parse_ip_v6(item, classes, out)) {
+			return std::errc::invalid_argument;
+		}
+		return std::errc();
+	}
+
+	// IPv6 with trailing IPv4 address is rare, parse it with generic parser
+	auto res = detail::parse_ip_v6(item, out);
+	if (res.ec != std::errc() || res.size != item.size()) {
+		return std::errc::invalid_argument;
+	}
+	return std::errc();
+}
+} // namespace
+
+ip_list_parse_result setka::parse_ip_list(
+	std::string_view text,
+	char delimiter,
+	utki::span<address::ip> out_hosts,
+	utki::span<std::errc> out_errors
+)
+{
+	if (out_hosts.size() != out_errors.size()) {
+		throw std::invalid_argument("parse_ip_list(): out_hosts and out_errors sizes differ");
+	}
+
+	size_t pos = 0;
+	size_t num_items = 0;
+
+	for (; pos != text.size() && num_items != out_hosts.size(); ++num_items) {
+		auto& host = out_hosts[num_items];
+		auto& error = out_errors[num_items];
+
+		host = address::ip();
+
+		auto scan = scan_item(text, pos, delimiter);
+
+		size_t end = 0;
+		if (scan.too_long) {
+			end = find_delimiter(text, pos + max_item_size, delimiter);
+			error = std::errc::invalid_argument;
+		} else {
+			end = pos + scan.size;
+			address::ip h;
+			error = parse_item(text.substr(pos, scan.size), scan, h);
+			if (error == std::errc()) {
+				host = h;
+			}
+		}
+
+		// skip the delimiter
+		pos = end == text.size() ? end : end + 1;
+	}
+
+	return {num_items, pos};
+}
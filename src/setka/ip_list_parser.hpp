@@ -0,0 +1,82 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+#include <utki/span.hpp>
+
+#include "address.hpp"
+
+namespace setka {
+
+/**
+ * @brief Result of parse_ip_list().
+ */
+struct ip_list_parse_result {
+	/**
+	 * @brief Number of items parsed.
+	 * Number of entries written to output buffers.
+	 */
+	size_t num_items;
+
+	/**
+	 * @brief Number of characters consumed.
+	 * Position in the text from which parsing of the next items can be continued.
+	 */
+	size_t num_consumed;
+};
+
+/**
+ * @brief Parse list of IP addresses.
+ * Parses text consisting of IP addresses separated by the delimiter, e.g. one address per line.
+ * Each item is parsed same way as address::ip::parse() does, but errors are reported per item instead of
+ * throwing exceptions, and the whole list is parsed in one go. Delimiters and character classes
+ * are scanned 16 characters at a time with SSE2 instructions where available,
+ * dotted-decimal numbers and hexadecimal groups are then parsed from the resulting bitmasks.
+ * Items are not trimmed, so that an item with white space is malformed, and empty items are malformed as well.
+ * The delimiter after the last item is optional.
+ * @param text - text to parse.
+ * @param delimiter - character which separates the items.
+ * @param out_hosts - buffer to store parsed addresses to. Entries of malformed items are set to all zeroes.
+ * @param out_errors - buffer to store per item errors to, same size as out_hosts.
+ *                     Default value of std::errc for successfully parsed items and std::errc::invalid_argument
+ *                     for malformed items.
+ * @return Number of parsed items and number of consumed characters. Parsing stops when the text ends or
+ *         the output buffers are full, in the latter case the rest of the text can be parsed with another call.
+ * @throw std::invalid_argument - if sizes of out_hosts and out_errors differ.
+ */
+ip_list_parse_result parse_ip_list(
+	std::string_view text,
+	char delimiter,
+	utki::span<address::ip> out_hosts,
+	utki::span<std::errc> out_errors
+);
+
+} // namespace setka
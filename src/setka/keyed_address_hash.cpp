@@ -0,0 +1,169 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "keyed_address_hash.hpp"
+
+#include <random>
+
+using namespace setka;
+
+namespace {
+constexpr auto num_ip_bytes = 16;
+constexpr auto num_port_bytes = 2;
+constexpr auto word_bytes = 8;
+
+constexpr uint64_t rotl(uint64_t x, unsigned bits) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	return (x << bits) | (x >> (64 - bits));
+}
+
+class sip_state
+{
+	std::array<uint64_t, 4> v;
+
+	void round() noexcept
+	{
+		// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+		this->v[0] += this->v[1];
+		this->v[1] = rotl(this->v[1], 13);
+		this->v[1] ^= this->v[0];
+		this->v[0] = rotl(this->v[0], 32);
+		this->v[2] += this->v[3];
+		this->v[3] = rotl(this->v[3], 16);
+		this->v[3] ^= this->v[2];
+		this->v[0] += this->v[3];
+		this->v[3] = rotl(this->v[3], 21);
+		this->v[3] ^= this->v[0];
+		this->v[2] += this->v[1];
+		this->v[1] = rotl(this->v[1], 17);
+		this->v[1] ^= this->v[2];
+		this->v[2] = rotl(this->v[2], 32);
+		// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+	}
+
+public:
+	// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+	sip_state(const keyed_address_hash::key_type& key) noexcept :
+		v({
+			{key[0] ^ 0x736f6d6570736575ULL,
+			 key[1] ^ 0x646f72616e646f6dULL,
+			 key[0] ^ 0x6c7967656e657261ULL,
+			 key[1] ^ 0x7465646279746573ULL}
+		})
+	{}
+
+	// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+	void compress(uint64_t m) noexcept
+	{
+		this->v[3] ^= m;
+		this->round();
+		this->round();
+		this->v[0] ^= m;
+	}
+
+	uint64_t finalize() noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		this->v[2] ^= 0xff;
+		this->round();
+		this->round();
+		this->round();
+		this->round();
+		return this->v[0] ^ this->v[1] ^ this->v[2] ^ this->v[3];
+	}
+};
+
+// reads up to 8 bytes as little-endian number
+uint64_t read_word(utki::span<const uint8_t> bytes) noexcept
+{
+	uint64_t ret = 0;
+	for (size_t i = bytes.size(); i != 0;) {
+		--i;
+		ret = (ret << utki::byte_bits) | bytes[i];
+	}
+	return ret;
+}
+
+template <size_t size>
+uint64_t sip_hash(const keyed_address_hash::key_type& key, const std::array<uint8_t, size>& data) noexcept
+{
+	return keyed_address_hash::sip_hash(key, utki::make_span(data));
+}
+
+template <size_t size>
+void write_ip(std::array<uint8_t, size>& bytes, const address::ip& h) noexcept
+{
+	static_assert(size >= num_ip_bytes, "buffer too small");
+	for (size_t i = 0; i != num_ip_bytes; ++i) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		bytes[i] = uint8_t(h.quad[i / 4] >> (utki::byte_bits * (3 - i % 4)));
+	}
+}
+} // namespace
+
+keyed_address_hash::keyed_address_hash()
+{
+	std::random_device rd;
+	for (auto& k : this->key) {
+		// std::random_device produces 32-bit numbers
+		constexpr auto half_bits = 32;
+		k = (uint64_t(rd()) << half_bits) | uint64_t(rd());
+	}
+}
+
+uint64_t keyed_address_hash::sip_hash(const key_type& key, utki::span<const uint8_t> data) noexcept
+{
+	sip_state state(key);
+
+	auto tail = data;
+	for (; tail.size() >= word_bytes; tail = tail.subspan(word_bytes)) {
+		state.compress(read_word(tail.subspan(0, word_bytes)));
+	}
+
+	// last block holds remaining bytes and the data length in the highest byte
+	constexpr auto length_shift = 56;
+	state.compress(read_word(tail) | (uint64_t(data.size()) << length_shift));
+
+	return state.finalize();
+}
+
+size_t keyed_address_hash::operator()(const address::ip& h) const noexcept
+{
+	std::array<uint8_t, num_ip_bytes> bytes{};
+	write_ip(bytes, h);
+	return size_t(::sip_hash(this->key, bytes));
+}
+
+size_t keyed_address_hash::operator()(const address& a) const noexcept
+{
+	std::array<uint8_t, num_ip_bytes + num_port_bytes> bytes{};
+	write_ip(bytes, a.host);
+	bytes[num_ip_bytes] = uint8_t(a.port >> utki::byte_bits);
+	bytes[num_ip_bytes + 1] = uint8_t(a.port & utki::byte_mask);
+	return size_t(::sip_hash(this->key, bytes));
+}
@@ -0,0 +1,93 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <utki/span.hpp>
+
+#include "address.hpp"
+
+namespace setka {
+
+/**
+ * @brief Keyed hash function for IP addresses.
+ * The hash function is SipHash-2-4 keyed with a secret 128-bit key. Unlike std::hash<setka::address>,
+ * hash values cannot be predicted without knowing the key, so that a remote peer is not able to
+ * choose addresses colliding in a hash table. Use it for hash tables keyed by addresses of untrusted peers,
+ * e.g. as a hasher of std::unordered_map. It is the default hasher of setka::address_map.
+ */
+class keyed_address_hash
+{
+public:
+	using key_type = std::array<uint64_t, 2>;
+
+private:
+	key_type key;
+
+public:
+	/**
+	 * @brief Create hash function with random key.
+	 * The key is generated with std::random_device.
+	 */
+	keyed_address_hash();
+
+	/**
+	 * @brief Create hash function with given key.
+	 * @param key - secret key.
+	 */
+	explicit keyed_address_hash(const key_type& key) noexcept :
+		key(key)
+	{}
+
+	/**
+	 * @brief Calculate hash value of IP host address.
+	 * The address is hashed as 16 bytes in network byte order.
+	 * @param h - IP host address.
+	 * @return hash value.
+	 */
+	size_t operator()(const address::ip& h) const noexcept;
+
+	/**
+	 * @brief Calculate hash value of IP address.
+	 * The address is hashed as 16 bytes of the host followed by 2 bytes of the port, in network byte order.
+	 * @param a - IP address.
+	 * @return hash value.
+	 */
+	size_t operator()(const address& a) const noexcept;
+
+	/**
+	 * @brief Calculate SipHash-2-4 of arbitrary data.
+	 * @param key - 128-bit key, key[0] holds first 8 key bytes in little-endian byte order, key[1] holds last 8 bytes.
+	 * @param data - data to calculate hash value of.
+	 * @return 64-bit hash value.
+	 */
+	static uint64_t sip_hash(const key_type& key, utki::span<const uint8_t> data) noexcept;
+};
+
+} // namespace setka
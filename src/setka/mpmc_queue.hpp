@@ -0,0 +1,149 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace setka {
+
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer queue.
+ * The queue has fixed capacity, all memory is allocated on construction,
+ * so pushing and popping never allocate memory and never block.
+ * Based on the bounded MPMC queue algorithm by Dmitry Vyukov.
+ * @tparam T - type of queue elements, must be default-constructible and move-assignable.
+ */
+template <typename T>
+class mpmc_queue
+{
+	struct cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::vector<cell> cells;
+	size_t mask;
+
+	// producers and consumers positions are on separate cache lines to avoid false sharing
+	constexpr static const size_t cache_line_size = 64;
+	alignas(cache_line_size) std::atomic<size_t> push_pos{0};
+	alignas(cache_line_size) std::atomic<size_t> pop_pos{0};
+
+public:
+	/**
+	 * @brief Create queue.
+	 * @param capacity - maximum number of elements in the queue, must be a power of 2 and not less than 2.
+	 */
+	mpmc_queue(size_t capacity) :
+		cells(capacity),
+		mask(capacity - 1)
+	{
+		if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+			throw std::invalid_argument("mpmc_queue::mpmc_queue(): capacity is not a power of 2");
+		}
+
+		for (size_t i = 0; i != capacity; ++i) {
+			this->cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	mpmc_queue(const mpmc_queue&) = delete;
+	mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+	mpmc_queue(mpmc_queue&&) = delete;
+	mpmc_queue& operator=(mpmc_queue&&) = delete;
+
+	~mpmc_queue() = default;
+
+	size_t capacity() const noexcept
+	{
+		return this->cells.size();
+	}
+
+	/**
+	 * @brief Push element to the queue.
+	 * Thread-safe.
+	 * @param value - element to push. It is moved from only if pushed successfully.
+	 * @return true if the element was pushed.
+	 * @return false if the queue is full.
+	 */
+	bool push(T&& value)
+	{
+		size_t pos = this->push_pos.load(std::memory_order_relaxed);
+		while (true) {
+			auto& c = this->cells[pos & this->mask];
+			size_t seq = c.sequence.load(std::memory_order_acquire);
+			auto diff = ptrdiff_t(seq) - ptrdiff_t(pos);
+			if (diff == 0) {
+				if (this->push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					c.value = std::move(value);
+					c.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// the cell is not yet popped since previous lap
+				return false;
+			} else {
+				pos = this->push_pos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * @brief Pop element from the queue.
+	 * Thread-safe.
+	 * @return popped element.
+	 * @return empty optional if the queue is empty.
+	 */
+	std::optional<T> pop()
+	{
+		size_t pos = this->pop_pos.load(std::memory_order_relaxed);
+		while (true) {
+			auto& c = this->cells[pos & this->mask];
+			size_t seq = c.sequence.load(std::memory_order_acquire);
+			auto diff = ptrdiff_t(seq) - ptrdiff_t(pos + 1);
+			if (diff == 0) {
+				if (this->pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					std::optional<T> ret(std::move(c.value));
+					c.sequence.store(pos + this->mask + 1, std::memory_order_release);
+					return ret;
+				}
+			} else if (diff < 0) {
+				// the cell is not yet pushed
+				return {};
+			} else {
+				pos = this->pop_pos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+} // namespace setka
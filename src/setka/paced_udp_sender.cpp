@@ -0,0 +1,157 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "paced_udp_sender.hpp"
+
+#include <limits>
+
+#include <utki/debug.hpp>
+
+using namespace setka;
+
+namespace {
+// with kernel pacing, datagrams are handed over to the OS this long before their transmit time
+constexpr std::chrono::milliseconds kernel_pacing_horizon(100);
+} // namespace
+
+paced_udp_sender::paced_udp_sender(udp_socket&& socket, uint64_t bytes_per_second, size_t burst_size, pacing method) :
+	socket(std::move(socket)),
+	cur_pacing(pacing::user_space),
+	rate(bytes_per_second),
+	burst_size(burst_size),
+	next_send_time(clock::now())
+{
+	if (bytes_per_second == 0) {
+		throw std::invalid_argument("paced_udp_sender::paced_udp_sender(): rate is 0");
+	}
+
+	if (burst_size > max_burst_size) {
+		throw std::invalid_argument("paced_udp_sender::paced_udp_sender(): burst size is too big");
+	}
+
+	if (method == pacing::kernel) {
+		try {
+			this->socket.enable_scheduled_transmission();
+			this->socket.set_max_pacing_rate(bytes_per_second);
+			this->cur_pacing = pacing::kernel;
+		} catch (std::runtime_error&) {
+			// kernel pacing is not supported, fall back to user space pacing
+		}
+	}
+}
+
+void paced_udp_sender::set_rate(uint64_t bytes_per_second)
+{
+	if (bytes_per_second == 0) {
+		throw std::invalid_argument("paced_udp_sender::set_rate(): rate is 0");
+	}
+
+	if (this->cur_pacing == pacing::kernel) {
+		this->socket.set_max_pacing_rate(bytes_per_second);
+	}
+
+	this->rate = bytes_per_second;
+}
+
+paced_udp_sender::clock::duration paced_udp_sender::get_transmission_duration(size_t size) const noexcept
+{
+	using std::chrono::nanoseconds;
+
+	// size is either a datagram size or the burst size, both are not bigger than max_burst_size,
+	// so the multiplication does not overflow
+	ASSERT(size <= max_burst_size)
+	return std::chrono::duration_cast<clock::duration>(
+		nanoseconds(uint64_t(size) * std::nano::den / this->rate)
+	);
+}
+
+void paced_udp_sender::send(utki::span<const uint8_t> buf, const address& destination_address)
+{
+	this->queue.push_back(datagram{std::vector<uint8_t>(buf.begin(), buf.end()), destination_address});
+}
+
+void paced_udp_sender::update()
+{
+	auto now = clock::now();
+
+	// do not accumulate sending credit beyond the burst size while idling
+	auto earliest = now - this->get_transmission_duration(this->burst_size);
+	if (this->next_send_time < earliest) {
+		this->next_send_time = earliest;
+	}
+
+	while (!this->queue.empty()) {
+		const auto& d = this->queue.front();
+
+		size_t num_sent = 0;
+		if (this->cur_pacing == pacing::kernel) {
+			if (this->next_send_time > now + kernel_pacing_horizon) {
+				break;
+			}
+			auto transmit_time = std::max(this->next_send_time, now);
+			num_sent = this->socket.send_at(
+				d.data,
+				d.destination,
+				uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(transmit_time.time_since_epoch()).count())
+			);
+		} else {
+			if (this->next_send_time > now) {
+				break;
+			}
+			num_sent = this->socket.send(d.data, d.destination);
+		}
+
+		if (num_sent == 0) {
+			// socket's send buffer is full
+			break;
+		}
+
+		this->next_send_time += this->get_transmission_duration(d.data.size());
+		this->queue.pop_front();
+	}
+}
+
+uint32_t paced_udp_sender::get_timeout_ms() const noexcept
+{
+	if (this->queue.empty()) {
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	auto due_time = this->next_send_time;
+	if (this->cur_pacing == pacing::kernel) {
+		due_time -= kernel_pacing_horizon;
+	}
+
+	auto now = clock::now();
+	if (due_time <= now) {
+		return 0;
+	}
+
+	// round up, so that the datagram is due when the timeout expires
+	auto timeout = std::chrono::ceil<std::chrono::milliseconds>(due_time - now);
+
+	return uint32_t(std::min(timeout.count(), std::chrono::milliseconds::rep(std::numeric_limits<uint32_t>::max())));
+}
@@ -0,0 +1,201 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#include "address.hpp"
+#include "udp_socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief UDP sender which spreads datagrams in time according to a target rate.
+ * Sending a burst of datagrams at once, e.g. a whole video frame, overflows buffers of network devices
+ * along the path and causes losses. The paced sender queues the datagrams and transmits them evenly
+ * at the target rate instead.
+ *
+ * Two pacing methods are available:
+ * - user space pacing, datagrams are sent by update() when their time comes;
+ * - kernel pacing, datagrams are handed to the OS in advance along with their transmit times (SO_TXTIME),
+ *   and the OS transmits them at those times. This requires fq or etf queueing discipline
+ *   on the outgoing network interface, otherwise the datagrams are sent right away. Only supported on Linux.
+ *
+ * The sender does not create threads, it is driven by the user's loop. The update() is to be called
+ * each time the timeout returned by get_timeout_ms() expires. Usage:
+ * @code{.cpp}
+ * setka::paced_udp_sender sender(setka::udp_socket(0), 1000000); // 1 MB/s
+ * sender.send(datagram, setka::address("127.0.0.1", 1234));
+ * while(!sender.is_send_complete()){
+ *     std::this_thread::sleep_for(std::chrono::milliseconds(sender.get_timeout_ms()));
+ *     sender.update();
+ * }
+ * @endcode
+ */
+class paced_udp_sender
+{
+public:
+	/**
+	 * @brief Pacing method.
+	 */
+	enum class pacing {
+		user_space,
+		kernel
+	};
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	udp_socket socket;
+
+	pacing cur_pacing;
+
+	uint64_t rate;
+	size_t burst_size;
+
+	struct datagram {
+		std::vector<uint8_t> data;
+		address destination;
+	};
+
+	std::deque<datagram> queue;
+
+	// time when the next datagram is due
+	clock::time_point next_send_time;
+
+public:
+	/**
+	 * @brief Maximum burst size.
+	 */
+	constexpr static const size_t max_burst_size = std::numeric_limits<uint32_t>::max();
+
+	/**
+	 * @brief Create paced sender.
+	 * If kernel pacing is requested, but is not supported by the OS, then user space pacing is used,
+	 * see get_pacing(). With kernel pacing, the socket's SO_MAX_PACING_RATE is also set to the target rate.
+	 * @param socket - UDP socket to send datagrams with.
+	 * @param bytes_per_second - target rate in bytes per second, must not be 0.
+	 * @param burst_size - number of bytes which can be sent at once after a period of idling,
+	 *                     must not be bigger than max_burst_size.
+	 * @param method - requested pacing method.
+	 * @throw std::invalid_argument - if rate is 0 or burst size is too big.
+	 */
+	paced_udp_sender(
+		udp_socket&& socket,
+		uint64_t bytes_per_second,
+		size_t burst_size = 0,
+		pacing method = pacing::user_space
+	);
+
+	paced_udp_sender(const paced_udp_sender&) = delete;
+	paced_udp_sender& operator=(const paced_udp_sender&) = delete;
+
+	paced_udp_sender(paced_udp_sender&&) = default;
+	paced_udp_sender& operator=(paced_udp_sender&&) = default;
+
+	~paced_udp_sender() = default;
+
+	/**
+	 * @brief Get the underlying socket.
+	 * @return reference to the socket.
+	 */
+	udp_socket& get_socket() noexcept
+	{
+		return this->socket;
+	}
+
+	/**
+	 * @brief Get pacing method in use.
+	 * @return pacing method.
+	 */
+	pacing get_pacing() const noexcept
+	{
+		return this->cur_pacing;
+	}
+
+	/**
+	 * @brief Set target rate.
+	 * @param bytes_per_second - target rate in bytes per second, must not be 0.
+	 */
+	void set_rate(uint64_t bytes_per_second);
+
+	uint64_t get_rate() const noexcept
+	{
+		return this->rate;
+	}
+
+	/**
+	 * @brief Queue datagram for sending.
+	 * The datagram is sent by this or subsequent calls to update().
+	 * @param buf - datagram to send.
+	 * @param destination_address - the destination IP address to send the datagram to.
+	 */
+	void send(utki::span<const uint8_t> buf, const address& destination_address);
+
+	/**
+	 * @brief Send queued datagrams which are due.
+	 */
+	void update();
+
+	/**
+	 * @brief Get time until the next call to update() is needed.
+	 * If the socket's send buffer is full, then 0 is returned while there are due datagrams,
+	 * in that case it is better to wait for the socket to become ready for writing.
+	 * @return timeout in milliseconds. If there are no queued datagrams, then maximum uint32_t value.
+	 */
+	uint32_t get_timeout_ms() const noexcept;
+
+	/**
+	 * @brief Get number of queued datagrams.
+	 * @return number of datagrams waiting to be handed over to the OS.
+	 */
+	size_t get_queue_size() const noexcept
+	{
+		return this->queue.size();
+	}
+
+	/**
+	 * @brief Check if all queued datagrams have been handed over to the OS.
+	 * @return true if the queue is empty.
+	 */
+	bool is_send_complete() const noexcept
+	{
+		return this->queue.empty();
+	}
+
+private:
+	clock::duration get_transmission_duration(size_t size) const noexcept;
+};
+
+} // namespace setka
@@ -0,0 +1,177 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "packet_capture_socket.hpp"
+
+#if CFG_OS == CFG_OS_LINUX
+
+#	include <algorithm>
+
+#	include <arpa/inet.h>
+#	include <linux/if_ether.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+
+using namespace setka;
+
+namespace {
+// nominal frame size, in TPACKET_V3 frames are of variable size and are packed in blocks,
+// the value is only used to calculate total number of frames in the ring
+constexpr size_t frame_size = 2048;
+} // namespace
+
+packet_capture_socket::packet_capture_socket(
+	unsigned interface_index,
+	size_t block_size,
+	size_t num_blocks,
+	uint32_t block_timeout_ms
+)
+{
+	if (num_blocks == 0) {
+		throw std::invalid_argument("packet_capture_socket::packet_capture_socket(): number of blocks is 0");
+	}
+
+	auto page_size = size_t(sysconf(_SC_PAGESIZE));
+	block_size = std::max(((block_size + page_size - 1) / page_size) * page_size, page_size);
+
+	this->handle = ::socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (this->handle == invalid_socket) {
+		throw std::system_error(errno, std::generic_category(), "couldn't create packet socket, socket() failed");
+	}
+
+	try {
+		int version = TPACKET_V3;
+		if (setsockopt(this->handle, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+			throw std::system_error(
+				errno,
+				std::generic_category(),
+				"could not set packet socket version, setsockopt(PACKET_VERSION) failed"
+			);
+		}
+
+		tpacket_req3 req{};
+		req.tp_block_size = unsigned(block_size);
+		req.tp_block_nr = unsigned(num_blocks);
+		req.tp_frame_size = unsigned(frame_size);
+		req.tp_frame_nr = unsigned(block_size / frame_size * num_blocks);
+		req.tp_retire_blk_tov = block_timeout_ms;
+
+		if (setsockopt(this->handle, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+			throw std::system_error(
+				errno,
+				std::generic_category(),
+				"could not create packet ring, setsockopt(PACKET_RX_RING) failed"
+			);
+		}
+
+		size_t ring_size = block_size * num_blocks;
+
+		void* addr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, this->handle, 0);
+		if (addr == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "could not map packet ring, mmap() failed");
+		}
+
+		this->ring = utki::span<uint8_t>(static_cast<uint8_t*>(addr), ring_size);
+		this->block_size = block_size;
+		this->num_blocks = num_blocks;
+
+		sockaddr_ll sa{};
+		sa.sll_family = AF_PACKET;
+		sa.sll_protocol = htons(ETH_P_ALL);
+		sa.sll_ifindex = int(interface_index);
+
+		if (::bind(
+				this->handle,
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				reinterpret_cast<sockaddr*>(&sa),
+				sizeof(sa)
+			) != 0)
+		{
+			throw std::system_error(
+				errno,
+				std::generic_category(),
+				"could not bind packet socket to network interface, bind() failed"
+			);
+		}
+
+		this->set_nonblocking_mode();
+	} catch (...) {
+		if (!this->ring.empty()) {
+			munmap(this->ring.data(), this->ring.size());
+		}
+		this->close();
+		throw;
+	}
+}
+
+packet_capture_socket::~packet_capture_socket() noexcept
+{
+	if (!this->ring.empty()) {
+		munmap(this->ring.data(), this->ring.size());
+	}
+}
+
+tpacket_block_desc* packet_capture_socket::get_block_desc(size_t index) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	return reinterpret_cast<tpacket_block_desc*>(this->ring.data() + index * this->block_size);
+}
+
+packet_capture_socket::block packet_capture_socket::get_block()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("packet_capture_socket::get_block(): socket is empty");
+	}
+
+	this->release_block();
+
+	auto desc = this->get_block_desc(this->current_block);
+
+	// the block status is written by the kernel after filling the block
+	if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+		return {};
+	}
+
+	this->block_taken = true;
+	return {desc};
+}
+
+void packet_capture_socket::release_block() noexcept
+{
+	if (!this->block_taken) {
+		return;
+	}
+
+	auto desc = this->get_block_desc(this->current_block);
+
+	// hand the block back to the kernel
+	__atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+
+	this->block_taken = false;
+	this->current_block = (this->current_block + 1) % this->num_blocks;
+}
+
+#endif
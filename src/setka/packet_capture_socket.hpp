@@ -0,0 +1,258 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <utki/config.hpp>
+
+#if CFG_OS == CFG_OS_LINUX
+
+#	include <cstdint>
+#	include <iterator>
+
+#	include <linux/if_packet.h>
+#	include <utki/span.hpp>
+#	include <utki/types.hpp>
+
+#	include "socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief Packet capture socket.
+ * Link layer packet socket (AF_PACKET) which receives all frames passing through a network interface
+ * into a memory-mapped ring buffer (TPACKET_V3) shared with the kernel.
+ * The kernel fills the ring with blocks of frames, and the user reads whole blocks of frames
+ * without making a system call per frame, which allows capturing at very high packet rates.
+ * The socket can be added to opros::wait_set, it becomes ready to read when there is a filled block
+ * available, or when the block timeout expires and a partially filled block is passed to the user.
+ * Creating the socket requires CAP_NET_RAW capability.
+ * Only available on Linux.
+ */
+class packet_capture_socket : public socket
+{
+	utki::span<uint8_t> ring;
+	size_t block_size = 0;
+	size_t num_blocks = 0;
+
+	size_t current_block = 0;
+	bool block_taken = false;
+
+public:
+	constexpr static const size_t default_block_size = utki::kilobyte * utki::kilobyte;
+	constexpr static const size_t default_num_blocks = 64;
+	constexpr static const uint32_t default_block_timeout_ms = 10;
+
+	/**
+	 * @brief Create and open the socket.
+	 * @param interface_index - index of the network interface to capture frames from,
+	 *                          0 means capturing from all interfaces.
+	 * @param block_size - size of one ring block in bytes, rounded up to a multiple of memory page size.
+	 *                     Frames bigger than the block cannot be captured.
+	 * @param num_blocks - number of blocks in the ring.
+	 * @param block_timeout_ms - timeout after which a partially filled block is passed to the user, in milliseconds.
+	 */
+	packet_capture_socket(
+		unsigned interface_index,
+		size_t block_size = default_block_size,
+		size_t num_blocks = default_num_blocks,
+		uint32_t block_timeout_ms = default_block_timeout_ms
+	);
+
+	packet_capture_socket(const packet_capture_socket&) = delete;
+	packet_capture_socket& operator=(const packet_capture_socket&) = delete;
+
+	packet_capture_socket(packet_capture_socket&&) = delete;
+	packet_capture_socket& operator=(packet_capture_socket&&) = delete;
+
+	~packet_capture_socket() noexcept;
+
+	/**
+	 * @brief Captured frame.
+	 */
+	struct frame {
+		/**
+		 * @brief Frame data, starting from the link layer header.
+		 */
+		utki::span<const uint8_t> data;
+
+		/**
+		 * @brief Original size of the frame.
+		 * Can be bigger than the captured data size if the frame did not fit the ring block.
+		 */
+		size_t original_size = 0;
+
+		/**
+		 * @brief Capture timestamp, seconds part.
+		 */
+		uint32_t seconds = 0;
+
+		/**
+		 * @brief Capture timestamp, nanoseconds part.
+		 */
+		uint32_t nanoseconds = 0;
+	};
+
+	/**
+	 * @brief Block of captured frames.
+	 * Range of frames in one ring block.
+	 */
+	class block
+	{
+		friend class packet_capture_socket;
+
+		const tpacket_block_desc* desc = nullptr;
+
+		block() = default;
+
+		block(const tpacket_block_desc* desc) :
+			desc(desc)
+		{}
+
+	public:
+		class iterator
+		{
+			friend class block;
+
+			const tpacket3_hdr* hdr;
+			uint32_t num_left;
+
+			iterator(const tpacket3_hdr* hdr, uint32_t num_left) :
+				hdr(hdr),
+				num_left(num_left)
+			{}
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = frame;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
+
+			value_type operator*() const noexcept
+			{
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				auto p = reinterpret_cast<const uint8_t*>(this->hdr);
+				return {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					utki::make_span(p + this->hdr->tp_mac, this->hdr->tp_snaplen),
+					this->hdr->tp_len,
+					this->hdr->tp_sec,
+					this->hdr->tp_nsec
+				};
+			}
+
+			iterator& operator++() noexcept
+			{
+				--this->num_left;
+				if (this->num_left == 0) {
+					this->hdr = nullptr;
+				} else {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+					auto p = reinterpret_cast<const uint8_t*>(this->hdr);
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					this->hdr = reinterpret_cast<const tpacket3_hdr*>(p + this->hdr->tp_next_offset);
+				}
+				return *this;
+			}
+
+			iterator operator++(int) noexcept
+			{
+				auto ret = *this;
+				this->operator++();
+				return ret;
+			}
+
+			bool operator==(const iterator& i) const noexcept
+			{
+				return this->hdr == i.hdr;
+			}
+
+			bool operator!=(const iterator& i) const noexcept
+			{
+				return !this->operator==(i);
+			}
+		};
+
+		/**
+		 * @brief Get number of frames in the block.
+		 * @return number of frames.
+		 */
+		size_t size() const noexcept
+		{
+			if (!this->desc) {
+				return 0;
+			}
+			return this->desc->hdr.bh1.num_pkts;
+		}
+
+		bool empty() const noexcept
+		{
+			return this->size() == 0;
+		}
+
+		iterator begin() const noexcept
+		{
+			if (this->empty()) {
+				return this->end();
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto p = reinterpret_cast<const uint8_t*>(this->desc);
+			return {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				reinterpret_cast<const tpacket3_hdr*>(p + this->desc->hdr.bh1.offset_to_first_pkt),
+				this->desc->hdr.bh1.num_pkts
+			};
+		}
+
+		iterator end() const noexcept
+		{
+			return {nullptr, 0};
+		}
+	};
+
+	/**
+	 * @brief Get next block of captured frames.
+	 * Does not block. If there is no filled block available, then empty block is returned.
+	 * The returned block stays valid until release_block() is called. Calling get_block()
+	 * releases the block returned by the previous call.
+	 * @return block of captured frames.
+	 */
+	block get_block();
+
+	/**
+	 * @brief Return the block obtained with get_block() to the kernel.
+	 * After releasing, the kernel can fill the block with new frames.
+	 */
+	void release_block() noexcept;
+
+private:
+	tpacket_block_desc* get_block_desc(size_t index) noexcept;
+};
+
+} // namespace setka
+
+#endif
@@ -0,0 +1,374 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "prefix_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+
+#include <utki/config.hpp>
+#include <utki/debug.hpp>
+
+using namespace setka;
+
+namespace {
+constexpr unsigned direct_bits = 18;
+constexpr size_t direct_size = size_t(1) << direct_bits;
+
+constexpr unsigned stride = 6;
+constexpr size_t fanout = size_t(1) << stride;
+
+constexpr unsigned word_bits = 64;
+
+unsigned popcount(uint64_t x) noexcept
+{
+#if CFG_COMPILER == CFG_COMPILER_GCC || CFG_COMPILER == CFG_COMPILER_CLANG
+	return unsigned(__builtin_popcountll(x));
+#else
+	return unsigned(std::bitset<word_bits>(x).count());
+#endif
+}
+
+void prefetch([[maybe_unused]] const void* p) noexcept
+{
+#if CFG_COMPILER == CFG_COMPILER_GCC || CFG_COMPILER == CFG_COMPILER_CLANG
+	__builtin_prefetch(p);
+#endif
+}
+
+// extracts 'num_bits' bits starting from 'offset' bit, counting from the highest bit,
+// bits beyond the key are zeroes
+template <typename key_type>
+uint32_t extract(const key_type& k, unsigned offset, unsigned num_bits) noexcept
+{
+	ASSERT(num_bits != 0 && num_bits <= direct_bits)
+	if (offset + num_bits <= word_bits) {
+		return uint32_t((k.high << offset) >> (word_bits - num_bits));
+	}
+	if (offset >= word_bits) {
+		return uint32_t((k.low << (offset - word_bits)) >> (word_bits - num_bits));
+	}
+	unsigned num_high_bits = word_bits - offset;
+	unsigned num_low_bits = num_bits - num_high_bits;
+	return (uint32_t((k.high << offset) >> (word_bits - num_high_bits)) << num_low_bits) |
+		uint32_t(k.low >> (word_bits - num_low_bits));
+}
+
+// fills slots of the expanded prefixes, longer prefixes overwrite shorter ones
+template <typename prefix_type, size_t size>
+void expand(
+	std::array<uint32_t, size>& values,
+	std::vector<const prefix_type*>& prefixes,
+	unsigned offset,
+	unsigned num_bits
+)
+{
+	std::stable_sort(prefixes.begin(), prefixes.end(), [](const auto& a, const auto& b) {
+		return a->length < b->length;
+	});
+	for (const auto& p : prefixes) {
+		ASSERT(p->length > offset || offset == 0)
+		ASSERT(p->length <= offset + num_bits)
+		auto first = extract(p->key, offset, num_bits);
+		auto count = size_t(1) << (offset + num_bits - p->length);
+		std::fill_n(std::next(values.begin(), ptrdiff_t(first)), count, p->value);
+	}
+}
+} // namespace
+
+prefix_table::trie_key prefix_table::to_key(const address::ip& h) noexcept
+{
+	if (h.is_v4()) {
+		return {uint64_t(h.get_v4()) << (word_bits / 2), 0};
+	}
+	return {
+		(uint64_t(h.quad[0]) << (word_bits / 2)) | h.quad[1],
+		(uint64_t(h.quad[2]) << (word_bits / 2)) | h.quad[3]
+	};
+}
+
+void prefix_table::trie::build_node(
+	size_t node_index,
+	utki::span<const prefix> prefixes,
+	unsigned offset,
+	uint32_t inherited
+)
+{
+	// values of the node slots
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<uint32_t, fanout> values;
+	values.fill(inherited);
+
+	// prefixes which end within this node
+	std::vector<const prefix*> short_prefixes;
+
+	// prefixes which end within child nodes
+	std::vector<prefix> long_prefixes;
+
+	uint64_t children = 0;
+
+	for (const auto& p : prefixes) {
+		if (p.length <= offset + stride) {
+			short_prefixes.push_back(&p);
+		} else {
+			long_prefixes.push_back(p);
+			children |= uint64_t(1) << extract(p.key, offset, stride);
+		}
+	}
+
+	expand(values, short_prefixes, offset, stride);
+
+	node n{};
+	n.children = children;
+
+	// store leaves of slots which do not have children, consecutive equal values are stored once
+	n.first_leaf = uint32_t(this->leaves.size());
+	for (size_t i = 0; i != values.size(); ++i) {
+		auto bit = uint64_t(1) << i;
+		if (children & bit) {
+			continue;
+		}
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		if (this->leaves.size() == n.first_leaf || this->leaves.back() != values[i]) {
+			n.leaf_runs |= bit;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			this->leaves.push_back(values[i]);
+		}
+	}
+
+	// children of the node are stored contiguously
+	n.first_child = uint32_t(this->nodes.size());
+	this->nodes.resize(this->nodes.size() + popcount(children));
+
+	if (this->nodes.size() >= node_flag) {
+		throw std::length_error("prefix_table: too many prefixes");
+	}
+
+	this->nodes[node_index] = n;
+
+	auto child_index = n.first_child;
+	for (auto i = long_prefixes.begin(); i != long_prefixes.end();) {
+		auto slot = extract(i->key, offset, stride);
+		auto end = std::find_if(i, long_prefixes.end(), [&](const auto& p) {
+			return extract(p.key, offset, stride) != slot;
+		});
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		this->build_node(child_index, utki::make_span(&*i, size_t(end - i)), offset + stride, values[slot]);
+
+		++child_index;
+		i = end;
+	}
+}
+
+void prefix_table::trie::build(utki::span<const prefix> prefixes)
+{
+	this->direct.clear();
+	this->nodes.clear();
+	this->leaves.assign(1, no_value);
+
+	if (prefixes.empty()) {
+		return;
+	}
+
+	auto values = std::make_unique<std::array<uint32_t, direct_size>>();
+	values->fill(no_value);
+
+	std::vector<const prefix*> short_prefixes;
+	for (const auto& p : prefixes) {
+		if (p.length <= direct_bits) {
+			short_prefixes.push_back(&p);
+		}
+	}
+	expand(*values, short_prefixes, 0, direct_bits);
+
+	this->direct.resize(direct_size);
+
+	// prefixes are sorted, so prefixes longer than direct_bits with same first bits go one after another
+	auto long_prefix = prefixes.begin();
+	for (size_t i = 0; i != direct_size; ++i) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		auto value = (*values)[i];
+
+		for (; long_prefix != prefixes.end() && long_prefix->length <= direct_bits; ++long_prefix) {
+		}
+
+		auto end = long_prefix;
+		for (; end != prefixes.end() && extract(end->key, 0, direct_bits) == i; ++end) {
+		}
+
+		if (end == long_prefix) {
+			if (this->leaves.back() != value || this->leaves.size() == 1) {
+				this->leaves.push_back(value);
+			}
+			this->direct[i] = uint32_t(this->leaves.size() - 1);
+			continue;
+		}
+
+		std::vector<prefix> node_prefixes;
+		std::copy_if(long_prefix, end, std::back_inserter(node_prefixes), [](const auto& p) {
+			return p.length > direct_bits;
+		});
+
+		auto node_index = this->nodes.size();
+		this->nodes.emplace_back();
+		this->build_node(node_index, node_prefixes, direct_bits, value);
+		this->direct[i] = uint32_t(node_index) | node_flag;
+
+		long_prefix = end;
+	}
+}
+
+const void* prefix_table::trie::get_direct_entry(const trie_key& k) const noexcept
+{
+	if (this->direct.empty()) {
+		return this->leaves.data();
+	}
+	return &this->direct[extract(k, 0, direct_bits)];
+}
+
+bool prefix_table::trie::lookup_direct(const trie_key& k, uint32_t& out_index) const noexcept
+{
+	if (this->direct.empty()) {
+		out_index = 0;
+		return true;
+	}
+
+	auto entry = this->direct[extract(k, 0, direct_bits)];
+	out_index = entry & ~node_flag;
+	return (entry & node_flag) == 0;
+}
+
+uint32_t prefix_table::trie::lookup_nodes(const trie_key& k, uint32_t node_index) const noexcept
+{
+	for (unsigned offset = direct_bits;; offset += stride) {
+		ASSERT(node_index < this->nodes.size())
+		const auto& n = this->nodes[node_index];
+		auto bit = uint64_t(1) << extract(k, offset, stride);
+
+		if (n.children & bit) {
+			node_index = n.first_child + popcount(n.children & (bit - 1));
+			continue;
+		}
+
+		// leaf slot is within the run started by the last set bit of leaf_runs up to the slot
+		return this->leaves[n.first_leaf + popcount(n.leaf_runs & ((bit << 1) - 1)) - 1];
+	}
+}
+
+uint32_t prefix_table::trie::lookup(const trie_key& k) const noexcept
+{
+	uint32_t index = 0;
+	if (this->lookup_direct(k, index)) {
+		return this->leaves[index];
+	}
+	return this->lookup_nodes(k, index);
+}
+
+void prefix_table::insert(const subnet& s, uint32_t value)
+{
+	if (value == no_value) {
+		throw std::invalid_argument("prefix_table::insert(): value must not be no_value");
+	}
+	this->prefixes[s] = value;
+}
+
+bool prefix_table::erase(const subnet& s)
+{
+	return this->prefixes.erase(s) != 0;
+}
+
+void prefix_table::clear() noexcept
+{
+	this->prefixes.clear();
+}
+
+void prefix_table::build()
+{
+	// subnets are ordered by address and then by prefix length, so prefixes are sorted by key
+	std::vector<trie::prefix> ip_v4_prefixes;
+	std::vector<trie::prefix> ip_v6_prefixes;
+
+	for (const auto& p : this->prefixes) {
+		auto& v = p.first.is_v4() ? ip_v4_prefixes : ip_v6_prefixes;
+		v.push_back({to_key(p.first.get_host()), p.first.get_prefix_length(), p.second});
+	}
+
+	this->ip_v4_trie.build(ip_v4_prefixes);
+	this->ip_v6_trie.build(ip_v6_prefixes);
+}
+
+uint32_t prefix_table::lookup(const address::ip& h) const noexcept
+{
+	const auto& t = h.is_v4() ? this->ip_v4_trie : this->ip_v6_trie;
+	return t.lookup(to_key(h));
+}
+
+void prefix_table::lookup(utki::span<const address::ip> hosts, utki::span<uint32_t> out_values) const
+{
+	if (hosts.size() != out_values.size()) {
+		throw std::invalid_argument("prefix_table::lookup(): hosts and out_values sizes differ");
+	}
+
+	// process addresses in groups, doing each lookup step for all addresses of a group,
+	// so that memory accesses of different addresses overlap
+	constexpr size_t group_size = 8;
+
+	std::array<trie_key, group_size> keys{};
+	std::array<const trie*, group_size> tries{};
+	std::array<uint32_t, group_size> indices{};
+	std::array<bool, group_size> done{};
+
+	for (size_t first = 0; first < hosts.size(); first += group_size) {
+		size_t size = std::min(group_size, hosts.size() - first);
+
+		for (size_t i = 0; i != size; ++i) {
+			// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+			const auto& h = hosts[first + i];
+			tries[i] = h.is_v4() ? &this->ip_v4_trie : &this->ip_v6_trie;
+			keys[i] = to_key(h);
+			prefetch(tries[i]->get_direct_entry(keys[i]));
+			// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+		}
+
+		for (size_t i = 0; i != size; ++i) {
+			// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+			done[i] = tries[i]->lookup_direct(keys[i], indices[i]);
+			if (!done[i]) {
+				prefetch(tries[i]->get_node(indices[i]));
+			}
+			// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+		}
+
+		for (size_t i = 0; i != size; ++i) {
+			// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+			out_values[first + i] = done[i] ? tries[i]->get_leaf(indices[i])
+											: tries[i]->lookup_nodes(keys[i], indices[i]);
+			// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+		}
+	}
+}
@@ -0,0 +1,204 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <utki/span.hpp>
+
+#include "subnet.hpp"
+
+namespace setka {
+
+/**
+ * @brief Longest prefix match table.
+ * The table maps subnets to user defined 32-bit values and finds the value of the longest subnet
+ * containing a given address, e.g. for per-packet routing or access control decisions.
+ *
+ * Lookup structure is a compressed multibit trie (poptrie): the first 18 bits of the address index
+ * a direct array, the following bits are consumed 6 at a time by trie nodes, which hold their children
+ * and leaves in contiguous arrays and locate them by population count of 64-bit bitmaps.
+ * So, IPv4 lookup visits at most 3 trie nodes, /24 and shorter prefixes are found within the first node,
+ * and the whole trie is compact enough to hold millions of prefixes.
+ * IPv4 and IPv6 subnets are held in separate tries, a non-empty trie takes at least 1 MiB for the direct array.
+ *
+ * Modifications of the table take effect after build() is called, which rebuilds the lookup structure.
+ * Lookups are thread safe as long as no build() is running concurrently.
+ */
+class prefix_table
+{
+public:
+	/**
+	 * @brief Value returned by lookup when no subnet matches the address.
+	 */
+	constexpr static const uint32_t no_value = ~uint32_t(0);
+
+private:
+	std::map<subnet, uint32_t> prefixes;
+
+	// address bits, IPv4 address occupies the highest 32 bits
+	struct trie_key {
+		uint64_t high;
+		uint64_t low;
+	};
+
+	class trie
+	{
+	public:
+		struct node {
+			uint64_t children; // bitmap of slots which have child nodes
+			uint64_t leaf_runs; // bitmap of slots which begin runs of equal leaf values
+			uint32_t first_leaf; // index of the first leaf of the node
+			uint32_t first_child; // index of the first child node of the node
+		};
+
+		struct prefix {
+			trie_key key;
+			unsigned length;
+			uint32_t value;
+		};
+
+	private:
+		// entry of the direct array is either an index of a leaf or an index of a node with this flag set
+		constexpr static const uint32_t node_flag = uint32_t(1) << 31;
+
+		std::vector<uint32_t> direct;
+		std::vector<node> nodes;
+
+		// first leaf is always no_value, it is used when the trie is empty
+		std::vector<uint32_t> leaves = {no_value};
+
+		void build_node(size_t node_index, utki::span<const prefix> prefixes, unsigned offset, uint32_t inherited);
+
+	public:
+		void build(utki::span<const prefix> prefixes);
+
+		uint32_t lookup(const trie_key& k) const noexcept;
+
+		// looks up first part of the key, returns true if lookup is done
+		bool lookup_direct(const trie_key& k, uint32_t& out_index) const noexcept;
+
+		// finishes lookup started with lookup_direct()
+		uint32_t lookup_nodes(const trie_key& k, uint32_t node_index) const noexcept;
+
+		uint32_t get_leaf(uint32_t index) const noexcept
+		{
+			return this->leaves[index];
+		}
+
+		const void* get_direct_entry(const trie_key& k) const noexcept;
+
+		const void* get_node(uint32_t index) const noexcept
+		{
+			return &this->nodes[index];
+		}
+
+		size_t get_memory_size() const noexcept
+		{
+			return this->direct.size() * sizeof(decltype(this->direct)::value_type) +
+				this->nodes.size() * sizeof(node) + this->leaves.size() * sizeof(uint32_t);
+		}
+	};
+
+	trie ip_v4_trie;
+	trie ip_v6_trie;
+
+	static trie_key to_key(const address::ip& h) noexcept;
+
+public:
+	prefix_table() = default;
+
+	/**
+	 * @brief Add subnet to the table.
+	 * If the subnet is already in the table, then its value is replaced.
+	 * @param s - subnet to add.
+	 * @param value - value of the subnet.
+	 * @throw std::invalid_argument - if value is no_value.
+	 */
+	void insert(const subnet& s, uint32_t value);
+
+	/**
+	 * @brief Remove subnet from the table.
+	 * @param s - subnet to remove.
+	 * @return true if the subnet was removed.
+	 * @return false if the subnet is not in the table.
+	 */
+	bool erase(const subnet& s);
+
+	/**
+	 * @brief Remove all subnets from the table.
+	 */
+	void clear() noexcept;
+
+	/**
+	 * @brief Get number of subnets in the table.
+	 * @return number of subnets.
+	 */
+	size_t size() const noexcept
+	{
+		return this->prefixes.size();
+	}
+
+	/**
+	 * @brief Rebuild lookup structure.
+	 * Makes the lookup structure reflect all modifications done to the table.
+	 * Building takes time proportional to the number of subnets in the table.
+	 */
+	void build();
+
+	/**
+	 * @brief Get memory used by the lookup structure.
+	 * @return size of the lookup structure in bytes.
+	 */
+	size_t get_memory_size() const noexcept
+	{
+		return this->ip_v4_trie.get_memory_size() + this->ip_v6_trie.get_memory_size();
+	}
+
+	/**
+	 * @brief Find value of the longest subnet containing the address.
+	 * IPv4 addresses are matched against IPv4 subnets only, IPv6 addresses are matched against IPv6 subnets only.
+	 * @param h - address to find the subnet for.
+	 * @return value of the longest subnet containing the address, as of the last build() call.
+	 * @return no_value if no subnet contains the address.
+	 */
+	uint32_t lookup(const address::ip& h) const noexcept;
+
+	/**
+	 * @brief Find values of the longest subnets containing the addresses.
+	 * Looking up many addresses at once is faster than looking up each address separately,
+	 * because memory accesses of several lookups are overlapped.
+	 * @param hosts - addresses to find the subnets for.
+	 * @param out_values - buffer to store found values to, same size as hosts, see lookup().
+	 * @throw std::invalid_argument - if sizes of hosts and out_values differ.
+	 */
+	void lookup(utki::span<const address::ip> hosts, utki::span<uint32_t> out_values) const;
+};
+
+} // namespace setka
@@ -0,0 +1,879 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "reliable_connection.hpp"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include <utki/time.hpp>
+#include <utki/util.hpp>
+
+using namespace setka;
+
+namespace {
+enum class packet_type : uint8_t {
+	syn = 1,
+	syn_ack,
+	data,
+	ack,
+	close,
+	close_ack
+};
+
+// packet type and connection id
+constexpr size_t common_header_size = 1 + 4;
+
+// packet number, stream, message number, fragment index, fragment count
+constexpr size_t data_header_size = common_header_size + 4 + 2 + 4 + 2 + 2;
+
+// cumulative acknowledgement, receive window, number of ranges
+constexpr size_t ack_header_size = common_header_size + 4 + 4 + 1;
+
+// range start and end
+constexpr size_t ack_range_size = 4 + 4;
+
+constexpr size_t max_ack_ranges = 32;
+
+constexpr size_t max_datagram_size = 0xffff;
+
+// maximum UDP payload size over IPv4
+constexpr size_t max_udp_payload_size = 65507;
+
+constexpr uint32_t initial_retransmission_timeout_ms = 200;
+constexpr uint32_t min_retransmission_timeout_ms = 20;
+constexpr uint32_t max_retransmission_timeout_ms = 2000;
+
+constexpr size_t initial_congestion_window = 10;
+constexpr size_t min_congestion_window = 2;
+
+// packet is considered lost when this many packets sent after it are acknowledged
+constexpr uint64_t reordering_threshold = 3;
+
+bool is_icmp_error(const std::system_error& e)
+{
+	// connected UDP sockets report ICMP errors caused by previously sent datagrams
+	return e.code().value() == ECONNREFUSED
+#if CFG_OS == CFG_OS_WINDOWS
+		|| e.code().value() == WSAECONNRESET
+#endif
+		;
+}
+
+uint32_t time_left(uint32_t now, uint32_t start, uint32_t duration)
+{
+	uint32_t elapsed = now - start;
+	return elapsed >= duration ? 0 : duration - elapsed;
+}
+
+// restores full packet or message number from its lower 32 bits sent over the wire,
+// the number closest to the expected one is chosen, as in RFC 9000 appendix A.3
+uint64_t expand_number(uint32_t truncated, uint64_t expected)
+{
+	constexpr uint64_t window = uint64_t(1) << 32;
+	constexpr uint64_t half_window = window / 2;
+
+	uint64_t candidate = (expected & ~(window - 1)) | truncated;
+	if (candidate + half_window <= expected) {
+		return candidate + window;
+	}
+	if (candidate > expected + half_window && candidate >= window) {
+		return candidate - window;
+	}
+	return candidate;
+}
+} // namespace
+
+reliable_connection::reliable_connection(
+	udp_socket&& socket,
+	const address& peer_address,
+	size_t max_payload_size,
+	size_t receive_window
+) :
+	socket(std::move(socket)),
+	is_server(false),
+	max_payload_size(max_payload_size),
+	receive_window(receive_window),
+	idle_start_time(utki::get_ticks_ms()),
+	retransmission_timeout_ms(initial_retransmission_timeout_ms),
+	congestion_window(initial_congestion_window),
+	peer_window(initial_congestion_window),
+	receive_buffer(max_datagram_size)
+{
+	if (max_payload_size == 0 || data_header_size + max_payload_size > max_udp_payload_size) {
+		throw std::invalid_argument("reliable_connection::reliable_connection(): invalid max payload size");
+	}
+	if (receive_window == 0) {
+		throw std::invalid_argument("reliable_connection::reliable_connection(): receive window is 0");
+	}
+
+	this->connection_id = std::random_device()();
+	this->next_packet_number = this->connection_id;
+	this->receive_next = this->connection_id;
+
+	this->socket.connect(peer_address);
+
+	this->send_control(uint8_t(packet_type::syn));
+	this->control_send_time = this->idle_start_time;
+}
+
+reliable_connection::reliable_connection(udp_socket&& socket, size_t max_payload_size, size_t receive_window) :
+	socket(std::move(socket)),
+	is_server(true),
+	max_payload_size(max_payload_size),
+	receive_window(receive_window),
+	idle_start_time(utki::get_ticks_ms()),
+	retransmission_timeout_ms(initial_retransmission_timeout_ms),
+	congestion_window(initial_congestion_window),
+	peer_window(initial_congestion_window),
+	receive_buffer(max_datagram_size)
+{
+	if (max_payload_size == 0 || data_header_size + max_payload_size > max_udp_payload_size) {
+		throw std::invalid_argument("reliable_connection::reliable_connection(): invalid max payload size");
+	}
+	if (receive_window == 0) {
+		throw std::invalid_argument("reliable_connection::reliable_connection(): receive window is 0");
+	}
+}
+
+void reliable_connection::send(uint16_t stream, utki::span<const uint8_t> data)
+{
+	if (this->cur_state == state::closed || this->cur_state == state::failed) {
+		throw std::logic_error("reliable_connection::send(): connection is closed");
+	}
+
+	size_t num_fragments = std::max(size_t(1), (data.size() + this->max_payload_size - 1) / this->max_payload_size);
+	if (num_fragments > std::numeric_limits<uint16_t>::max()) {
+		throw std::invalid_argument("reliable_connection::send(): message is too big");
+	}
+	if (num_fragments > this->receive_window) {
+		throw std::invalid_argument("reliable_connection::send(): message does not fit the receive window");
+	}
+
+	uint64_t message_number = this->next_message_numbers[stream]++;
+
+	for (size_t i = 0; i != num_fragments; ++i) {
+		auto fragment_data = data.subspan(
+			i * this->max_payload_size,
+			std::min(this->max_payload_size, data.size() - i * this->max_payload_size)
+		);
+		this->send_queue.push_back(fragment{
+			stream,
+			message_number,
+			uint16_t(i),
+			uint16_t(num_fragments),
+			std::vector<uint8_t>(fragment_data.begin(), fragment_data.end())
+		});
+	}
+}
+
+std::optional<reliable_connection::message> reliable_connection::receive()
+{
+	if (this->received_messages.empty()) {
+		return {};
+	}
+
+	bool window_was_closed = this->num_buffered_fragments >= this->receive_window;
+
+	auto m = std::move(this->received_messages.front());
+	this->received_messages.pop_front();
+
+	ASSERT(this->num_buffered_fragments >= m.num_fragments)
+	this->num_buffered_fragments -= m.num_fragments;
+
+	if (window_was_closed) {
+		// let the peer know that the window has opened
+		this->ack_pending = true;
+	}
+
+	return std::move(m.msg);
+}
+
+void reliable_connection::close()
+{
+	if (this->cur_state == state::established || (this->cur_state == state::connecting && !this->is_server)) {
+		this->send_control(uint8_t(packet_type::close));
+		this->close_pending = true;
+		this->control_send_time = utki::get_ticks_ms();
+		this->idle_start_time = this->control_send_time;
+	}
+
+	this->cur_state = state::closed;
+	this->ack_pending = false;
+
+	this->send_queue.clear();
+	this->in_flight.clear();
+	this->retransmit_queue.clear();
+	this->num_lost = 0;
+}
+
+bool reliable_connection::send_datagram(utki::span<const uint8_t> datagram)
+{
+	try {
+		return this->socket.send(datagram) != 0;
+	} catch (std::system_error& e) {
+		if (is_icmp_error(e)) {
+			return false;
+		}
+		throw;
+	}
+}
+
+void reliable_connection::send_control(uint8_t type)
+{
+	std::array<uint8_t, common_header_size> buf{};
+	buf[0] = type;
+	utki::serialize32be(this->connection_id, &buf[1]);
+
+	// control packets are not queued for retransmission, check_timers() repeats the handshake request
+	// and the close notification until the peer responds, the responses are repeated for each repeated request
+	this->send_datagram(buf);
+}
+
+void reliable_connection::retransmit_control(uint8_t type, uint32_t now)
+{
+	this->send_control(type);
+	this->control_send_time = now;
+	this->retransmission_timeout_ms = std::min(this->retransmission_timeout_ms * 2, max_retransmission_timeout_ms);
+}
+
+void reliable_connection::send_ack()
+{
+	std::array<uint8_t, ack_header_size + max_ack_ranges * ack_range_size> buf{};
+
+	uint8_t* p = buf.data();
+
+	*p = uint8_t(packet_type::ack);
+	++p; // NOLINT
+
+	utki::serialize32be(this->connection_id, p);
+	p += 4; // NOLINT
+
+	utki::serialize32be(uint32_t(this->receive_next), p);
+	p += 4; // NOLINT
+
+	size_t window =
+		this->receive_window > this->num_buffered_fragments ? this->receive_window - this->num_buffered_fragments : 0;
+	utki::serialize32be(uint32_t(window), p);
+	p += 4; // NOLINT
+
+	uint8_t& num_ranges = *p;
+	num_ranges = 0;
+	++p; // NOLINT
+
+	// selective acknowledgement ranges of packets received above the cumulative acknowledgement
+	for (auto i = this->received_above.begin(); i != this->received_above.end() && num_ranges != max_ack_ranges;) {
+		uint64_t start = *i;
+		uint64_t end = start + 1;
+		for (++i; i != this->received_above.end() && *i == end; ++i) {
+			++end;
+		}
+
+		utki::serialize32be(uint32_t(start), p);
+		p += 4; // NOLINT
+		utki::serialize32be(uint32_t(end), p);
+		p += 4; // NOLINT
+
+		++num_ranges;
+	}
+
+	ASSERT(buf.data() <= p && p <= utki::end_pointer(buf))
+
+	if (this->send_datagram(utki::make_span(buf.data(), size_t(p - buf.data())))) {
+		this->ack_pending = false;
+	}
+}
+
+bool reliable_connection::transmit(sent_packet& p, uint32_t now)
+{
+	if (!this->send_datagram(p.datagram)) {
+		return false;
+	}
+
+	p.send_time = now;
+	p.transmission_number = this->next_transmission_number++;
+	++this->stats.packets_sent;
+
+	return true;
+}
+
+bool reliable_connection::can_send_new_packet() const noexcept
+{
+	if (this->get_packets_in_flight() >= this->congestion_window) {
+		return false;
+	}
+
+	// lost packets are still to be buffered by the peer once retransmitted, so they are counted against its window
+	if (this->in_flight.size() < this->peer_window) {
+		return true;
+	}
+
+	// when the peer's window is closed, probe it with one packet at a time
+	return this->peer_window == 0 && this->in_flight.empty();
+}
+
+void reliable_connection::send_pending(uint32_t now)
+{
+	while (!this->retransmit_queue.empty()) {
+		auto i = this->in_flight.find(this->retransmit_queue.front());
+		if (i == this->in_flight.end() || !i->second.lost) {
+			// acknowledged meanwhile
+			this->retransmit_queue.pop_front();
+			continue;
+		}
+
+		if (this->get_packets_in_flight() >= this->congestion_window) {
+			return;
+		}
+
+		if (!this->transmit(i->second, now)) {
+			return;
+		}
+
+		i->second.lost = false;
+		i->second.retransmitted = true;
+		--this->num_lost;
+		++this->stats.packets_retransmitted;
+
+		this->retransmit_queue.pop_front();
+	}
+
+	while (!this->send_queue.empty() && this->can_send_new_packet()) {
+		const auto& f = this->send_queue.front();
+
+		sent_packet packet;
+		packet.datagram.resize(data_header_size + f.data.size());
+
+		uint8_t* p = packet.datagram.data();
+
+		*p = uint8_t(packet_type::data);
+		++p; // NOLINT
+
+		utki::serialize32be(this->connection_id, p);
+		p += 4; // NOLINT
+
+		utki::serialize32be(uint32_t(this->next_packet_number), p);
+		p += 4; // NOLINT
+
+		utki::serialize16be(f.stream, p);
+		p += 2; // NOLINT
+
+		// the server does not know the connection id when the message is queued, so it is added here
+		utki::serialize32be(uint32_t(this->connection_id + f.message_number), p);
+		p += 4; // NOLINT
+
+		utki::serialize16be(f.index, p);
+		p += 2; // NOLINT
+
+		utki::serialize16be(f.count, p);
+		p += 2; // NOLINT
+
+		std::copy(f.data.begin(), f.data.end(), p);
+
+		if (!this->transmit(packet, now)) {
+			return;
+		}
+
+		if (this->in_flight.empty()) {
+			// start waiting for the peer's response
+			this->idle_start_time = now;
+		}
+
+		this->in_flight.emplace(this->next_packet_number, std::move(packet));
+		++this->next_packet_number;
+
+		this->send_queue.pop_front();
+	}
+}
+
+void reliable_connection::update()
+{
+	if (this->cur_state == state::failed) {
+		return;
+	}
+
+	uint32_t now = utki::get_ticks_ms();
+
+	while (true) {
+		address sender;
+		size_t len = 0;
+		try {
+			len = this->socket.recieve(this->receive_buffer, sender);
+		} catch (std::system_error& e) {
+			if (is_icmp_error(e)) {
+				continue;
+			}
+			throw;
+		}
+
+		if (len == 0) {
+			break;
+		}
+
+		this->handle_datagram(utki::make_span(this->receive_buffer.data(), len), sender, now);
+	}
+
+	this->check_timers(now);
+
+	if (this->cur_state == state::established) {
+		this->send_pending(now);
+	}
+
+	if (this->ack_pending) {
+		this->send_ack();
+	}
+}
+
+uint32_t reliable_connection::get_timeout_ms() const noexcept
+{
+	if (this->cur_state == state::failed || (this->cur_state == state::closed && !this->close_pending)) {
+		return this->idle_timeout_ms;
+	}
+
+	if (this->ack_pending) {
+		return 0;
+	}
+
+	if (this->cur_state == state::established) {
+		if (!this->retransmit_queue.empty() && this->get_packets_in_flight() < this->congestion_window) {
+			return 0;
+		}
+		if (!this->send_queue.empty() && this->can_send_new_packet()) {
+			return 0;
+		}
+	}
+
+	uint32_t now = utki::get_ticks_ms();
+
+	uint32_t timeout = this->idle_timeout_ms;
+
+	if (this->cur_state == state::connecting) {
+		if (this->is_server) {
+			return timeout;
+		}
+		timeout = std::min(timeout, time_left(now, this->control_send_time, this->retransmission_timeout_ms));
+	} else if (this->cur_state == state::closed) {
+		timeout = std::min(timeout, time_left(now, this->control_send_time, this->retransmission_timeout_ms));
+	} else {
+		if (this->in_flight.empty()) {
+			return timeout;
+		}
+		for (const auto& p : this->in_flight) {
+			if (!p.second.lost) {
+				timeout = std::min(timeout, time_left(now, p.second.send_time, this->retransmission_timeout_ms));
+			}
+		}
+	}
+
+	return std::min(timeout, time_left(now, this->idle_start_time, this->idle_timeout_ms));
+}
+
+void reliable_connection::handle_datagram(utki::span<const uint8_t> datagram, const address& sender, uint32_t now)
+{
+	if (datagram.size() < common_header_size) {
+		return;
+	}
+
+	auto type = packet_type(datagram[0]);
+	uint32_t id = utki::deserialize32be(&datagram[1]);
+
+	if (this->is_server && this->cur_state == state::connecting) {
+		if (type != packet_type::syn) {
+			return;
+		}
+
+		this->connection_id = id;
+		this->next_packet_number = id;
+		this->receive_next = id;
+		this->socket.connect(sender);
+		this->cur_state = state::established;
+		this->idle_start_time = now;
+
+		this->send_control(uint8_t(packet_type::syn_ack));
+		return;
+	}
+
+	if (id != this->connection_id) {
+		return;
+	}
+
+	if (this->cur_state == state::closed) {
+		// only the close handshake is completed after the connection is closed
+		if (type == packet_type::close) {
+			// the peer has not received the acknowledgement, or both sides closed the connection simultaneously
+			this->send_control(uint8_t(packet_type::close_ack));
+			this->close_pending = false;
+		} else if (type == packet_type::close_ack) {
+			this->close_pending = false;
+		}
+		return;
+	}
+
+	this->idle_start_time = now;
+	++this->stats.packets_received;
+
+	switch (type) {
+		case packet_type::syn:
+			if (this->is_server) {
+				// the client has not received the handshake response
+				this->send_control(uint8_t(packet_type::syn_ack));
+			}
+			break;
+		case packet_type::syn_ack:
+			if (this->cur_state == state::connecting) {
+				this->cur_state = state::established;
+			}
+			break;
+		case packet_type::data:
+			// data can arrive before the handshake response if the latter is lost
+			this->cur_state = state::established;
+			this->handle_data(datagram);
+			break;
+		case packet_type::ack:
+			this->cur_state = state::established;
+			this->handle_ack(datagram, now);
+			break;
+		case packet_type::close:
+			this->cur_state = state::closed;
+			this->ack_pending = false;
+			this->send_control(uint8_t(packet_type::close_ack));
+			break;
+		case packet_type::close_ack:
+			break;
+	}
+}
+
+void reliable_connection::handle_data(utki::span<const uint8_t> datagram)
+{
+	if (datagram.size() < data_header_size) {
+		return;
+	}
+
+	const uint8_t* p = &datagram[common_header_size];
+
+	uint64_t packet_number = expand_number(utki::deserialize32be(p), this->receive_next);
+	p += 4; // NOLINT
+
+	uint16_t stream = utki::deserialize16be(p);
+	p += 2; // NOLINT
+
+	uint32_t truncated_message_number = utki::deserialize32be(p);
+	p += 4; // NOLINT
+
+	uint16_t fragment_index = utki::deserialize16be(p);
+	p += 2; // NOLINT
+
+	uint16_t fragment_count = utki::deserialize16be(p);
+
+	// acknowledge duplicates too, since previous acknowledgement could be lost
+	this->ack_pending = true;
+
+	if (packet_number < this->receive_next || this->received_above.count(packet_number) != 0) {
+		++this->stats.duplicate_packets_received;
+		return;
+	}
+
+	if (fragment_count == 0 || fragment_index >= fragment_count) {
+		return;
+	}
+
+	// The next in-order packet always belongs to the first incomplete message of its stream, so it is accepted
+	// even if there is no room, otherwise the buffer could stay filled with fragments of messages which
+	// cannot complete without it. This stops once a complete message is waiting for the user, so that the excess
+	// is bounded by the first messages of the streams.
+	if (this->num_buffered_fragments >= this->receive_window &&
+		(packet_number != this->receive_next || !this->received_messages.empty()))
+	{
+		// no room for the packet, do not acknowledge it, the peer will retransmit it later
+		return;
+	}
+
+	if (packet_number == this->receive_next) {
+		++this->receive_next;
+		while (!this->received_above.empty() && *this->received_above.begin() == this->receive_next) {
+			this->received_above.erase(this->received_above.begin());
+			++this->receive_next;
+		}
+	} else {
+		this->received_above.insert(packet_number);
+	}
+
+	auto [stream_iter, stream_inserted] = this->streams.try_emplace(stream);
+	auto& st = stream_iter->second;
+	if (stream_inserted) {
+		st.next_message = this->connection_id;
+	}
+
+	uint64_t message_number = expand_number(truncated_message_number, st.next_message);
+	if (message_number < st.next_message) {
+		return;
+	}
+
+	auto& assembly = st.pending[message_number];
+	if (assembly.fragments.empty()) {
+		assembly.fragments.resize(fragment_count);
+		assembly.received.resize(fragment_count, false);
+	}
+
+	if (assembly.fragments.size() != fragment_count || assembly.received[fragment_index]) {
+		return;
+	}
+
+	auto payload = datagram.subspan(data_header_size);
+	assembly.fragments[fragment_index].assign(payload.begin(), payload.end());
+	assembly.received[fragment_index] = true;
+	++assembly.num_received;
+	++this->num_buffered_fragments;
+
+	// deliver complete messages in order
+	for (auto i = st.pending.find(st.next_message);
+		 i != st.pending.end() && i->second.num_received == i->second.fragments.size();
+		 i = st.pending.find(st.next_message))
+	{
+		received_message m;
+		m.msg.stream = stream;
+		m.num_fragments = i->second.fragments.size();
+
+		size_t size = 0;
+		for (const auto& f : i->second.fragments) {
+			size += f.size();
+		}
+		m.msg.data.reserve(size);
+		for (const auto& f : i->second.fragments) {
+			m.msg.data.insert(m.msg.data.end(), f.begin(), f.end());
+		}
+
+		this->received_messages.push_back(std::move(m));
+
+		st.pending.erase(i);
+		++st.next_message;
+	}
+}
+
+void reliable_connection::mark_lost(uint64_t packet_number, sent_packet& p)
+{
+	ASSERT(!p.lost)
+	p.lost = true;
+	++this->num_lost;
+	this->retransmit_queue.push_back(packet_number);
+}
+
+void reliable_connection::enter_recovery()
+{
+	this->slow_start_threshold = std::max(this->congestion_window / 2, min_congestion_window);
+	this->congestion_avoidance_acks = 0;
+	this->recovery_end = this->next_packet_number;
+}
+
+void reliable_connection::update_retransmission_timeout(uint32_t rtt_sample_ms)
+{
+	if (!this->has_rtt_sample) {
+		this->smoothed_rtt_ms = rtt_sample_ms;
+		this->rtt_variance_ms = rtt_sample_ms / 2;
+		this->has_rtt_sample = true;
+	} else {
+		uint32_t deviation = this->smoothed_rtt_ms > rtt_sample_ms ? this->smoothed_rtt_ms - rtt_sample_ms
+																	: rtt_sample_ms - this->smoothed_rtt_ms;
+		this->rtt_variance_ms = (3 * this->rtt_variance_ms + deviation) / 4; // NOLINT
+		this->smoothed_rtt_ms = (7 * this->smoothed_rtt_ms + rtt_sample_ms) / 8; // NOLINT
+	}
+
+	this->retransmission_timeout_ms = std::clamp(
+		this->smoothed_rtt_ms + 4 * this->rtt_variance_ms,
+		min_retransmission_timeout_ms,
+		max_retransmission_timeout_ms
+	);
+}
+
+void reliable_connection::handle_ack(utki::span<const uint8_t> datagram, uint32_t now)
+{
+	if (datagram.size() < ack_header_size) {
+		return;
+	}
+
+	const uint8_t* p = &datagram[common_header_size];
+
+	// acknowledged packet numbers are not above the next one to be sent
+	uint64_t cumulative = expand_number(utki::deserialize32be(p), this->next_packet_number);
+	p += 4; // NOLINT
+
+	this->peer_window = utki::deserialize32be(p);
+	p += 4; // NOLINT
+
+	size_t num_ranges = *p;
+	++p; // NOLINT
+
+	if (datagram.size() < ack_header_size + num_ranges * ack_range_size) {
+		return;
+	}
+
+	bool acked_any = false;
+
+	// RTT is sampled from the most recently sent of the newly acknowledged packets,
+	// packets which were retransmitted are not sampled because it is unknown which transmission is acknowledged
+	std::optional<uint32_t> rtt_sample_send_time;
+	uint64_t rtt_sample_transmission_number = 0;
+
+	auto ack_packet = [&](decltype(this->in_flight)::iterator i) {
+		auto& packet = i->second;
+
+		if (packet.lost) {
+			--this->num_lost;
+		}
+
+		this->largest_acked_transmission_number =
+			std::max(this->largest_acked_transmission_number, packet.transmission_number);
+
+		if (!packet.retransmitted &&
+			(!rtt_sample_send_time || packet.transmission_number > rtt_sample_transmission_number))
+		{
+			rtt_sample_send_time = packet.send_time;
+			rtt_sample_transmission_number = packet.transmission_number;
+		}
+
+		// grow congestion window, unless the packet was sent before the last loss
+		if (i->first >= this->recovery_end) {
+			if (this->congestion_window < this->slow_start_threshold) {
+				++this->congestion_window;
+			} else if (++this->congestion_avoidance_acks >= this->congestion_window) {
+				this->congestion_avoidance_acks = 0;
+				++this->congestion_window;
+			}
+		}
+
+		this->in_flight.erase(i);
+		acked_any = true;
+	};
+
+	while (!this->in_flight.empty() && this->in_flight.begin()->first < cumulative) {
+		ack_packet(this->in_flight.begin());
+	}
+
+	for (size_t r = 0; r != num_ranges; ++r) {
+		uint64_t start = expand_number(utki::deserialize32be(p), this->next_packet_number);
+		p += 4; // NOLINT
+		uint64_t end = expand_number(utki::deserialize32be(p), this->next_packet_number);
+		p += 4; // NOLINT
+
+		for (auto i = this->in_flight.lower_bound(start); i != this->in_flight.end() && i->first < end;) {
+			auto next = std::next(i);
+			ack_packet(i);
+			i = next;
+		}
+	}
+
+	if (!acked_any) {
+		return;
+	}
+
+	if (rtt_sample_send_time) {
+		this->update_retransmission_timeout(now - rtt_sample_send_time.value());
+	}
+
+	// detect lost packets: those sent before several packets which are already acknowledged
+	bool loss_detected = false;
+	for (auto& i : this->in_flight) {
+		auto& packet = i.second;
+		if (packet.lost ||
+			packet.transmission_number + reordering_threshold > this->largest_acked_transmission_number)
+		{
+			continue;
+		}
+
+		this->mark_lost(i.first, packet);
+
+		// reduce congestion window once per recovery period
+		if (!loss_detected && i.first >= this->recovery_end) {
+			this->enter_recovery();
+			this->congestion_window = this->slow_start_threshold;
+		}
+		loss_detected = true;
+	}
+}
+
+void reliable_connection::check_timers(uint32_t now)
+{
+	if (this->cur_state == state::connecting) {
+		if (this->is_server) {
+			// wait for clients indefinitely
+			return;
+		}
+
+		if (now - this->idle_start_time >= this->idle_timeout_ms) {
+			this->cur_state = state::failed;
+			return;
+		}
+
+		if (now - this->control_send_time >= this->retransmission_timeout_ms) {
+			this->retransmit_control(uint8_t(packet_type::syn), now);
+		}
+		return;
+	}
+
+	if (this->cur_state == state::closed) {
+		if (!this->close_pending) {
+			return;
+		}
+
+		if (now - this->idle_start_time >= this->idle_timeout_ms) {
+			// the peer is gone, stop notifying it
+			this->close_pending = false;
+			return;
+		}
+
+		if (now - this->control_send_time >= this->retransmission_timeout_ms) {
+			this->retransmit_control(uint8_t(packet_type::close), now);
+		}
+		return;
+	}
+
+	if (this->in_flight.empty()) {
+		return;
+	}
+
+	if (now - this->idle_start_time >= this->idle_timeout_ms) {
+		this->cur_state = state::failed;
+		return;
+	}
+
+	// retransmission timeout
+	bool timed_out = false;
+	for (auto& i : this->in_flight) {
+		auto& packet = i.second;
+		if (packet.lost || now - packet.send_time < this->retransmission_timeout_ms) {
+			continue;
+		}
+		this->mark_lost(i.first, packet);
+		timed_out = true;
+	}
+
+	if (timed_out) {
+		this->enter_recovery();
+		this->congestion_window = min_congestion_window;
+		this->retransmission_timeout_ms = std::min(this->retransmission_timeout_ms * 2, max_retransmission_timeout_ms);
+	}
+}
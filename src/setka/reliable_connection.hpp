@@ -0,0 +1,397 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#include "address.hpp"
+#include "udp_socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief Reliable message connection over UDP.
+ * Lightweight transport which delivers messages reliably and in order over a UDP socket.
+ * Messages are sent over independent streams, messages of one stream are delivered in order,
+ * while loss of a packet of one stream does not delay delivery of messages of other streams.
+ * Messages bigger than a single datagram are fragmented and reassembled.
+ *
+ * The transport features:
+ * - connection handshake;
+ * - per-stream message sequencing;
+ * - selective acknowledgements;
+ * - retransmission timers with RTT estimation;
+ * - congestion control, similar to TCP NewReno;
+ * - flow control, the receiver advertises how many more packets it can buffer.
+ *
+ * The connection does not create threads, it is driven by the user's loop. The socket returned by get_socket()
+ * is to be added to opros::wait_set for reading, and update() is to be called each time the socket becomes ready
+ * or the timeout returned by get_timeout_ms() expires. Usage:
+ * @code{.cpp}
+ * setka::reliable_connection conn(setka::udp_socket(0), setka::address("127.0.0.1", 1234));
+ * opros::wait_set ws(1);
+ * ws.add(conn.get_socket(), utki::make_flags({opros::ready::read}), nullptr);
+ * conn.send(0, message);
+ * while(conn.get_state() != setka::reliable_connection::state::failed){
+ *     ws.wait(conn.get_timeout_ms());
+ *     conn.update();
+ *     while(auto m = conn.receive()){
+ *         // process message
+ *     }
+ * }
+ * ws.remove(conn.get_socket());
+ * @endcode
+ */
+class reliable_connection
+{
+public:
+	/**
+	 * @brief Connection state.
+	 */
+	enum class state {
+		/**
+		 * @brief Handshake is in progress.
+		 * Messages can be sent, they are queued until the connection is established.
+		 */
+		connecting,
+
+		/**
+		 * @brief Connection is established.
+		 */
+		established,
+
+		/**
+		 * @brief Connection was closed by either side.
+		 */
+		closed,
+
+		/**
+		 * @brief Peer did not respond within the idle timeout.
+		 */
+		failed
+	};
+
+	/**
+	 * @brief Received message.
+	 */
+	struct message {
+		uint16_t stream = 0;
+		std::vector<uint8_t> data;
+	};
+
+	/**
+	 * @brief Connection statistics.
+	 */
+	struct statistics {
+		uint64_t packets_sent = 0;
+		uint64_t packets_retransmitted = 0;
+		uint64_t packets_received = 0;
+		uint64_t duplicate_packets_received = 0;
+	};
+
+	constexpr static const size_t default_max_payload_size = 1200;
+	constexpr static const size_t default_receive_window = 256;
+	constexpr static const uint32_t default_idle_timeout_ms = 10000;
+
+private:
+	udp_socket socket;
+
+	const bool is_server;
+	state cur_state = state::connecting;
+	uint32_t connection_id = 0;
+
+	const size_t max_payload_size;
+	const size_t receive_window;
+
+	uint32_t idle_timeout_ms = default_idle_timeout_ms;
+
+	// time of the last response from the peer, or of the start of waiting for response
+	uint32_t idle_start_time;
+
+	// time of the last transmission of the handshake request or of the close notification
+	uint32_t control_send_time = 0;
+
+	// the close notification has not been acknowledged by the peer yet
+	bool close_pending = false;
+
+	statistics stats;
+
+	// sending
+
+	struct fragment {
+		uint16_t stream;
+
+		// counted from 0, the message number on the wire is offset by the connection id
+		uint64_t message_number;
+		uint16_t index;
+		uint16_t count;
+		std::vector<uint8_t> data;
+	};
+
+	std::deque<fragment> send_queue;
+	std::map<uint16_t, uint64_t> next_message_numbers;
+
+	struct sent_packet {
+		std::vector<uint8_t> datagram;
+		uint32_t send_time = 0;
+
+		// sequence number of the last transmission of the packet, used for loss detection
+		uint64_t transmission_number = 0;
+
+		bool retransmitted = false;
+		bool lost = false;
+	};
+
+	// Packet and message numbers are 64 bit and never wrap around, only their lower 32 bits are sent,
+	// the receiver restores the rest from the numbers it expects. Packet numbers start at the connection id,
+	// so the 32 bit numbers on the wire wrap around at a random point of a connection.
+	std::map<uint64_t, sent_packet> in_flight;
+	size_t num_lost = 0;
+	std::deque<uint64_t> retransmit_queue;
+
+	uint64_t next_packet_number = 0;
+	uint64_t next_transmission_number = 0;
+	uint64_t largest_acked_transmission_number = 0;
+
+	// round trip time estimation, RFC 6298
+	bool has_rtt_sample = false;
+	uint32_t smoothed_rtt_ms = 0;
+	uint32_t rtt_variance_ms = 0;
+	uint32_t retransmission_timeout_ms;
+
+	// congestion control, in packets
+	size_t congestion_window;
+	size_t slow_start_threshold = std::numeric_limits<size_t>::max();
+	size_t congestion_avoidance_acks = 0;
+
+	// packets sent before this packet number belong to the current recovery period
+	uint64_t recovery_end = 0;
+
+	size_t peer_window;
+
+	// receiving
+
+	uint64_t receive_next = 0;
+	std::set<uint64_t> received_above;
+	bool ack_pending = false;
+
+	struct message_assembly {
+		std::vector<std::vector<uint8_t>> fragments;
+		std::vector<bool> received;
+		size_t num_received = 0;
+	};
+
+	struct stream_receive_state {
+		// starts at the connection id
+		uint64_t next_message = 0;
+		std::map<uint64_t, message_assembly> pending;
+	};
+
+	std::map<uint16_t, stream_receive_state> streams;
+
+	struct received_message {
+		message msg;
+		size_t num_fragments;
+	};
+
+	std::deque<received_message> received_messages;
+
+	// number of fragments held in pending assemblies and received messages
+	size_t num_buffered_fragments = 0;
+
+	std::vector<uint8_t> receive_buffer;
+
+public:
+	/**
+	 * @brief Create client side connection.
+	 * Connects the socket to the peer and starts the handshake.
+	 * @param socket - UDP socket to use for the connection.
+	 * @param peer_address - address of the peer.
+	 * @param max_payload_size - maximum size of message data carried by one datagram.
+	 * @param receive_window - maximum number of received packets to buffer.
+	 */
+	reliable_connection(
+		udp_socket&& socket,
+		const address& peer_address,
+		size_t max_payload_size = default_max_payload_size,
+		size_t receive_window = default_receive_window
+	);
+
+	/**
+	 * @brief Create server side connection.
+	 * The connection waits for the handshake from a client, and then connects the socket to the client.
+	 * @param socket - UDP socket to use for the connection, bound to a known port.
+	 * @param max_payload_size - maximum size of message data carried by one datagram.
+	 * @param receive_window - maximum number of received packets to buffer.
+	 */
+	reliable_connection(
+		udp_socket&& socket,
+		size_t max_payload_size = default_max_payload_size,
+		size_t receive_window = default_receive_window
+	);
+
+	reliable_connection(const reliable_connection&) = delete;
+	reliable_connection& operator=(const reliable_connection&) = delete;
+
+	reliable_connection(reliable_connection&&) = delete;
+	reliable_connection& operator=(reliable_connection&&) = delete;
+
+	~reliable_connection() = default;
+
+	/**
+	 * @brief Get the underlying socket.
+	 * The socket is to be added to opros::wait_set to wait for incoming datagrams.
+	 * @return reference to the socket.
+	 */
+	udp_socket& get_socket() noexcept
+	{
+		return this->socket;
+	}
+
+	state get_state() const noexcept
+	{
+		return this->cur_state;
+	}
+
+	/**
+	 * @brief Set idle timeout.
+	 * If the peer does not respond for this time while there is unacknowledged data,
+	 * or while the handshake is in progress, the connection fails.
+	 * After close() the close notification is repeated for at most this time.
+	 * @param timeout_ms - idle timeout in milliseconds.
+	 */
+	void set_idle_timeout(uint32_t timeout_ms) noexcept
+	{
+		this->idle_timeout_ms = timeout_ms;
+	}
+
+	/**
+	 * @brief Queue message for sending.
+	 * The message is sent by subsequent calls to update(), as allowed by congestion and flow control.
+	 * The peer has to be able to buffer all fragments of a message, so the message cannot have more fragments
+	 * than the receive window. Both sides of the connection are expected to use the same receive window.
+	 * @param stream - stream to send the message over.
+	 * @param data - message data.
+	 * @throw std::invalid_argument - if the message has more fragments than the receive window.
+	 */
+	void send(uint16_t stream, utki::span<const uint8_t> data);
+
+	/**
+	 * @brief Get next received message.
+	 * @return received message, if any.
+	 */
+	std::optional<message> receive();
+
+	/**
+	 * @brief Process incoming datagrams and timers, send queued data.
+	 * After the connection is closed, it only completes the close handshake with the peer.
+	 */
+	void update();
+
+	/**
+	 * @brief Get time until the next call to update() is needed.
+	 * @return timeout in milliseconds.
+	 */
+	uint32_t get_timeout_ms() const noexcept;
+
+	/**
+	 * @brief Check if all sent messages have been acknowledged by the peer.
+	 * @return true if there is no unacknowledged data.
+	 */
+	bool is_send_complete() const noexcept
+	{
+		return this->send_queue.empty() && this->in_flight.empty();
+	}
+
+	/**
+	 * @brief Close the connection.
+	 * Notifies the peer and moves the connection to closed state.
+	 * Unacknowledged data is discarded. The notification is repeated by update() until the peer acknowledges it
+	 * or the idle timeout expires, so update() is to be called after closing as well.
+	 */
+	void close();
+
+	const statistics& get_statistics() const noexcept
+	{
+		return this->stats;
+	}
+
+	/**
+	 * @brief Get smoothed round trip time.
+	 * @return round trip time in milliseconds.
+	 */
+	uint32_t get_rtt_ms() const noexcept
+	{
+		return this->smoothed_rtt_ms;
+	}
+
+	/**
+	 * @brief Get congestion window.
+	 * @return congestion window in packets.
+	 */
+	size_t get_congestion_window() const noexcept
+	{
+		return this->congestion_window;
+	}
+
+private:
+	bool send_datagram(utki::span<const uint8_t> datagram);
+	void send_control(uint8_t type);
+	void retransmit_control(uint8_t type, uint32_t now);
+	void send_ack();
+	bool transmit(sent_packet& p, uint32_t now);
+
+	void handle_datagram(utki::span<const uint8_t> datagram, const address& sender, uint32_t now);
+	void handle_data(utki::span<const uint8_t> datagram);
+	void handle_ack(utki::span<const uint8_t> datagram, uint32_t now);
+
+	void mark_lost(uint64_t packet_number, sent_packet& p);
+	void enter_recovery();
+	void update_retransmission_timeout(uint32_t rtt_sample_ms);
+
+	void check_timers(uint32_t now);
+	void send_pending(uint32_t now);
+
+	// number of packets occupying the network, lost packets are not counted
+	size_t get_packets_in_flight() const noexcept
+	{
+		return this->in_flight.size() - this->num_lost;
+	}
+
+	bool can_send_new_packet() const noexcept;
+};
+
+} // namespace setka
@@ -62,6 +62,8 @@ namespace setka {
 // NOLINTNEXTLINE(cppcoreguidelines-virtual-class-destructor)
 class socket : public opros::waitable
 {
+	friend class connection_table;
+
 protected:
 #if CFG_OS == CFG_OS_WINDOWS
 	using socket_type = SOCKET;
@@ -72,6 +74,8 @@ protected:
 	constexpr static const int error_again = WSAEWOULDBLOCK;
 	constexpr static const int error_in_progress = WSAEWOULDBLOCK;
 	constexpr static const int error_not_connected = WSAENOTCONN;
+	constexpr static const int error_connection_reset = WSAECONNRESET;
+	constexpr static const int error_message_too_large = WSAEMSGSIZE;
 
 #elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
 	using socket_type = int;
@@ -82,6 +86,8 @@ protected:
 	constexpr static const int error_again = EAGAIN;
 	constexpr static const int error_in_progress = EINPROGRESS;
 	constexpr static const int error_not_connected = ENOTCONN;
+	constexpr static const int error_connection_reset = ECONNRESET;
+	constexpr static const int error_message_too_large = EMSGSIZE;
 
 #else
 #	error "Unsupported OS"
@@ -0,0 +1,58 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "subnet.hpp"
+
+#include <array>
+
+#include <utki/debug.hpp>
+
+using namespace setka;
+
+std::to_chars_result subnet::to_chars(char* first, char* last) const noexcept
+{
+	auto res = this->host.to_chars(first, last);
+	if (res.ec != std::errc()) {
+		return res;
+	}
+
+	if (res.ptr == last) {
+		return {last, std::errc::value_too_large};
+	}
+	*res.ptr = '/';
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return std::to_chars(res.ptr + 1, last, unsigned(this->prefix_length));
+}
+
+std::string subnet::to_string() const
+{
+	std::array<char, max_chars> buf{};
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto res = this->to_chars(buf.data(), buf.data() + buf.size());
+	ASSERT(res.ec == std::errc())
+	return {buf.data(), res.ptr};
+}
@@ -0,0 +1,338 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "address.hpp"
+
+namespace setka {
+
+/**
+ * @brief IP subnet.
+ * Subnet consists of network address and prefix length, e.g. "10.0.0.0/8" or "2001:db8::/32".
+ * IPv4 subnets hold IPv4 mapped to IPv6 network address and prefix length in IPv4 terms, i.e. 0 to 32.
+ * IPv6 subnets hold prefix length from 0 to 128.
+ */
+class subnet
+{
+public:
+	constexpr static const uint8_t max_ip_v4_prefix_length = 32;
+	constexpr static const uint8_t max_ip_v6_prefix_length = 128;
+
+	/**
+	 * @brief Maximum number of characters written by to_chars().
+	 */
+	constexpr static const size_t max_chars = address::ip::max_chars + 4;
+
+private:
+	// bits of the address which go after the prefix are always zero
+	address::ip host{};
+
+	uint8_t prefix_length = 0;
+
+	// sets bits of the address which go after the prefix to zero
+	constexpr static address::ip mask(const address::ip& h, unsigned ip_v6_prefix_length) noexcept
+	{
+		constexpr unsigned quad_bits = 32;
+
+		address::ip ret;
+		for (unsigned i = 0; i != h.quad.size(); ++i) {
+			unsigned quad_prefix_length = ip_v6_prefix_length > i * quad_bits ? ip_v6_prefix_length - i * quad_bits : 0;
+
+			uint32_t quad_mask = 0;
+			if (quad_prefix_length >= quad_bits) {
+				quad_mask = ~uint32_t(0);
+			} else if (quad_prefix_length != 0) {
+				quad_mask = ~uint32_t(0) << (quad_bits - quad_prefix_length);
+			}
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			ret.quad[i] = h.quad[i] & quad_mask;
+		}
+		return ret;
+	}
+
+	// prefix length in IPv6 terms
+	constexpr unsigned get_ip_v6_prefix_length() const noexcept
+	{
+		return this->is_v4() ? max_ip_v6_prefix_length - max_ip_v4_prefix_length + this->prefix_length
+							 : this->prefix_length;
+	}
+
+public:
+	/**
+	 * @brief Create subnet "::/0".
+	 */
+	constexpr subnet() noexcept = default;
+
+	/**
+	 * @brief Create subnet from address and prefix length.
+	 * Bits of the address which go after the prefix are set to zero.
+	 * @param h - network address. For IPv4 mapped to IPv6 address the IPv4 subnet is created.
+	 * @param prefix_length - prefix length, 0 to 32 for IPv4 subnet, 0 to 128 for IPv6 subnet.
+	 * @throw std::invalid_argument - if prefix length is too big.
+	 */
+	constexpr subnet(const address::ip& h, uint8_t prefix_length) :
+		host(h),
+		prefix_length(prefix_length)
+	{
+		if (prefix_length > this->get_max_prefix_length()) {
+			throw std::invalid_argument("subnet prefix length is too big");
+		}
+
+		this->host = mask(this->host, this->get_ip_v6_prefix_length());
+	}
+
+	/**
+	 * @brief Parse subnet from string.
+	 * See from_chars() for the format.
+	 * @param str - string to parse.
+	 * @throw std::runtime_error - if the string does not contain properly formatted subnet.
+	 */
+	constexpr subnet(std::string_view str);
+
+	/**
+	 * @brief Parse subnet from characters sequence.
+	 * Works similarly to std::from_chars(). Accepted forms are "10.0.0.0/8", "2001:db8::/32" and
+	 * address without prefix length, e.g. "10.1.2.3", which is parsed as a single host subnet.
+	 * IPv6 form of IPv4 mapped subnet, e.g. "::ffff:10.0.0.0/104", is parsed as IPv4 subnet.
+	 * Bits of the address which go after the prefix are set to zero.
+	 * Does not throw and does not allocate memory. Can be evaluated at compile time.
+	 * @param first - beginning of the characters sequence.
+	 * @param last - end of the characters sequence.
+	 * @param value - subnet object to store the parsed subnet to. Left unchanged in case of error.
+	 * @return ptr pointing to the first character not matching the subnet and default value of ec, on success.
+	 * @return first as ptr and std::errc::invalid_argument as ec, in case the subnet is malformed.
+	 * @return ptr pointing past the prefix length and std::errc::result_out_of_range as ec,
+	 *         in case the prefix length is too big.
+	 */
+	constexpr static std::from_chars_result from_chars(const char* first, const char* last, subnet& value) noexcept;
+
+	/**
+	 * @brief Write this subnet to characters buffer.
+	 * Works similarly to std::to_chars(). The subnet is written as "10.0.0.0/8" or "2001:db8::/32",
+	 * see address::ip::to_chars().
+	 * No more than max_chars characters is written. The string is not null-terminated.
+	 * @param first - beginning of the buffer.
+	 * @param last - end of the buffer.
+	 * @return pointer past the last written character as ptr and default value of ec, on success.
+	 * @return last as ptr and std::errc::value_too_large as ec, if the buffer is too small.
+	 */
+	std::to_chars_result to_chars(char* first, char* last) const noexcept;
+
+	/**
+	 * @brief Convert this subnet to string.
+	 * @return String representing the subnet, see to_chars().
+	 */
+	std::string to_string() const;
+
+	/**
+	 * @brief Get network address.
+	 * Bits of the address which go after the prefix are always zero.
+	 * @return network address.
+	 */
+	constexpr const address::ip& get_host() const noexcept
+	{
+		return this->host;
+	}
+
+	/**
+	 * @brief Get prefix length.
+	 * @return prefix length, 0 to 32 for IPv4 subnet, 0 to 128 for IPv6 subnet.
+	 */
+	constexpr uint8_t get_prefix_length() const noexcept
+	{
+		return this->prefix_length;
+	}
+
+	/**
+	 * @brief Check if this is IPv4 subnet.
+	 * @return true if this is IPv4 subnet.
+	 * @return false if this is IPv6 subnet.
+	 */
+	constexpr bool is_v4() const noexcept
+	{
+		return this->host.is_v4();
+	}
+
+	/**
+	 * @brief Get maximum prefix length for the address family of this subnet.
+	 * @return 32 for IPv4 subnet.
+	 * @return 128 for IPv6 subnet.
+	 */
+	constexpr uint8_t get_max_prefix_length() const noexcept
+	{
+		return this->is_v4() ? max_ip_v4_prefix_length : max_ip_v6_prefix_length;
+	}
+
+	/**
+	 * @brief Check if the address belongs to this subnet.
+	 * IPv4 addresses never belong to IPv6 subnets and vice versa.
+	 * @param h - address to check.
+	 * @return true if the address belongs to this subnet.
+	 * @return false otherwise.
+	 */
+	constexpr bool contains(const address::ip& h) const noexcept
+	{
+		if (h.is_v4() != this->is_v4()) {
+			return false;
+		}
+		return mask(h, this->get_ip_v6_prefix_length()) == this->host;
+	}
+
+	/**
+	 * @brief Check if the given subnet is a part of this subnet.
+	 * @param s - subnet to check.
+	 * @return true if the given subnet is equal to or is a part of this subnet.
+	 * @return false otherwise.
+	 */
+	constexpr bool contains(const subnet& s) const noexcept
+	{
+		return s.is_v4() == this->is_v4() && s.prefix_length >= this->prefix_length && this->contains(s.host);
+	}
+
+	constexpr bool operator==(const subnet& s) const noexcept
+	{
+		return this->host == s.host && this->prefix_length == s.prefix_length;
+	}
+
+	constexpr bool operator!=(const subnet& s) const noexcept
+	{
+		return !this->operator==(s);
+	}
+
+	/**
+	 * @brief Compare two subnets.
+	 * Subnets are ordered by network address first and then by prefix length,
+	 * so that a subnet goes before all its parts.
+	 * @param s - subnet to compare with.
+	 * @return true if this subnet is less than the given one.
+	 * @return false otherwise.
+	 */
+	constexpr bool operator<(const subnet& s) const noexcept
+	{
+		if (this->host != s.host) {
+			return this->host < s.host;
+		}
+		return this->prefix_length < s.prefix_length;
+	}
+};
+
+constexpr std::from_chars_result subnet::from_chars(const char* first, const char* last, subnet& value) noexcept
+{
+	address::ip h;
+	auto res = address::ip::from_chars(first, last, h);
+	if (res.ec != std::errc()) {
+		return res;
+	}
+
+	constexpr auto ip_v4_prefix_offset = max_ip_v6_prefix_length - max_ip_v4_prefix_length;
+
+	// the address might be written in IPv6 form, detect IPv4 by prefix length later
+	unsigned max_length = max_ip_v6_prefix_length;
+
+	if (res.ptr == last || *res.ptr != '/') {
+		// single host
+		value = subnet(h, h.is_v4() ? max_ip_v4_prefix_length : max_ip_v6_prefix_length);
+		return res;
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	std::string_view str(res.ptr + 1, size_t(last - res.ptr - 1));
+
+	unsigned length = 0;
+	size_t i = 0;
+	constexpr auto max_prefix_length_digits = 3;
+	for (; i != str.size() && detail::is_digit(str[i]); ++i) {
+		if (i < max_prefix_length_digits) {
+			length = length * detail::decimal_base + unsigned(str[i] - '0');
+		}
+	}
+
+	if (i == 0) {
+		return {first, std::errc::invalid_argument};
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	const char* end = res.ptr + 1 + i;
+
+	// IPv4 subnet written as IPv4 is always IPv4 subnet
+	bool ip_v4_form = h.is_v4() && detail::is_ip_v4_string(std::string_view(first, size_t(res.ptr - first)));
+	if (ip_v4_form) {
+		max_length = max_ip_v4_prefix_length;
+	}
+
+	if (i > max_prefix_length_digits || length > max_length) {
+		return {end, std::errc::result_out_of_range};
+	}
+
+	if (ip_v4_form) {
+		value = subnet(h, uint8_t(length));
+	} else if (h.is_v4() && length >= ip_v4_prefix_offset) {
+		// IPv4 mapped to IPv6 subnet
+		value = subnet(h, uint8_t(length - ip_v4_prefix_offset));
+	} else {
+		// IPv6 subnet, masking the address makes it not IPv4 mapped
+		value = subnet(mask(h, length), uint8_t(length));
+	}
+
+	return {end, std::errc()};
+}
+
+constexpr subnet::subnet(std::string_view str)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto res = from_chars(str.data(), str.data() + str.size(), *this);
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	if (res.ec != std::errc() || res.ptr != str.data() + str.size()) {
+		throw std::runtime_error("bad subnet format");
+	}
+}
+
+namespace literals {
+
+/**
+ * @brief Parse subnet.
+ * See subnet::subnet(std::string_view).
+ * @code
+ * using namespace setka::literals;
+ * constexpr auto private_network = "10.0.0.0/8"_subnet;
+ * @endcode
+ */
+constexpr subnet operator""_subnet(const char* str, size_t size)
+{
+	return subnet(std::string_view(str, size));
+}
+
+} // namespace literals
+
+} // namespace setka
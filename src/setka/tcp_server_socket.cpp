@@ -26,7 +26,6 @@ SOFTWARE.
 
 #include "tcp_server_socket.hpp"
 
-#include <cstring>
 
 #if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
 #	include <netinet/in.h>
@@ -34,7 +33,17 @@ SOFTWARE.
 
 using namespace setka;
 
-tcp_server_socket::tcp_server_socket(uint16_t port, bool disable_naggle, uint16_t queue_size) :
+tcp_server_socket::tcp_server_socket(uint16_t port, bool disable_naggle, uint16_t queue_size, bool multipath) :
+	// 'any' IPv6 address allows accepting both IPv4 and IPv6 connections
+	tcp_server_socket(endpoint(address(address::ip(0, 0, 0, 0), port)), disable_naggle, queue_size, multipath)
+{}
+
+tcp_server_socket::tcp_server_socket(
+	const endpoint& local_endpoint,
+	bool disable_naggle,
+	uint16_t queue_size,
+	bool multipath
+) :
 	disable_naggle(disable_naggle)
 {
 #if CFG_OS == CFG_OS_WINDOWS
@@ -44,14 +53,14 @@ tcp_server_socket::tcp_server_socket(uint16_t port, bool disable_naggle, uint16_
 	int& sock = this->handle;
 #endif
 
-	bool ipv4 = false;
+	bool ipv4 = local_endpoint.get_family() == AF_INET;
 
-	sock = ::socket(PF_INET6, SOCK_STREAM, 0);
+	sock = ipv4 ? invalid_socket : tcp_socket::create_stream_socket(PF_INET6, multipath);
 
 	if (sock == invalid_socket) {
-		// maybe IPv6 is not supported by OS, try creating IPv4 socket
+		// either IPv4 endpoint is given, or maybe IPv6 is not supported by OS, try creating IPv4 socket
 
-		sock = ::socket(PF_INET, SOCK_STREAM, 0);
+		sock = tcp_socket::create_stream_socket(PF_INET, multipath);
 
 		if (sock == invalid_socket) {
 #if CFG_OS == CFG_OS_WINDOWS
@@ -87,7 +96,7 @@ tcp_server_socket::tcp_server_socket(uint16_t port, bool disable_naggle, uint16_
 			this->create_event_for_waitable();
 #endif
 
-			sock = ::socket(PF_INET, SOCK_STREAM, 0);
+			sock = tcp_socket::create_stream_socket(PF_INET, multipath);
 
 			if (sock == invalid_socket) {
 #if CFG_OS == CFG_OS_WINDOWS
@@ -117,35 +126,15 @@ tcp_server_socket::tcp_server_socket(uint16_t port, bool disable_naggle, uint16_
 		);
 	}
 
-	sockaddr_storage socket_address{};
-	socklen_t socket_address_length = 0;
-
-	if (ipv4) {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& sa = reinterpret_cast<sockaddr_in&>(socket_address);
-		memset(&sa, 0, sizeof(sa));
-		sa.sin_family = AF_INET;
-		sa.sin_addr.s_addr = INADDR_ANY;
-		sa.sin_port = htons(port);
-		socket_address_length = sizeof(sa);
-	} else {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& sa = reinterpret_cast<sockaddr_in6&>(socket_address);
-		memset(&sa, 0, sizeof(sa));
-		sa.sin6_family = AF_INET6;
-		sa.sin6_addr = in6addr_any; // 'in6addr_any' allows accepting both IPv4 and IPv6 connections!!!
-		sa.sin6_port = htons(port);
-		socket_address_length = sizeof(sa);
+	endpoint e = local_endpoint;
+
+	if (ipv4 && e.get_family() == AF_INET6 && e.to_address().host == address::ip(0, 0, 0, 0)) {
+		// IPv6 is not supported by OS, bind to 'any' IPv4 address instead
+		e = endpoint(address(address::ip(0), e.get_port()));
 	}
 
 	// Bind the socket for listening
-	if (bind(
-			sock,
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			reinterpret_cast<sockaddr*>(&socket_address),
-			socket_address_length
-		) == socket_error)
-	{
+	if (::bind(sock, e.data(), e.size()) == socket_error) {
 #if CFG_OS == CFG_OS_WINDOWS
 		int error_code = WSAGetLastError();
 #elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
@@ -207,7 +196,10 @@ tcp_socket tcp_server_socket::accept()
 	s.create_event_for_waitable();
 #endif
 
-	accepted_sock = ::accept(sock, nullptr, nullptr);
+	endpoint remote_endpoint;
+	endpoint::length_type remote_endpoint_length = endpoint::capacity();
+
+	accepted_sock = ::accept(sock, remote_endpoint.data(), &remote_endpoint_length);
 
 	if (accepted_sock == invalid_socket) {
 #if CFG_OS == CFG_OS_WINDOWS
@@ -228,6 +220,9 @@ tcp_socket tcp_server_socket::accept()
 			s.disable_naggle();
 		}
 
+		remote_endpoint.set_size(remote_endpoint_length);
+		s.remote_address = remote_endpoint.to_address();
+
 		return s; // return a newly created socket
 	} catch (...) {
 		s.close();
@@ -61,8 +61,32 @@ public:
 	 * @param port - IP port number to listen on.
 	 * @param disable_naggle - enable/disable Naggle algorithm for all accepted connections.
 	 * @param queue_size - the maximum number of pending connections.
+	 * @param multipath - create Multipath TCP (MPTCP) socket. If MPTCP is not supported by the OS,
+	 *                    then the plain TCP socket is created. MPTCP is only supported on Linux.
+	 *                    MPTCP server socket accepts both MPTCP and plain TCP connections.
 	 */
-	tcp_server_socket(uint16_t port, bool disable_naggle = false, uint16_t queue_size = max_pending_connections);
+	tcp_server_socket(
+		uint16_t port,
+		bool disable_naggle = false,
+		uint16_t queue_size = max_pending_connections,
+		bool multipath = false
+	);
+
+	/**
+	 * @brief Creates a socket bound to the given local endpoint and starts listening on it.
+	 * If the endpoint is IPv4, then the IPv4-only socket is created, otherwise the dual-stack
+	 * IPv6 socket is created, if supported by the OS.
+	 * @param local_endpoint - local endpoint to listen on.
+	 * @param disable_naggle - enable/disable Naggle algorithm for all accepted connections.
+	 * @param queue_size - the maximum number of pending connections.
+	 * @param multipath - create Multipath TCP (MPTCP) socket, see the port based constructor.
+	 */
+	tcp_server_socket(
+		const endpoint& local_endpoint,
+		bool disable_naggle = false,
+		uint16_t queue_size = max_pending_connections,
+		bool multipath = false
+	);
 
 	tcp_server_socket(const tcp_server_socket&) = delete;
 	tcp_server_socket& operator=(const tcp_server_socket&) = delete;
@@ -26,15 +26,44 @@ SOFTWARE.
 
 #include "tcp_socket.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 
+#include <opros/wait_set.hpp>
+#include <utki/time.hpp>
+
 #if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
 #	include <netinet/in.h>
 #endif
 
+#if CFG_OS == CFG_OS_LINUX && defined(__has_include)
+#	if __has_include(<linux/mptcp.h>)
+#		include <linux/mptcp.h>
+#	endif
+#endif
+
 using namespace setka;
 
-tcp_socket::tcp_socket(const address& ip, bool disable_naggle)
+tcp_socket::socket_type tcp_socket::create_stream_socket(int family, bool multipath)
+{
+#if CFG_OS == CFG_OS_LINUX && defined(IPPROTO_MPTCP)
+	if (multipath) {
+		socket_type sock = ::socket(family, SOCK_STREAM, IPPROTO_MPTCP);
+		if (sock != invalid_socket) {
+			return sock;
+		}
+		// MPTCP is not supported or disabled, fall back to plain TCP
+	}
+#endif
+	return ::socket(family, SOCK_STREAM, 0);
+}
+
+tcp_socket::tcp_socket(const address& ip, bool disable_naggle, bool multipath) :
+	tcp_socket(endpoint(ip), disable_naggle, multipath)
+{}
+
+tcp_socket::tcp_socket(const endpoint& remote_endpoint, bool disable_naggle, bool multipath)
 {
 	if (!this->is_empty()) {
 		throw std::logic_error("tcp_socket::open(): socket is already connected");
@@ -49,7 +78,7 @@ tcp_socket::tcp_socket(const address& ip, bool disable_naggle)
 #	error "Unknown OS"
 #endif
 
-	sock = ::socket(ip.host.is_v4() ? PF_INET : PF_INET6, SOCK_STREAM, 0);
+	sock = create_stream_socket(remote_endpoint.get_family() == AF_INET ? PF_INET : PF_INET6, multipath);
 	if (sock == invalid_socket) {
 #if CFG_OS == CFG_OS_WINDOWS
 		int error_code = WSAGetLastError();
@@ -68,60 +97,10 @@ tcp_socket::tcp_socket(const address& ip, bool disable_naggle)
 
 		this->set_nonblocking_mode();
 
-		// connecting to remote host
-		sockaddr_storage socket_address{};
-
-		if (ip.host.is_v4()) {
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			auto& sa = reinterpret_cast<sockaddr_in&>(socket_address);
-			memset(&sa, 0, sizeof(sa));
-			sa.sin_family = AF_INET;
-			sa.sin_addr.s_addr = htonl(ip.host.get_v4());
-			sa.sin_port = htons(ip.port);
-		} else {
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			auto& sa = reinterpret_cast<sockaddr_in6&>(socket_address);
-			memset(&sa, 0, sizeof(sa));
-			sa.sin6_family = AF_INET6;
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
-	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
-			sa.sin6_addr.s6_addr[0] = ip.host.quad[0] >> (utki::byte_bits * 3); // NOLINT
-			sa.sin6_addr.s6_addr[1] = (ip.host.quad[0] >> (utki::byte_bits * 2)) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[2] = (ip.host.quad[0] >> utki::byte_bits) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[3] = ip.host.quad[0] & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[4] = ip.host.quad[1] >> (utki::byte_bits * 3); // NOLINT
-			sa.sin6_addr.s6_addr[5] = (ip.host.quad[1] >> (utki::byte_bits * 2)) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[6] = (ip.host.quad[1] >> utki::byte_bits) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[7] = ip.host.quad[1] & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[8] = ip.host.quad[2] >> (utki::byte_bits * 3); // NOLINT
-			sa.sin6_addr.s6_addr[9] = (ip.host.quad[2] >> (utki::byte_bits * 2)) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[10] = (ip.host.quad[2] >> utki::byte_bits) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[11] = ip.host.quad[2] & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[12] = ip.host.quad[3] >> (utki::byte_bits * 3); // NOLINT
-			sa.sin6_addr.s6_addr[13] = (ip.host.quad[3] >> (utki::byte_bits * 2)) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[14] = (ip.host.quad[3] >> utki::byte_bits) & utki::byte_mask; // NOLINT
-			sa.sin6_addr.s6_addr[15] = ip.host.quad[3] & utki::byte_mask; // NOLINT
-
-#else
-			sa.sin6_addr.__in6_u.__u6_addr32[0] = htonl(ip.host.quad[0]); // NOLINT
-			sa.sin6_addr.__in6_u.__u6_addr32[1] = htonl(ip.host.quad[1]); // NOLINT
-			sa.sin6_addr.__in6_u.__u6_addr32[2] = htonl(ip.host.quad[2]); // NOLINT
-			sa.sin6_addr.__in6_u.__u6_addr32[3] = htonl(ip.host.quad[3]); // NOLINT
-#endif
-			sa.sin6_port = htons(ip.port);
-		}
-
 		// connect to the remote host
-		if (connect(
-				sock,
-				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-				reinterpret_cast<sockaddr*>(&socket_address),
-				ip.host.is_v4()
-					? sizeof(sockaddr_in)
-					: sizeof(sockaddr_in6
-					  ) // NOTE: on Mac OS for some reason the size should be exactly according to AF_INET/AF_INET6
-			) == socket_error)
-		{
+		// NOTE: on Mac OS for some reason the size should be exactly according to AF_INET/AF_INET6,
+		//       the endpoint's size is exactly that
+		if (connect(sock, remote_endpoint.data(), remote_endpoint.size()) == socket_error) {
 #if CFG_OS == CFG_OS_WINDOWS
 			int error_code = WSAGetLastError();
 #elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
@@ -141,6 +120,8 @@ tcp_socket::tcp_socket(const address& ip, bool disable_naggle)
 				);
 			}
 		}
+
+		this->remote_address = remote_endpoint.to_address();
 	} catch (...) {
 		this->close();
 		throw;
@@ -153,12 +134,19 @@ size_t tcp_socket::send(utki::span<const uint8_t> buf)
 		throw std::logic_error("tcp_socket::send(): socket is empty");
 	}
 
+#if CFG_OS == CFG_OS_WINDOWS
+	return send(this->win_sock, buf);
+#else
+	return send(this->handle, buf);
+#endif
+}
+
+size_t tcp_socket::send(socket_type sock, utki::span<const uint8_t> buf)
+{
 #if CFG_OS == CFG_OS_WINDOWS
 	int len = 0;
-	socket_type& sock = this->win_sock;
 #else
 	ssize_t len = 0;
-	int& sock = this->handle;
 #endif
 
 	while (true) {
@@ -205,12 +193,19 @@ size_t tcp_socket::receive(utki::span<uint8_t> buf)
 		throw std::logic_error("tcp_socket::receive(): socket is empty");
 	}
 
+#if CFG_OS == CFG_OS_WINDOWS
+	return receive(this->win_sock, buf);
+#else
+	return receive(this->handle, buf);
+#endif
+}
+
+size_t tcp_socket::receive(socket_type sock, utki::span<uint8_t> buf)
+{
 #if CFG_OS == CFG_OS_WINDOWS
 	int len = 0;
-	socket_type& sock = this->win_sock;
 #else
 	ssize_t len = 0;
-	int& sock = this->handle;
 #endif
 
 	while (true) {
@@ -267,51 +262,127 @@ void tcp_socket::disconnect()
 #endif
 }
 
-namespace {
-address make_ip_address(const sockaddr_storage& addr)
+void tcp_socket::abort() noexcept
 {
-	if (addr.ss_family == AF_INET) {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		const auto& a = reinterpret_cast<const sockaddr_in&>(addr);
-		return {uint32_t(ntohl(a.sin_addr.s_addr)), uint16_t(ntohs(a.sin_port))};
-	} else {
-		ASSERT(addr.ss_family == AF_INET6)
+	if (this->is_empty()) {
+		return;
+	}
+
+	// zero linger timeout makes close() to reset the connection
+	linger l{};
+	l.l_onoff = 1;
+	l.l_linger = 0;
 
+	setsockopt(
+#if CFG_OS == CFG_OS_WINDOWS
+		this->win_sock,
+#else
+		this->handle,
+#endif
+		SOL_SOCKET,
+		SO_LINGER,
 		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		const auto& a = reinterpret_cast<const sockaddr_in6&>(addr);
-
-		return {
-			address::ip(
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
-	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
-				(uint32_t(a.sin6_addr.s6_addr[0]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[1]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[2]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[3]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[4]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[5]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[6]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[7]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[8]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[9]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[10]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[11]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[12]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[13]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[14]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[15]) // NOLINT
+		reinterpret_cast<char*>(&l),
+		sizeof(l)
+	);
+
+	this->close();
+}
+
+bool tcp_socket::close_gracefully(uint32_t timeout_ms)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("tcp_socket::close_gracefully(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_WINDOWS
+	socket_type& sock = this->win_sock;
+	shutdown(sock, SD_SEND);
+#elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	int& sock = this->handle;
+	shutdown(sock, SHUT_WR);
 #else
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[0])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[1])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[2])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[3])) // NOLINT
+#	error "Unsupported OS"
 #endif
-			),
-			uint16_t(ntohs(a.sin6_port))
-		};
+
+	opros::wait_set ws(1);
+	ws.add(*this, utki::make_flags({opros::ready::read}));
+
+	uint32_t start_time = utki::get_ticks_ms();
+
+	bool closed_by_peer = false;
+
+	try {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+		std::array<uint8_t, utki::kilobyte> buf;
+
+		for (;;) {
+			auto len = ::recv(
+				sock,
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				reinterpret_cast<char*>(buf.data()),
+				int(buf.size()),
+#if CFG_OS == CFG_OS_WINDOWS
+				0
+#else
+				MSG_DONTWAIT // don't block
+#endif
+			);
+
+			if (len == 0) {
+				// peer has closed its side of the connection
+				closed_by_peer = true;
+				break;
+			}
+
+			if (len == socket_error) {
+#if CFG_OS == CFG_OS_WINDOWS
+				int error_code = WSAGetLastError();
+#else
+				int error_code = errno;
+#endif
+				if (error_code == error_interrupted) {
+					continue;
+				} else if (error_code == error_connection_reset) {
+					closed_by_peer = true;
+					break;
+				} else if (error_code != error_again) {
+					throw std::system_error(
+						error_code,
+						std::generic_category(),
+						"could not receive data form network, recv() failed"
+					);
+				}
+			}
+
+			uint32_t elapsed = utki::get_ticks_ms() - start_time;
+			if (elapsed >= timeout_ms) {
+				break;
+			}
+
+			if (len == socket_error) {
+				// no data available, wait for more data to arrive
+				ws.wait(timeout_ms - elapsed);
+			}
+
+			// otherwise, received some data, it is discarded, continue reading
+		}
+	} catch (...) {
+		ws.remove(*this);
+		this->abort();
+		throw;
 	}
+
+	ws.remove(*this);
+
+	if (closed_by_peer) {
+		this->close();
+	} else {
+		this->abort();
+	}
+
+	return closed_by_peer;
 }
-} // namespace
 
 address tcp_socket::get_local_address()
 {
@@ -319,18 +390,20 @@ address tcp_socket::get_local_address()
 		throw std::logic_error("tcp_socket::get_local_address(): socket is empty");
 	}
 
-	sockaddr_storage addr{};
+	if (this->local_address.has_value()) {
+		return this->local_address.value();
+	}
+
+	endpoint addr;
+	endpoint::length_type len = endpoint::capacity();
 
 #if CFG_OS == CFG_OS_WINDOWS
-	int len = sizeof(addr);
 	socket_type& sock = this->win_sock;
 #else
-	socklen_t len = sizeof(addr);
 	int& sock = this->handle;
 #endif
 
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-	if (getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len) == socket_error) {
+	if (getsockname(sock, addr.data(), &len) == socket_error) {
 #if CFG_OS == CFG_OS_WINDOWS
 		int error_code = WSAGetLastError();
 #else
@@ -343,7 +416,15 @@ address tcp_socket::get_local_address()
 		);
 	}
 
-	return make_ip_address(addr);
+	addr.set_size(len);
+	auto ret = addr.to_address();
+
+	// the socket might not be bound yet, cache the address only when it has a local port assigned
+	if (ret.port != 0) {
+		this->local_address = ret;
+	}
+
+	return ret;
 }
 
 address tcp_socket::get_remote_address()
@@ -352,18 +433,20 @@ address tcp_socket::get_remote_address()
 		throw std::logic_error("tcp_socket::get_remote_address(): socket is empty");
 	}
 
-	sockaddr_storage addr{};
+	if (this->remote_address.has_value()) {
+		return this->remote_address.value();
+	}
+
+	endpoint addr;
+	endpoint::length_type len = endpoint::capacity();
 
 #if CFG_OS == CFG_OS_WINDOWS
-	int len = sizeof(addr);
 	socket_type& sock = this->win_sock;
 #else
-	socklen_t len = sizeof(addr);
 	int& sock = this->handle;
 #endif
 
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-	if (getpeername(sock, reinterpret_cast<sockaddr*>(&addr), &len) == socket_error) {
+	if (getpeername(sock, addr.data(), &len) == socket_error) {
 #if CFG_OS == CFG_OS_WINDOWS
 		int error_code = WSAGetLastError();
 #else
@@ -376,7 +459,129 @@ address tcp_socket::get_remote_address()
 		);
 	}
 
-	return make_ip_address(addr);
+	addr.set_size(len);
+	this->remote_address = addr.to_address();
+
+	return this->remote_address.value();
+}
+
+bool tcp_socket::is_multipath()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("tcp_socket::is_multipath(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(IPPROTO_MPTCP) && defined(SO_PROTOCOL)
+	int protocol = 0;
+	socklen_t len = sizeof(protocol);
+	if (getsockopt(this->handle, SOL_SOCKET, SO_PROTOCOL, &protocol, &len) != 0) {
+		throw std::system_error(
+			errno,
+			std::generic_category(),
+			"could not get socket protocol, getsockopt(SO_PROTOCOL) failed"
+		);
+	}
+	return protocol == IPPROTO_MPTCP;
+#else
+	return false;
+#endif
+}
+
+tcp_socket::multipath_info tcp_socket::get_multipath_info()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("tcp_socket::get_multipath_info(): socket is empty");
+	}
+
+	multipath_info ret;
+
+#if CFG_OS == CFG_OS_LINUX && defined(SOL_MPTCP) && defined(MPTCP_INFO)
+	mptcp_info info{};
+	socklen_t len = sizeof(info);
+	if (getsockopt(this->handle, SOL_MPTCP, MPTCP_INFO, &info, &len) != 0) {
+		int error_code = errno;
+		if (error_code == EOPNOTSUPP || error_code == ENOPROTOOPT) {
+			// not an MPTCP socket or the connection has fallen back to plain TCP
+			return ret;
+		}
+		throw std::system_error(
+			error_code,
+			std::generic_category(),
+			"could not get MPTCP info, getsockopt(MPTCP_INFO) failed"
+		);
+	}
+
+	ret.num_subflows = info.mptcpi_subflows;
+	ret.max_subflows = info.mptcpi_subflows_max;
+	ret.num_addresses_announced = info.mptcpi_add_addr_signal;
+	ret.num_addresses_accepted = info.mptcpi_add_addr_accepted;
+	ret.num_local_addresses_used = info.mptcpi_local_addr_used;
+	ret.fallback = (info.mptcpi_flags & MPTCP_INFO_FLAG_FALLBACK) != 0;
+#endif
+
+	return ret;
+}
+
+std::vector<tcp_socket::multipath_subflow> tcp_socket::get_multipath_subflows()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("tcp_socket::get_multipath_subflows(): socket is empty");
+	}
+
+	std::vector<multipath_subflow> ret;
+
+#if CFG_OS == CFG_OS_LINUX && defined(SOL_MPTCP) && defined(MPTCP_SUBFLOW_ADDRS)
+	// by default the kernel allows up to 8 subflows per connection
+	constexpr auto initial_capacity = 8;
+
+	for (size_t capacity = initial_capacity;;) {
+		std::vector<uint8_t> buf(sizeof(mptcp_subflow_data) + capacity * sizeof(mptcp_subflow_addrs));
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto& header = *reinterpret_cast<mptcp_subflow_data*>(buf.data());
+		header.size_subflow_data = sizeof(mptcp_subflow_data);
+		header.size_user = sizeof(mptcp_subflow_addrs);
+
+		auto len = socklen_t(buf.size());
+		if (getsockopt(this->handle, SOL_MPTCP, MPTCP_SUBFLOW_ADDRS, buf.data(), &len) != 0) {
+			int error_code = errno;
+			if (error_code == EOPNOTSUPP || error_code == ENOPROTOOPT) {
+				// not an MPTCP socket
+				return ret;
+			}
+			throw std::system_error(
+				error_code,
+				std::generic_category(),
+				"could not get MPTCP subflows, getsockopt(MPTCP_SUBFLOW_ADDRS) failed"
+			);
+		}
+
+		if (header.num_subflows > capacity) {
+			capacity = header.num_subflows;
+			continue;
+		}
+
+		for (unsigned i = 0; i != header.num_subflows; ++i) {
+			mptcp_subflow_addrs addrs{};
+			memcpy(
+				&addrs,
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				buf.data() + header.size_subflow_data + i * header.size_user,
+				std::min(sizeof(addrs), size_t(header.size_user))
+			);
+
+			ret.push_back({
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				endpoint(reinterpret_cast<const sockaddr*>(&addrs.ss_local), sizeof(addrs.ss_local)).to_address(),
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				endpoint(reinterpret_cast<const sockaddr*>(&addrs.ss_remote), sizeof(addrs.ss_remote)).to_address()
+			});
+		}
+		break;
+	}
+#endif
+
+	return ret;
 }
 
 #if CFG_OS == CFG_OS_WINDOWS
@@ -26,15 +26,21 @@ SOFTWARE.
 
 #pragma once
 
+#include <optional>
+#include <vector>
+
 #include <utki/config.hpp>
 #include <utki/span.hpp>
 
 #include "address.hpp"
+#include "endpoint.hpp"
 #include "socket.hpp"
 
 namespace setka {
 
 class tcp_server_socket;
+class connection_table;
+class tcp_zerocopy_receiver;
 
 /**
  * @brief a class which represents a TCP socket.
@@ -42,6 +48,17 @@ class tcp_server_socket;
 class tcp_socket : public socket
 {
 	friend class setka::tcp_server_socket;
+	friend class setka::connection_table;
+	friend class setka::tcp_zerocopy_receiver;
+
+	// cached addresses of the connection endpoints
+	std::optional<address> local_address;
+	std::optional<address> remote_address;
+
+	static socket_type create_stream_socket(int family, bool multipath);
+
+	static size_t send(socket_type sock, utki::span<const uint8_t> buf);
+	static size_t receive(socket_type sock, utki::span<uint8_t> buf);
 
 public:
 	/**
@@ -54,19 +71,40 @@ public:
 	 * This constructor connects the socket to remote TCP server socket.
 	 * @param address - IP address.
 	 * @param disable_naggle - enable/disable Naggle algorithm.
+	 * @param multipath - create Multipath TCP (MPTCP) socket. If MPTCP is not supported by the OS,
+	 *                    then the plain TCP socket is created. MPTCP is only supported on Linux.
 	 */
-	tcp_socket(const address& address, bool disable_naggle = false);
+	tcp_socket(const address& address, bool disable_naggle = false, bool multipath = false);
+
+	/**
+	 * @brief Creates and connects the socket to the endpoint.
+	 * Same as tcp_socket(address, disable_naggle, multipath), but the remote address is given in the OS native format.
+	 * @param remote_endpoint - endpoint of the remote TCP server socket.
+	 * @param disable_naggle - enable/disable Naggle algorithm.
+	 * @param multipath - create Multipath TCP (MPTCP) socket.
+	 */
+	tcp_socket(const endpoint& remote_endpoint, bool disable_naggle = false, bool multipath = false);
 
 	tcp_socket(const tcp_socket&) = delete;
 	tcp_socket& operator=(const tcp_socket&) = delete;
 
 	tcp_socket(tcp_socket&& s) noexcept :
-		socket(std::move(s))
-	{}
+		socket(std::move(s)),
+		local_address(s.local_address),
+		remote_address(s.remote_address)
+	{
+		s.reset_address_cache();
+	}
 
 	tcp_socket& operator=(tcp_socket&& s) noexcept
 	{
+		if (this == &s) {
+			return *this;
+		}
 		this->socket::operator=(std::move(s));
+		this->local_address = s.local_address;
+		this->remote_address = s.remote_address;
+		s.reset_address_cache();
 		return *this;
 	}
 
@@ -101,18 +139,121 @@ public:
 
 	void disconnect();
 
+	/**
+	 * @brief Abortively close the connection.
+	 * Sets SO_LINGER option with zero timeout and closes the socket.
+	 * This makes the connection to be reset (RST is sent to the peer) instead of being closed gracefully,
+	 * so that the connection does not linger in TIME_WAIT state.
+	 * All the data which is not yet sent is discarded.
+	 * After this call the socket is empty.
+	 */
+	void abort() noexcept;
+
+	/**
+	 * @brief Gracefully close the connection.
+	 * Shuts down the sending side of the connection, i.e. sends FIN to the peer, then reads and
+	 * discards all incoming data until the peer closes its side of the connection or the timeout is hit.
+	 * After that the socket is closed. In case the timeout is hit, the connection is reset as with abort().
+	 * This method blocks for at most timeout_ms milliseconds.
+	 * After this call the socket is empty.
+	 * @param timeout_ms - maximum time to wait for the peer to close its side of the connection, in milliseconds.
+	 * @return true if the peer has closed the connection before the timeout.
+	 * @return false if the timeout was hit.
+	 */
+	bool close_gracefully(uint32_t timeout_ms);
+
 	/**
 	 * @brief Get local IP address and port.
+	 * The address is queried from the system once the socket is bound to a local port
+	 * and is cached after that.
 	 * @return IP address and port of the local socket.
 	 */
 	address get_local_address();
 
 	/**
 	 * @brief Get remote IP address and port.
+	 * The address is known right away for sockets created by connecting to a remote host and
+	 * for sockets accepted by tcp_server_socket, otherwise it is queried from the system once
+	 * and cached after that.
 	 * @return IP address and port of the peer socket.
 	 */
 	address get_remote_address();
 
+	/**
+	 * @brief Drop cached local and remote addresses.
+	 * Next calls to get_local_address() and get_remote_address() will query the addresses from the system.
+	 */
+	void reset_address_cache() noexcept
+	{
+		this->local_address.reset();
+		this->remote_address.reset();
+	}
+
+	/**
+	 * @brief Check if the socket is a Multipath TCP socket.
+	 * @return true if the socket was created as MPTCP socket.
+	 * @return false if the socket is a plain TCP socket.
+	 */
+	bool is_multipath();
+
+	/**
+	 * @brief Multipath TCP connection information.
+	 */
+	struct multipath_info {
+		/**
+		 * @brief Number of additional subflows of the connection.
+		 * Does not include the initial subflow.
+		 */
+		unsigned num_subflows = 0;
+
+		/**
+		 * @brief Maximum number of additional subflows allowed for the connection.
+		 */
+		unsigned max_subflows = 0;
+
+		/**
+		 * @brief Number of addresses announced to the peer.
+		 */
+		unsigned num_addresses_announced = 0;
+
+		/**
+		 * @brief Number of addresses announced by the peer and accepted.
+		 */
+		unsigned num_addresses_accepted = 0;
+
+		/**
+		 * @brief Number of local addresses used by subflows.
+		 */
+		unsigned num_local_addresses_used = 0;
+
+		/**
+		 * @brief Whether the connection has fallen back to plain TCP.
+		 * It is true for plain TCP sockets, or if the peer does not support MPTCP.
+		 */
+		bool fallback = true;
+	};
+
+	/**
+	 * @brief Get Multipath TCP connection information.
+	 * @return MPTCP information of the connection.
+	 */
+	multipath_info get_multipath_info();
+
+	/**
+	 * @brief Multipath TCP subflow endpoints.
+	 */
+	struct multipath_subflow {
+		address local;
+		address remote;
+	};
+
+	/**
+	 * @brief Get subflows of Multipath TCP connection.
+	 * @return list of local and remote addresses of all the subflows of the connection.
+	 *         Empty list for plain TCP sockets.
+	 */
+	std::vector<multipath_subflow> get_multipath_subflows();
+
 #if CFG_OS == CFG_OS_WINDOWS
 
 private:
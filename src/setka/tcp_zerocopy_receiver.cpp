@@ -0,0 +1,136 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "tcp_zerocopy_receiver.hpp"
+
+#include <algorithm>
+
+#if CFG_OS == CFG_OS_LINUX
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+using namespace setka;
+
+tcp_zerocopy_receiver::tcp_zerocopy_receiver(tcp_socket& socket, size_t region_size, size_t copy_buffer_size) :
+	socket(socket),
+	copy_buffer(copy_buffer_size)
+{
+	if (socket.is_empty()) {
+		throw std::logic_error("tcp_zerocopy_receiver::tcp_zerocopy_receiver(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(TCP_ZEROCOPY_RECEIVE)
+	auto page_size = size_t(sysconf(_SC_PAGESIZE));
+	region_size = ((region_size + page_size - 1) / page_size) * page_size;
+
+	void* addr = mmap(nullptr, region_size, PROT_READ, MAP_SHARED, socket.handle, 0);
+	if (addr != MAP_FAILED) {
+		this->region = utki::span<uint8_t>(static_cast<uint8_t*>(addr), region_size);
+	}
+	// otherwise, zero-copy receive is not supported, all received data will be copied
+#endif
+}
+
+tcp_zerocopy_receiver::~tcp_zerocopy_receiver() noexcept
+{
+#if CFG_OS == CFG_OS_LINUX
+	if (!this->region.empty()) {
+		munmap(this->region.data(), this->region.size());
+	}
+#endif
+}
+
+void tcp_zerocopy_receiver::release() noexcept
+{
+#if CFG_OS == CFG_OS_LINUX
+	if (this->mapped_size != 0) {
+		madvise(this->region.data(), this->mapped_size, MADV_DONTNEED);
+	}
+#endif
+	this->mapped_size = 0;
+}
+
+tcp_zerocopy_receiver::received_data tcp_zerocopy_receiver::receive()
+{
+	if (this->socket.is_empty()) {
+		throw std::logic_error("tcp_zerocopy_receiver::receive(): socket is empty");
+	}
+
+	this->release();
+
+	received_data ret;
+
+	size_t num_bytes_to_copy = this->copy_buffer.size();
+
+#if CFG_OS == CFG_OS_LINUX && defined(TCP_ZEROCOPY_RECEIVE)
+	if (!this->region.empty()) {
+		tcp_zerocopy_receive zc{};
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		zc.address = reinterpret_cast<uintptr_t>(this->region.data());
+		zc.length = uint32_t(this->region.size());
+
+		socklen_t zc_len = sizeof(zc);
+
+		int res = 0;
+		do {
+			res = getsockopt(this->socket.handle, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_len);
+		} while (res != 0 && errno == EINTR);
+
+		if (res != 0) {
+			int error_code = errno;
+			if (error_code != EAGAIN) {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not receive data form network, getsockopt(TCP_ZEROCOPY_RECEIVE) failed"
+				);
+			}
+			// no data available
+			return ret;
+		}
+
+		this->mapped_size = zc.length;
+		ret.mapped = this->region.subspan(0, this->mapped_size);
+
+		if (this->mapped_size != 0) {
+			// only the data which could not be mapped needs to be copied
+			num_bytes_to_copy = std::min(num_bytes_to_copy, size_t(zc.recv_skip_hint));
+			if (num_bytes_to_copy == 0) {
+				return ret;
+			}
+		}
+	}
+#endif
+
+	auto num_bytes_copied =
+		this->socket.receive(utki::span<uint8_t>(this->copy_buffer.data(), num_bytes_to_copy));
+	ret.copied = utki::span<const uint8_t>(this->copy_buffer.data(), num_bytes_copied);
+
+	return ret;
+}
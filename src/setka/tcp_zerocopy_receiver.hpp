@@ -0,0 +1,125 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+#include <utki/types.hpp>
+
+#include "tcp_socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief Zero-copy receiver for TCP socket.
+ * On Linux the received data is mapped by the kernel directly into a memory region associated
+ * with the socket using TCP_ZEROCOPY_RECEIVE, without copying it to user buffers.
+ * Only whole pages of received data can be mapped, the rest of the data, e.g. unaligned tail,
+ * is copied to the internal buffer.
+ * In case zero-copy receive is not supported by the OS, all the data is copied to the internal buffer.
+ * Zero-copy receive pays off for bulk transfers of large amounts of data over a single connection.
+ */
+class tcp_zerocopy_receiver
+{
+	tcp_socket& socket;
+
+	utki::span<uint8_t> region;
+	size_t mapped_size = 0;
+
+	std::vector<uint8_t> copy_buffer;
+
+public:
+	constexpr static const size_t default_region_size = utki::kilobyte * utki::kilobyte * 2;
+	constexpr static const size_t default_copy_buffer_size = utki::kilobyte * 64;
+
+	/**
+	 * @brief Create zero-copy receiver for the socket.
+	 * The socket must outlive the receiver object.
+	 * @param socket - connected TCP socket to receive data from.
+	 * @param region_size - size of the memory region to map received data to, in bytes.
+	 *                      It is rounded up to a multiple of memory page size.
+	 * @param copy_buffer_size - size of the buffer for received data which cannot be mapped, in bytes.
+	 */
+	tcp_zerocopy_receiver(
+		tcp_socket& socket,
+		size_t region_size = default_region_size,
+		size_t copy_buffer_size = default_copy_buffer_size
+	);
+
+	tcp_zerocopy_receiver(const tcp_zerocopy_receiver&) = delete;
+	tcp_zerocopy_receiver& operator=(const tcp_zerocopy_receiver&) = delete;
+
+	tcp_zerocopy_receiver(tcp_zerocopy_receiver&&) = delete;
+	tcp_zerocopy_receiver& operator=(tcp_zerocopy_receiver&&) = delete;
+
+	~tcp_zerocopy_receiver() noexcept;
+
+	/**
+	 * @brief Check if zero-copy receive is in use.
+	 * @return true if received data is mapped without copying.
+	 * @return false if all the received data is copied.
+	 */
+	bool is_zerocopy() const noexcept
+	{
+		return !this->region.empty();
+	}
+
+	/**
+	 * @brief Received data.
+	 * The data comes in two parts, first part is the mapped data and second part is the copied data,
+	 * in order of receiving. Either part can be empty.
+	 */
+	struct received_data {
+		utki::span<const uint8_t> mapped;
+		utki::span<const uint8_t> copied;
+
+		size_t size() const noexcept
+		{
+			return this->mapped.size() + this->copied.size();
+		}
+	};
+
+	/**
+	 * @brief Receive data from the socket.
+	 * Same as tcp_socket::receive() this function does not block and returns empty data if there
+	 * is no data available.
+	 * The returned data stays valid until release() is called. Calling receive() releases
+	 * the data returned by the previous call.
+	 * @return received data.
+	 */
+	received_data receive();
+
+	/**
+	 * @brief Release received data.
+	 * Unmaps the pages of the data returned by the last call to receive().
+	 */
+	void release() noexcept;
+};
+
+} // namespace setka
@@ -0,0 +1,92 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "udp_receive_group.hpp"
+
+#include <array>
+
+#if CFG_OS == CFG_OS_LINUX
+#	include <linux/filter.h>
+#endif
+
+using namespace setka;
+
+udp_receive_group::udp_receive_group(uint16_t port, size_t num_sockets, bool steer_by_cpu)
+{
+	if (port == 0) {
+		throw std::invalid_argument("udp_receive_group::udp_receive_group(): port is 0");
+	}
+
+	if (num_sockets == 0) {
+		throw std::invalid_argument("udp_receive_group::udp_receive_group(): number of sockets is 0");
+	}
+
+	this->sockets.reserve(num_sockets);
+
+	// sockets are added to the OS-level group in the order of binding,
+	// so the socket index in the vector is the same as the index in the OS-level group
+	for (size_t i = 0; i != num_sockets; ++i) {
+		this->sockets.emplace_back(port, true);
+	}
+
+	if (!steer_by_cpu) {
+		return;
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(SO_ATTACH_REUSEPORT_CBPF)
+	// the program returns the index of the socket in the group to deliver the datagram to:
+	// number of the current CPU modulo number of sockets
+	std::array<sock_filter, 3> code = {
+		{
+			{BPF_LD | BPF_W | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU)},
+			{BPF_ALU | BPF_MOD | BPF_K, 0, 0, uint32_t(num_sockets)},
+			{BPF_RET | BPF_A, 0, 0, 0},
+		}
+	};
+
+	sock_fprog program{};
+	program.len = uint16_t(code.size());
+	program.filter = code.data();
+
+	// the program is attached to the whole OS-level group, so attaching to any of the sockets is enough
+	if (setsockopt(
+			this->sockets.front().handle,
+			SOL_SOCKET,
+			SO_ATTACH_REUSEPORT_CBPF,
+			&program,
+			sizeof(program)
+		) != 0)
+	{
+		throw std::system_error(
+			errno,
+			std::generic_category(),
+			"could not attach reuseport steering program, setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed"
+		);
+	}
+#else
+	throw std::runtime_error("udp_receive_group::udp_receive_group(): steering by CPU is not supported on this OS");
+#endif
+}
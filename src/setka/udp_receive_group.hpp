@@ -0,0 +1,116 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#include "udp_socket.hpp"
+
+namespace setka {
+
+/**
+ * @brief Group of UDP sockets sharing one port.
+ * The group consists of several UDP sockets bound to the same port with SO_REUSEPORT option.
+ * The OS distributes incoming datagrams among the sockets, by default by hash of the sender address,
+ * so datagrams of one flow always go to the same socket. Each socket is intended to be served by its own
+ * worker thread, so that datagram processing scales with the number of CPU cores.
+ *
+ * Optionally, the datagrams can be steered by CPU: a datagram is delivered to the socket with index
+ * equal to the number of CPU which has received the datagram from the network device (modulo number of sockets).
+ * In this mode, the worker thread serving the socket number i is supposed to be pinned to the CPU number i,
+ * and the network device interrupts to be distributed among the CPUs, so that the datagram
+ * is processed on the same CPU it was received on.
+ *
+ * Not supported on Windows.
+ */
+class udp_receive_group
+{
+	std::vector<udp_socket> sockets;
+
+public:
+	/**
+	 * @brief Create and open the group of sockets.
+	 * @param port - IP port number on which the sockets will listen for incoming datagrams, must not be 0.
+	 * @param num_sockets - number of sockets in the group, must not be 0.
+	 * @param steer_by_cpu - whether to deliver datagrams to the socket by number of the receiving CPU.
+	 *                       Only supported on Linux (SO_ATTACH_REUSEPORT_CBPF).
+	 */
+	udp_receive_group(uint16_t port, size_t num_sockets, bool steer_by_cpu = false);
+
+	udp_receive_group(const udp_receive_group&) = delete;
+	udp_receive_group& operator=(const udp_receive_group&) = delete;
+
+	udp_receive_group(udp_receive_group&&) = default;
+	udp_receive_group& operator=(udp_receive_group&&) = default;
+
+	~udp_receive_group() = default;
+
+	/**
+	 * @brief Get number of sockets in the group.
+	 * @return number of sockets.
+	 */
+	size_t size() const noexcept
+	{
+		return this->sockets.size();
+	}
+
+	/**
+	 * @brief Get socket by index.
+	 * @param i - index of the socket.
+	 * @return reference to the socket.
+	 */
+	udp_socket& operator[](size_t i)
+	{
+		return this->sockets[i];
+	}
+
+	/**
+	 * @brief Get all sockets of the group.
+	 * @return span of the sockets.
+	 */
+	utki::span<udp_socket> get_sockets() noexcept
+	{
+		return utki::make_span(this->sockets);
+	}
+
+	/**
+	 * @brief Release sockets from the group.
+	 * Moves the sockets out of the group, for example to hand them over to worker threads.
+	 * The sockets remain members of the OS-level port sharing group until they are closed.
+	 * @return the sockets.
+	 */
+	std::vector<udp_socket> release() noexcept
+	{
+		return std::move(this->sockets);
+	}
+};
+
+} // namespace setka
@@ -24,19 +24,37 @@ SOFTWARE.
 
 /* ================ LICENSE END ================ */
 
+// request RFC 3542 advanced IPv6 socket API (IPV6_RECVPKTINFO) on macOS
+#ifdef __APPLE__
+#	define __APPLE_USE_RFC_3542
+#endif
+
 #include "udp_socket.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <limits>
+#include <ratio>
 
 #if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
 #	include <netinet/in.h>
 #endif
 
+#if CFG_OS == CFG_OS_LINUX
+#	include <linux/net_tstamp.h>
+#	include <netinet/udp.h>
+#endif
+
 using namespace setka;
 
-udp_socket::udp_socket(uint16_t port) :
-	ipv4(false)
+udp_socket::udp_socket(uint16_t port, bool reuse_port) :
+	// 'any' IPv6 address allows receiving both IPv4 and IPv6 datagrams
+	udp_socket(port == 0 ? endpoint() : endpoint(address(address::ip(0, 0, 0, 0), port)), reuse_port)
+{}
+
+udp_socket::udp_socket(const endpoint& local_endpoint, bool reuse_port) :
+	ipv4(local_endpoint.get_family() == AF_INET)
 {
 #if CFG_OS == CFG_OS_WINDOWS
 	this->create_event_for_waitable();
@@ -45,10 +63,10 @@ udp_socket::udp_socket(uint16_t port) :
 	int& sock = this->handle;
 #endif
 
-	sock = ::socket(PF_INET6, SOCK_DGRAM, 0);
+	sock = this->ipv4 ? invalid_socket : ::socket(PF_INET6, SOCK_DGRAM, 0);
 
 	if (sock == invalid_socket) {
-		// maybe IPv6 is not supported by OS, try to proceed with IPv4 socket then
+		// either IPv4 endpoint is given, or maybe IPv6 is not supported by OS, try to proceed with IPv4 socket then
 		sock = ::socket(PF_INET, SOCK_DGRAM, 0);
 
 		if (sock == invalid_socket) {
@@ -101,36 +119,32 @@ udp_socket::udp_socket(uint16_t port) :
 	}
 
 	try {
+		if (reuse_port) {
+#if defined(SO_REUSEPORT) && CFG_OS != CFG_OS_WINDOWS
+			int yes = 1;
+			if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == socket_error) {
+				throw std::system_error(
+					errno,
+					std::generic_category(),
+					"could not set SO_REUSEPORT option, setsockopt() failed"
+				);
+			}
+#else
+			throw std::runtime_error("udp_socket::udp_socket(): port reuse is not supported on this OS");
+#endif
+		}
+
 		// bind locally, if appropriate
-		if (port != 0) {
-			sockaddr_storage socket_address{};
-			socklen_t socket_address_length = 0;
-
-			if (this->ipv4) {
-				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-				auto& sa = reinterpret_cast<sockaddr_in&>(socket_address);
-				memset(&sa, 0, sizeof(sa));
-				sa.sin_family = AF_INET;
-				sa.sin_addr.s_addr = INADDR_ANY;
-				sa.sin_port = htons(port);
-				socket_address_length = sizeof(sa);
-			} else {
-				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-				auto& sa = reinterpret_cast<sockaddr_in6&>(socket_address);
-				memset(&sa, 0, sizeof(sa));
-				sa.sin6_family = AF_INET6;
-				sa.sin6_addr = in6addr_any; // 'in6addr_any' allows accepting both IPv4 and IPv6 connections
-				sa.sin6_port = htons(port);
-				socket_address_length = sizeof(sa);
+		if (!local_endpoint.empty()) {
+			endpoint e = local_endpoint;
+
+			if (this->ipv4 && e.get_family() == AF_INET6 && e.to_address().host == address::ip(0, 0, 0, 0)) {
+				// IPv6 is not supported by OS, bind to 'any' IPv4 address instead
+				e = endpoint(address(address::ip(0), e.get_port()));
 			}
 
 			// bind the socket for listening
-			if (::bind(
-					sock,
-					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-					reinterpret_cast<struct sockaddr*>(&socket_address),
-					socket_address_length
-				) == socket_error)
+			if (::bind(sock, e.data(), e.size()) == socket_error)
 			{
 #if CFG_OS == CFG_OS_WINDOWS
 				int error_code = WSAGetLastError();
@@ -181,78 +195,55 @@ udp_socket::udp_socket(uint16_t port) :
 	}
 }
 
-size_t udp_socket::send(utki::span<const uint8_t> buf, const address& destination_address)
+namespace {
+#if CFG_OS == CFG_OS_WINDOWS
+using socket_address_length_type = int;
+#else
+using socket_address_length_type = socklen_t;
+#endif
+
+// some systems require IPv4 destinations to be given as IPv4 mapped IPv6 addresses to dual-stack sockets
+const endpoint& to_socket_family(
+	const endpoint& e,
+	[[maybe_unused]] endpoint& mapped,
+	[[maybe_unused]] bool ipv4_socket
+)
 {
-	if (this->is_empty()) {
-		throw std::logic_error("udp_socket::send(): socket is empty");
+#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS
+	if (!ipv4_socket && e.get_family() == AF_INET) {
+		mapped = e.to_v6_mapped();
+		return mapped;
 	}
+#endif
+	return e;
+}
 
-	sockaddr_storage socket_address{};
-	socklen_t socket_address_length = 0;
+socket_address_length_type make_socket_address(
+	sockaddr_storage& socket_address,
+	const address& addr,
+	bool ipv4_socket
+)
+{
+	endpoint native(addr);
+	endpoint mapped;
+	const auto& e = to_socket_family(native, mapped, ipv4_socket);
+	memcpy(&socket_address, e.data(), size_t(e.size()));
+	return e.size();
+}
 
-	if(
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS
-			this->ipv4 &&
-#endif
-			destination_address.host.is_v4()
-		)
-	{
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& a = reinterpret_cast<sockaddr_in&>(socket_address);
-		memset(&a, 0, sizeof(a));
-		a.sin_family = AF_INET;
-		a.sin_addr.s_addr = htonl(destination_address.host.get_v4());
-		a.sin_port = htons(destination_address.port);
-		socket_address_length = sizeof(a);
-	} else {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& a = reinterpret_cast<sockaddr_in6&>(socket_address);
-		memset(&a, 0, sizeof(a));
-		a.sin6_family = AF_INET6;
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
-	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[0] = destination_address.host.quad[0] >> (utki::byte_bits * 3);
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[1] = (destination_address.host.quad[0] >> (utki::byte_bits * 2)) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[2] = (destination_address.host.quad[0] >> utki::byte_bits) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[3] = destination_address.host.quad[0] & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[4] = destination_address.host.quad[1] >> (utki::byte_bits * 3);
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[5] = (destination_address.host.quad[1] >> (utki::byte_bits * 2)) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[6] = (destination_address.host.quad[1] >> utki::byte_bits) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[7] = destination_address.host.quad[1] & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[8] = destination_address.host.quad[2] >> (utki::byte_bits * 3);
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[9] = (destination_address.host.quad[2] >> (utki::byte_bits * 2)) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[10] = (destination_address.host.quad[2] >> utki::byte_bits) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[11] = destination_address.host.quad[2] & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[12] = destination_address.host.quad[3] >> (utki::byte_bits * 3);
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[13] = (destination_address.host.quad[3] >> (utki::byte_bits * 2)) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[14] = (destination_address.host.quad[3] >> utki::byte_bits) & utki::byte_mask;
-		// NOLINTNEXTLINE
-		a.sin6_addr.s6_addr[15] = destination_address.host.quad[3] & utki::byte_mask;
-#else
-		a.sin6_addr.__in6_u.__u6_addr32[0] = htonl(destination_address.host.quad[0]); // NOLINT
-		a.sin6_addr.__in6_u.__u6_addr32[1] = htonl(destination_address.host.quad[1]); // NOLINT
-		a.sin6_addr.__in6_u.__u6_addr32[2] = htonl(destination_address.host.quad[2]); // NOLINT
-		a.sin6_addr.__in6_u.__u6_addr32[3] = htonl(destination_address.host.quad[3]); // NOLINT
-#endif
-		a.sin6_port = htons(destination_address.port);
-		socket_address_length = sizeof(a);
-	}
+address make_address(const sockaddr_storage& socket_address)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	return endpoint(reinterpret_cast<const sockaddr*>(&socket_address), sizeof(socket_address)).to_address();
+}
+} // namespace
 
+udp_socket::send_status udp_socket::send_to(
+	utki::span<const uint8_t> buf,
+	const sockaddr* socket_address,
+	size_t socket_address_length
+)
+{
 #if CFG_OS == CFG_OS_WINDOWS
 	int len = 0;
 	socket_type& sock = this->win_sock;
@@ -268,9 +259,8 @@ size_t udp_socket::send(utki::span<const uint8_t> buf, const address& destinatio
 			reinterpret_cast<const char*>(buf.data()),
 			int(buf.size()),
 			0,
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			reinterpret_cast<struct sockaddr*>(&socket_address),
-			socket_address_length
+			socket_address,
+			socket_address_length_type(socket_address_length)
 		);
 
 		if (len == socket_error) {
@@ -282,8 +272,10 @@ size_t udp_socket::send(utki::span<const uint8_t> buf, const address& destinatio
 			if (error_code == error_interrupted) {
 				continue;
 			} else if (error_code == error_again) {
-				// can't send more bytes, return 0 bytes sent
-				len = 0;
+				++this->stats.send_would_block;
+				return send_status::would_block;
+			} else if (error_code == error_message_too_large) {
+				return send_status::message_too_large;
 			} else {
 				throw std::system_error(
 					error_code,
@@ -296,47 +288,68 @@ size_t udp_socket::send(utki::span<const uint8_t> buf, const address& destinatio
 	}
 
 	ASSERT(buf.size() <= size_t(std::numeric_limits<int>::max()))
-	ASSERT(len <= int(buf.size()), [&](auto& o) {
-		o << "res = " << len;
-	})
-	ASSERT((len == int(buf.size())) || (len == 0), [&](auto& o) {
+	ASSERT(len == int(buf.size()), [&](auto& o) {
 		o << "res = " << len;
 	})
 
-	ASSERT(len >= 0)
-	return size_t(len);
+	++this->stats.datagrams_sent;
+	this->stats.bytes_sent += uint64_t(len);
+
+	return send_status::sent;
 }
 
-size_t udp_socket::recieve(utki::span<uint8_t> buf, address& out_sender_address)
+size_t udp_socket::send_datagram(
+	utki::span<const uint8_t> buf,
+	const sockaddr* socket_address,
+	size_t socket_address_length
+)
 {
-	if (this->is_empty()) {
-		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	switch (this->send_to(buf, socket_address, socket_address_length)) {
+		case send_status::sent:
+			return buf.size();
+		case send_status::would_block:
+			// can't send more bytes, return 0 bytes sent
+			return 0;
+		case send_status::message_too_large:
+			break;
 	}
+	throw std::system_error(
+		error_message_too_large,
+		std::generic_category(),
+		"could not send data over UDP, sendto() failed"
+	);
+}
 
-	sockaddr_storage socket_address{};
+size_t udp_socket::receive_from(utki::span<uint8_t> buf, endpoint* out_sender)
+{
+	socket_address_length_type socket_address_length = endpoint::capacity();
 
 #if CFG_OS == CFG_OS_WINDOWS
-	int socket_address_length = sizeof(socket_address);
 	int len = 0;
 	socket_type& sock = this->win_sock;
 #elif CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
-	socklen_t socket_address_length = sizeof(socket_address);
 	ssize_t len = 0;
 	int& sock = this->handle;
 #else
 #	error "Unsupported OS"
 #endif
 
+#if CFG_OS == CFG_OS_LINUX
+	// make recvfrom() return real datagram size to detect truncation
+	constexpr int flags = MSG_TRUNC;
+#else
+	constexpr int flags = 0;
+#endif
+
 	while (true) {
 		len = ::recvfrom(
 			sock,
 			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
 			reinterpret_cast<char*>(buf.data()),
 			int(buf.size()),
-			0,
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			reinterpret_cast<sockaddr*>(&socket_address),
-			&socket_address_length
+			flags,
+			out_sender ? out_sender->data() : nullptr,
+			out_sender ? &socket_address_length : nullptr
 		);
 
 		if (len == socket_error) {
@@ -348,6 +361,7 @@ size_t udp_socket::recieve(utki::span<uint8_t> buf, address& out_sender_address)
 			if (error_code == error_interrupted) {
 				continue;
 			} else if (error_code == error_again) {
+				++this->stats.receive_would_block;
 				return 0; // no data available, return 0 bytes received
 			} else {
 				throw std::system_error(
@@ -361,54 +375,1640 @@ size_t udp_socket::recieve(utki::span<uint8_t> buf, address& out_sender_address)
 	}
 
 	ASSERT(buf.size() <= size_t(std::numeric_limits<int>::max()))
-	ASSERT(len <= int(buf.size()), [&](auto& o) {
-		o << "len = " << len;
-	})
+	ASSERT(len >= 0)
+
+	if (out_sender) {
+		out_sender->set_size(socket_address_length);
+	}
+
+	if (size_t(len) > buf.size()) {
+		// datagram was truncated
+		++this->stats.truncated;
+		len = decltype(len)(buf.size());
+	}
+
+	++this->stats.datagrams_received;
+	this->stats.bytes_received += uint64_t(len);
+
+	return size_t(len);
+}
+
+size_t udp_socket::send(utki::span<const uint8_t> buf, const address& destination_address)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send(): socket is empty");
+	}
+
+	return this->send(buf, endpoint(destination_address));
+}
+
+size_t udp_socket::send(utki::span<const uint8_t> buf, const endpoint& destination)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send(): socket is empty");
+	}
+
+	endpoint mapped;
+	const auto& e = to_socket_family(destination, mapped, this->ipv4);
+
+	return this->send_datagram(buf, e.data(), size_t(e.size()));
+}
+
+udp_socket::send_status udp_socket::try_send(utki::span<const uint8_t> buf, const address& destination_address)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::try_send(): socket is empty");
+	}
+
+	return this->try_send(buf, endpoint(destination_address));
+}
+
+udp_socket::send_status udp_socket::try_send(utki::span<const uint8_t> buf, const endpoint& destination)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::try_send(): socket is empty");
+	}
+
+	endpoint mapped;
+	const auto& e = to_socket_family(destination, mapped, this->ipv4);
+
+	return this->send_to(buf, e.data(), size_t(e.size()));
+}
+
+udp_socket::send_status udp_socket::try_send(utki::span<const uint8_t> buf)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::try_send(): socket is empty");
+	}
+
+	return this->send_to(buf, nullptr, 0);
+}
+
+size_t udp_socket::send(utki::span<const uint8_t> buf)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send(): socket is empty");
+	}
+
+	return this->send_datagram(buf, nullptr, 0);
+}
+
+size_t udp_socket::recieve(utki::span<uint8_t> buf, address& out_sender_address)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	}
+
+	endpoint sender;
+
+	size_t len = this->recieve(buf, sender);
+
+	// address family is unset if no datagram was received
+	if (sender.get_family() != AF_UNSPEC) {
+		out_sender_address = sender.to_address();
+	}
+
+	return len;
+}
+
+size_t udp_socket::recieve(utki::span<uint8_t> buf, endpoint& out_sender)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	if (this->drop_counter_enabled) {
+		// drop counter is only reported via control messages
+		segmented_datagram_info info;
+		endpoint sender;
+		size_t len = this->receive_message(buf, sender, info, nullptr);
+		if (sender.get_family() != AF_UNSPEC) {
+			out_sender = sender;
+		}
+		return len;
+	}
+#endif
+
+	endpoint sender;
+
+	size_t len = this->receive_from(buf, &sender);
+
+	// address family is unset if no datagram was received
+	if (sender.get_family() != AF_UNSPEC) {
+		out_sender = sender;
+	}
+
+	return len;
+}
+
+size_t udp_socket::recieve(utki::span<uint8_t> buf)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	}
+
+	return this->receive_from(buf, nullptr);
+}
+
+void udp_socket::connect(const address& peer_address)
+{
+	this->connect(endpoint(peer_address));
+}
+
+void udp_socket::connect(const endpoint& peer)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::connect(): socket is empty");
+	}
+
+	endpoint mapped;
+	const auto& e = to_socket_family(peer, mapped, this->ipv4);
+
+	if (::connect(
+#if CFG_OS == CFG_OS_WINDOWS
+			this->win_sock,
+#else
+			this->handle,
+#endif
+			e.data(),
+			e.size()
+		) == socket_error)
+	{
+#if CFG_OS == CFG_OS_WINDOWS
+		int error_code = WSAGetLastError();
+#else
+		int error_code = errno;
+#endif
+		throw std::system_error(error_code, std::generic_category(), "could not connect UDP socket, connect() failed");
+	}
+}
+
+void udp_socket::disconnect()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::disconnect(): socket is empty");
+	}
+
+	sockaddr_storage socket_address{};
+	socket_address_length_type socket_address_length = 0;
 
-	if (socket_address.ss_family == AF_INET) {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& a = reinterpret_cast<sockaddr_in&>(socket_address);
-		out_sender_address = address(ntohl(a.sin_addr.s_addr), uint16_t(ntohs(a.sin_port)));
+#if CFG_OS == CFG_OS_WINDOWS
+	// on Windows, connecting to the any-address with zero port dissolves the association
+	if (this->ipv4) {
+		socket_address.ss_family = AF_INET;
+		socket_address_length = sizeof(sockaddr_in);
 	} else {
-		ASSERT(socket_address.ss_family == AF_INET6, [&](auto& o) {
-			o << "socket_address.ss_family = " << unsigned(socket_address.ss_family) << " AF_INET = " << AF_INET
-			  << " AF_INET6 = " << AF_INET6;
-		})
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-		auto& a = reinterpret_cast<sockaddr_in6&>(socket_address);
-		out_sender_address = address(
-			address::ip(
-#if CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_WINDOWS || \
-	(CFG_OS == CFG_OS_LINUX && CFG_OS_NAME == CFG_OS_NAME_ANDROID)
-				(uint32_t(a.sin6_addr.s6_addr[0]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[1]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[2]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[3]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[4]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[5]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[6]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[7]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[8]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[9]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[10]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[11]), // NOLINT
-				(uint32_t(a.sin6_addr.s6_addr[12]) << (utki::byte_bits * 3)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[13]) << (utki::byte_bits * 2)) // NOLINT
-					| (uint32_t(a.sin6_addr.s6_addr[14]) << utki::byte_bits) // NOLINT
-					| uint32_t(a.sin6_addr.s6_addr[15]) // NOLINT
-#else
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[0])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[1])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[2])), // NOLINT
-				uint32_t(ntohl(a.sin6_addr.__in6_u.__u6_addr32[3])) // NOLINT
-#endif
-			),
-			uint16_t(ntohs(a.sin6_port))
+		socket_address.ss_family = AF_INET6;
+		socket_address_length = sizeof(sockaddr_in6);
+	}
+#else
+	// connecting to an address with AF_UNSPEC family dissolves the association
+	socket_address.ss_family = AF_UNSPEC;
+	socket_address_length = sizeof(socket_address);
+#endif
+
+	if (::connect(
+#if CFG_OS == CFG_OS_WINDOWS
+			this->win_sock,
+#else
+			this->handle,
+#endif
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<sockaddr*>(&socket_address),
+			socket_address_length
+		) == socket_error)
+	{
+#if CFG_OS == CFG_OS_WINDOWS
+		int error_code = WSAGetLastError();
+#else
+		int error_code = errno;
+#endif
+		// some systems report EAFNOSUPPORT even though the association was dissolved
+		if (error_code != EAFNOSUPPORT) {
+			throw std::system_error(
+				error_code,
+				std::generic_category(),
+				"could not disconnect UDP socket, connect() failed"
+			);
+		}
+	}
+}
+
+size_t udp_socket::send_segmented(
+	utki::span<const uint8_t> buf,
+	size_t segment_size,
+	const address& destination_address
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_segmented(): socket is empty");
+	}
+
+	return this->send_segmented(buf, segment_size, endpoint(destination_address));
+}
+
+size_t udp_socket::send_segmented(utki::span<const uint8_t> buf, size_t segment_size, const endpoint& destination)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_segmented(): socket is empty");
+	}
+
+	if (segment_size == 0) {
+		throw std::invalid_argument("udp_socket::send_segmented(): segment size is zero");
+	}
+
+	size_t num_bytes_sent = 0;
+
+#if CFG_OS == CFG_OS_LINUX && defined(UDP_SEGMENT)
+	// maximum number of segments per one send operation allowed by the kernel
+	constexpr size_t max_segments = 64;
+
+	// maximum UDP payload size, assuming IPv6 header
+	constexpr size_t max_payload_size = 0xffff - 8 - 40;
+
+	size_t num_segments_per_send = std::min(max_segments, max_payload_size / segment_size);
+
+	endpoint mapped;
+	const auto& e = to_socket_family(destination, mapped, this->ipv4);
+
+	while (this->gso_supported && num_segments_per_send > 1 && num_bytes_sent != buf.size()) {
+		auto chunk = buf.subspan(
+			num_bytes_sent,
+			std::min(buf.size() - num_bytes_sent, num_segments_per_send * segment_size)
+		);
+
+		iovec iov{};
+		iov.iov_base = const_cast<uint8_t*>(chunk.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+		iov.iov_len = chunk.size();
+
+		alignas(cmsghdr) std::array<uint8_t, CMSG_SPACE(sizeof(uint16_t))> control{};
+
+		msghdr msg{};
+		// the message is only read by sendmsg()
+		msg.msg_name = const_cast<sockaddr*>(e.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+		msg.msg_namelen = e.size();
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.data();
+		msg.msg_controllen = control.size();
+
+		cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+		cm->cmsg_level = SOL_UDP;
+		cm->cmsg_type = UDP_SEGMENT;
+		cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		auto gso_size = uint16_t(segment_size);
+		memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+
+		ssize_t len = sendmsg(this->handle, &msg, 0);
+
+		if (len == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				++this->stats.send_would_block;
+				return num_bytes_sent;
+			} else if (error_code == EIO || error_code == ENOPROTOOPT || error_code == EOPNOTSUPP) {
+				// segmentation offload is not supported, fall back to sending datagrams one by one
+				this->gso_supported = false;
+				break;
+			} else if (error_code == EINVAL) {
+				// EINVAL is reported for the particular call, e.g. the segment is bigger than path MTU,
+				// so it does not mean that segmentation offload is unsupported
+				if (num_bytes_sent != 0) {
+					// report the datagrams sent so far, the error is reported by the next call if it persists
+					return num_bytes_sent;
+				}
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmsg() with UDP_SEGMENT failed"
+				);
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(size_t(len) == chunk.size())
+		num_bytes_sent += chunk.size();
+
+		this->stats.datagrams_sent += (chunk.size() + segment_size - 1) / segment_size;
+		this->stats.bytes_sent += chunk.size();
+	}
+#endif
+
+	while (num_bytes_sent != buf.size()) {
+		auto segment = buf.subspan(num_bytes_sent, std::min(buf.size() - num_bytes_sent, segment_size));
+		if (this->send(segment, destination) == 0) {
+			break;
+		}
+		num_bytes_sent += segment.size();
+	}
+
+	return num_bytes_sent;
+}
+
+size_t udp_socket::send_batch(
+	utki::span<const utki::span<const uint8_t>> bufs,
+	utki::span<const address> destination_addresses
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_batch(): socket is empty");
+	}
+
+	if (bufs.size() != destination_addresses.size()) {
+		throw std::invalid_argument(
+			"udp_socket::send_batch(): number of buffers is not equal to number of destination addresses"
 		);
 	}
 
-	ASSERT(len >= 0)
-	return size_t(len);
+	std::array<endpoint, max_batch_size> destinations;
+
+	size_t num_sent = 0;
+
+	while (num_sent != bufs.size()) {
+		size_t num_to_send = std::min(bufs.size() - num_sent, max_batch_size);
+
+		for (size_t i = 0; i != num_to_send; ++i) {
+			destinations[i] = endpoint(destination_addresses[num_sent + i]);
+		}
+
+		size_t n = this->send_batch(
+			bufs.subspan(num_sent, num_to_send),
+			utki::make_span(destinations.data(), num_to_send)
+		);
+
+		num_sent += n;
+
+		if (n != num_to_send) {
+			// not all datagrams were sent, the next one would block
+			break;
+		}
+	}
+
+	return num_sent;
+}
+
+size_t udp_socket::send_batch(utki::span<const utki::span<const uint8_t>> bufs, utki::span<const endpoint> destinations)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_batch(): socket is empty");
+	}
+
+	if (bufs.size() != destinations.size()) {
+		throw std::invalid_argument(
+			"udp_socket::send_batch(): number of buffers is not equal to number of destinations"
+		);
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<mmsghdr, max_batch_size> msgs;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<iovec, max_batch_size> iovecs;
+
+	size_t num_sent = 0;
+
+	while (num_sent != bufs.size()) {
+		size_t num_to_send = std::min(bufs.size() - num_sent, max_batch_size);
+
+		for (size_t i = 0; i != num_to_send; ++i) {
+			const auto& buf = bufs[num_sent + i];
+			const auto& e = destinations[num_sent + i];
+
+			auto& iov = iovecs[i];
+			iov.iov_base = const_cast<uint8_t*>(buf.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+			iov.iov_len = buf.size();
+
+			auto& m = msgs[i];
+			m = {};
+			m.msg_hdr.msg_iov = &iov;
+			m.msg_hdr.msg_iovlen = 1;
+			// the messages are only read by sendmmsg()
+			m.msg_hdr.msg_name = const_cast<sockaddr*>(e.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+			m.msg_hdr.msg_namelen = e.size();
+		}
+
+		int res = sendmmsg(this->handle, msgs.data(), unsigned(num_to_send), 0);
+
+		if (res == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				// can't send more datagrams
+				++this->stats.send_would_block;
+				break;
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(res >= 0)
+		for (size_t i = 0; i != size_t(res); ++i) {
+			this->stats.bytes_sent += msgs[i].msg_len;
+		}
+		this->stats.datagrams_sent += size_t(res);
+
+		num_sent += size_t(res);
+
+		if (size_t(res) != num_to_send) {
+			// not all datagrams were sent, the next one would block or fail
+			break;
+		}
+	}
+
+	return num_sent;
+#else
+	size_t num_sent = 0;
+	for (; num_sent != bufs.size(); ++num_sent) {
+		if (this->send(bufs[num_sent], destinations[num_sent]) == 0) {
+			break;
+		}
+	}
+	return num_sent;
+#endif
+}
+
+size_t udp_socket::send_fanout(utki::span<const uint8_t> buf, utki::span<const address> destination_addresses)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_fanout(): socket is empty");
+	}
+
+	std::array<endpoint, max_batch_size> destinations;
+
+	size_t num_sent = 0;
+
+	while (num_sent != destination_addresses.size()) {
+		size_t num_to_send = std::min(destination_addresses.size() - num_sent, max_batch_size);
+
+		for (size_t i = 0; i != num_to_send; ++i) {
+			destinations[i] = endpoint(destination_addresses[num_sent + i]);
+		}
+
+		size_t n = this->send_fanout(buf, utki::make_span(destinations.data(), num_to_send));
+
+		num_sent += n;
+
+		if (n != num_to_send) {
+			// not all datagrams were sent, the next one would block
+			break;
+		}
+	}
+
+	return num_sent;
+}
+
+size_t udp_socket::send_fanout(utki::span<const uint8_t> buf, utki::span<const endpoint> destinations)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_fanout(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<mmsghdr, max_batch_size> msgs;
+
+	// all messages refer to the same data
+	iovec iov{};
+	iov.iov_base = const_cast<uint8_t*>(buf.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	iov.iov_len = buf.size();
+
+	size_t num_sent = 0;
+
+	while (num_sent != destinations.size()) {
+		size_t num_to_send = std::min(destinations.size() - num_sent, max_batch_size);
+
+		for (size_t i = 0; i != num_to_send; ++i) {
+			const auto& e = destinations[num_sent + i];
+
+			auto& m = msgs[i];
+			m = {};
+			m.msg_hdr.msg_iov = &iov;
+			m.msg_hdr.msg_iovlen = 1;
+			// the messages are only read by sendmmsg()
+			m.msg_hdr.msg_name = const_cast<sockaddr*>(e.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+			m.msg_hdr.msg_namelen = e.size();
+		}
+
+		int res = sendmmsg(this->handle, msgs.data(), unsigned(num_to_send), 0);
+
+		if (res == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				// can't send more datagrams
+				++this->stats.send_would_block;
+				break;
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(res >= 0)
+		this->stats.datagrams_sent += size_t(res);
+		this->stats.bytes_sent += size_t(res) * buf.size();
+
+		num_sent += size_t(res);
+
+		if (size_t(res) != num_to_send) {
+			// not all datagrams were sent, the next one would block or fail
+			break;
+		}
+	}
+
+	return num_sent;
+#else
+	size_t num_sent = 0;
+	for (; num_sent != destinations.size(); ++num_sent) {
+		if (this->send(buf, destinations[num_sent]) == 0) {
+			break;
+		}
+	}
+	return num_sent;
+#endif
+}
+
+size_t udp_socket::receive_batch(utki::span<const utki::span<uint8_t>> bufs, utki::span<datagram_info> out_infos)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::receive_batch(): socket is empty");
+	}
+
+	if (bufs.size() != out_infos.size()) {
+		throw std::invalid_argument(
+			"udp_socket::receive_batch(): number of buffers is not equal to number of datagram infos"
+		);
+	}
+
+	std::array<endpoint, max_batch_size> senders;
+
+	size_t num_received = 0;
+
+	while (num_received != bufs.size()) {
+		size_t num_to_receive = std::min(bufs.size() - num_received, max_batch_size);
+
+		size_t num = this->receive_batch(
+			bufs.subspan(num_received, num_to_receive),
+			out_infos.subspan(num_received, num_to_receive),
+			utki::make_span(senders.data(), num_to_receive)
+		);
+
+		for (size_t i = 0; i != num; ++i) {
+			out_infos[num_received + i].sender = senders[i].to_address();
+		}
+
+		num_received += num;
+
+		if (num != num_to_receive) {
+			// no more datagrams available
+			break;
+		}
+	}
+
+	return num_received;
+}
+
+size_t udp_socket::receive_batch(
+	utki::span<const utki::span<uint8_t>> bufs,
+	utki::span<datagram_info> out_infos,
+	utki::span<endpoint> out_senders
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::receive_batch(): socket is empty");
+	}
+
+	if (bufs.size() != out_infos.size() || bufs.size() != out_senders.size()) {
+		throw std::invalid_argument(
+			"udp_socket::receive_batch(): number of buffers is not equal to number of datagram infos or senders"
+		);
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<mmsghdr, max_batch_size> msgs;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	std::array<iovec, max_batch_size> iovecs;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init)
+	alignas(cmsghdr) std::array<
+		std::array<uint8_t, CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(timespec))>,
+		max_batch_size>
+		controls;
+
+	size_t num_received = 0;
+
+	while (num_received != bufs.size()) {
+		size_t num_to_receive = std::min(bufs.size() - num_received, max_batch_size);
+
+		for (size_t i = 0; i != num_to_receive; ++i) {
+			const auto& buf = bufs[num_received + i];
+
+			auto& iov = iovecs[i];
+			iov.iov_base = buf.data();
+			iov.iov_len = buf.size();
+
+			auto& m = msgs[i];
+			m = {};
+			m.msg_hdr.msg_iov = &iov;
+			m.msg_hdr.msg_iovlen = 1;
+			m.msg_hdr.msg_name = out_senders[num_received + i].data();
+			m.msg_hdr.msg_namelen = endpoint::capacity();
+			if (this->drop_counter_enabled || this->timestamping_enabled) {
+				m.msg_hdr.msg_control = controls[i].data();
+				m.msg_hdr.msg_controllen = controls[i].size();
+			}
+		}
+
+		// MSG_TRUNC makes the original size of truncated datagrams to be reported
+		int res = recvmmsg(this->handle, msgs.data(), unsigned(num_to_receive), MSG_TRUNC, nullptr);
+
+		if (res == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				// no more datagrams available
+				++this->stats.receive_would_block;
+				break;
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not receive data over UDP, recvmmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(res >= 0)
+
+		for (size_t i = 0; i != size_t(res); ++i) {
+			auto& m = msgs[i];
+			auto& info = out_infos[num_received + i];
+			out_senders[num_received + i].set_size(m.msg_hdr.msg_namelen);
+			info.original_size = m.msg_len;
+			info.size = std::min(size_t(m.msg_len), bufs[num_received + i].size());
+			info.truncated = (m.msg_hdr.msg_flags & MSG_TRUNC) != 0;
+			info.dropped = 0;
+			info.timestamp_ns = 0;
+			if (m.msg_hdr.msg_controllen != 0) {
+				for (cmsghdr* cm = CMSG_FIRSTHDR(&m.msg_hdr); cm; cm = CMSG_NXTHDR(&m.msg_hdr, cm)) {
+#	ifdef SO_RXQ_OVFL
+					if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+						memcpy(&info.dropped, CMSG_DATA(cm), sizeof(info.dropped));
+						this->stats.dropped = info.dropped;
+						continue;
+					}
+#	endif
+					if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS) {
+						timespec ts{};
+						memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+						info.timestamp_ns = uint64_t(ts.tv_sec) * std::nano::den + uint64_t(ts.tv_nsec);
+					}
+				}
+			}
+
+			this->stats.bytes_received += info.size;
+			if (info.truncated) {
+				++this->stats.truncated;
+			}
+		}
+		this->stats.datagrams_received += size_t(res);
+
+		num_received += size_t(res);
+
+		if (size_t(res) != num_to_receive) {
+			// no more datagrams available
+			break;
+		}
+	}
+
+	return num_received;
+#else
+	size_t num_received = 0;
+	for (; num_received != bufs.size(); ++num_received) {
+		auto& info = out_infos[num_received];
+		info.size = this->recieve(bufs[num_received], out_senders[num_received]);
+		info.original_size = info.size;
+		info.truncated = false;
+		info.dropped = 0;
+		info.timestamp_ns = 0;
+		if (info.size == 0) {
+			break;
+		}
+	}
+	return num_received;
+#endif
+}
+
+void udp_socket::set_gro(bool enable)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_gro(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(UDP_GRO)
+	int value = enable ? 1 : 0;
+	if (setsockopt(this->handle, SOL_UDP, UDP_GRO, &value, sizeof(value)) != 0) {
+		throw std::system_error(errno, std::generic_category(), "could not set UDP_GRO option, setsockopt() failed");
+	}
+#endif
+}
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+size_t udp_socket::receive_message(
+	utki::span<uint8_t> buf,
+	endpoint& out_sender,
+	segmented_datagram_info& out_info,
+	packet_info* out_packet_info
+)
+{
+	iovec iov{};
+	iov.iov_base = buf.data();
+	iov.iov_len = buf.size();
+
+	// enough space for all control messages requested by the socket options
+	// on dual-stack sockets both IPv4 and IPv6 packet info can be reported for IPv4 datagrams
+	alignas(cmsghdr) std::array<
+		uint8_t,
+		CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(in6_pktinfo)) + CMSG_SPACE(sizeof(in_pktinfo)) +
+			CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(timespec))>
+		control{};
+
+	msghdr msg{};
+
+	ssize_t len = 0;
+
+	while (true) {
+		msg = {};
+		msg.msg_name = out_sender.data();
+		msg.msg_namelen = endpoint::capacity();
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.data();
+		msg.msg_controllen = control.size();
+
+		len = recvmsg(this->handle, &msg, 0);
+
+		if (len == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				++this->stats.receive_would_block;
+				return 0; // no data available, return 0 bytes received
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not receive data over UDP, recvmsg() failed"
+				);
+			}
+		}
+		break;
+	}
+
+	ASSERT(len >= 0)
+
+	out_sender.set_size(msg.msg_namelen);
+
+	out_info.size = size_t(len);
+	out_info.segment_size = size_t(len);
+	out_info.truncated = (msg.msg_flags & MSG_TRUNC) != 0;
+	out_info.dropped = 0;
+	out_info.timestamp_ns = 0;
+
+	if (out_packet_info) {
+		*out_packet_info = packet_info();
+	}
+
+	for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+#	if CFG_OS == CFG_OS_LINUX && defined(UDP_GRO)
+		if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+			int gso_size = 0;
+			memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+			if (gso_size > 0) {
+				out_info.segment_size = size_t(gso_size);
+			}
+			continue;
+		}
+#	endif
+#	ifdef SO_RXQ_OVFL
+		if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+			memcpy(&out_info.dropped, CMSG_DATA(cm), sizeof(out_info.dropped));
+			this->stats.dropped = out_info.dropped;
+			continue;
+		}
+#	endif
+#	if CFG_OS == CFG_OS_LINUX
+		if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS) {
+			timespec ts{};
+			memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+			out_info.timestamp_ns = uint64_t(ts.tv_sec) * std::nano::den + uint64_t(ts.tv_nsec);
+			continue;
+		}
+#	endif
+		if (!out_packet_info) {
+			continue;
+		}
+#	ifdef IP_PKTINFO
+		if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_PKTINFO) {
+			in_pktinfo pi{};
+			memcpy(&pi, CMSG_DATA(cm), sizeof(pi));
+			out_packet_info->local_address = address::ip(uint32_t(ntohl(pi.ipi_addr.s_addr)));
+			out_packet_info->interface_index = unsigned(pi.ipi_ifindex);
+			continue;
+		}
+#	endif
+		if (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_PKTINFO) {
+			in6_pktinfo pi{};
+			memcpy(&pi, CMSG_DATA(cm), sizeof(pi));
+
+			sockaddr_storage sa{};
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto& sa6 = reinterpret_cast<sockaddr_in6&>(sa);
+			sa6.sin6_family = AF_INET6;
+			sa6.sin6_addr = pi.ipi6_addr;
+
+			out_packet_info->local_address = make_address(sa).host;
+			out_packet_info->interface_index = unsigned(pi.ipi6_ifindex);
+		}
+	}
+
+	if (out_info.truncated) {
+		++this->stats.truncated;
+	}
+	this->stats.bytes_received += out_info.size;
+	if (out_info.segment_size != 0) {
+		this->stats.datagrams_received += (out_info.size + out_info.segment_size - 1) / out_info.segment_size;
+	} else {
+		// empty datagram
+		++this->stats.datagrams_received;
+	}
+
+	return out_info.size;
+}
+#endif
+
+size_t udp_socket::receive_segmented(utki::span<uint8_t> buf, segmented_datagram_info& out_info)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::receive_segmented(): socket is empty");
+	}
+
+	endpoint sender;
+
+	size_t len = this->receive_segmented(buf, out_info, sender);
+
+	// address family is unset if no datagram was received
+	if (sender.get_family() != AF_UNSPEC) {
+		out_info.sender = sender.to_address();
+	}
+
+	return len;
+}
+
+size_t udp_socket::receive_segmented(
+	utki::span<uint8_t> buf,
+	segmented_datagram_info& out_info,
+	endpoint& out_sender
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::receive_segmented(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	endpoint sender;
+	size_t len = this->receive_message(buf, sender, out_info, nullptr);
+	if (sender.get_family() != AF_UNSPEC) {
+		out_sender = sender;
+	}
+	return len;
+#else
+	out_info.size = this->recieve(buf, out_sender);
+	out_info.segment_size = out_info.size;
+	out_info.truncated = false;
+	out_info.dropped = 0;
+	out_info.timestamp_ns = 0;
+	return out_info.size;
+#endif
+}
+
+void udp_socket::set_drop_counter(bool enable)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_drop_counter(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(SO_RXQ_OVFL)
+	int value = enable ? 1 : 0;
+	this->set_option(
+		SOL_SOCKET,
+		SO_RXQ_OVFL,
+		&value,
+		sizeof(value),
+		"could not set SO_RXQ_OVFL option, setsockopt() failed"
+	);
+	this->drop_counter_enabled = enable;
+#endif
+}
+
+void udp_socket::set_timestamping(bool enable)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_timestamping(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	int value = enable ? 1 : 0;
+	this->set_option(
+		SOL_SOCKET,
+		SO_TIMESTAMPNS,
+		&value,
+		sizeof(value),
+		"could not set SO_TIMESTAMPNS option, setsockopt() failed"
+	);
+	this->timestamping_enabled = enable;
+#endif
+}
+
+void udp_socket::set_packet_info(bool enable)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_packet_info(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	int value = enable ? 1 : 0;
+
+	if (!this->ipv4) {
+		if (setsockopt(this->handle, IPPROTO_IPV6, IPV6_RECVPKTINFO, &value, sizeof(value)) != 0) {
+			throw std::system_error(
+				errno,
+				std::generic_category(),
+				"could not set IPV6_RECVPKTINFO option, setsockopt() failed"
+			);
+		}
+	}
+
+#	if CFG_OS == CFG_OS_LINUX
+	constexpr auto ip_pktinfo_option = IP_PKTINFO;
+#	else
+	constexpr auto ip_pktinfo_option = IP_RECVPKTINFO;
+#	endif
+
+	// on dual-stack sockets IPv4 datagrams are reported with IPv4 level control messages
+	if (setsockopt(this->handle, IPPROTO_IP, ip_pktinfo_option, &value, sizeof(value)) != 0) {
+		// the option is not supported for IPv6 sockets on some systems, IPv4 datagrams are
+		// reported with IPV6_PKTINFO then
+		if (this->ipv4) {
+			throw std::system_error(
+				errno,
+				std::generic_category(),
+				"could not set IP_PKTINFO option, setsockopt() failed"
+			);
+		}
+	}
+#else
+	throw std::runtime_error("udp_socket::set_packet_info(): not supported on this OS");
+#endif
+}
+
+size_t udp_socket::recieve(utki::span<uint8_t> buf, address& out_sender_address, packet_info& out_packet_info)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	}
+
+	endpoint sender;
+
+	size_t len = this->recieve(buf, sender, out_packet_info);
+
+	// address family is unset if no datagram was received
+	if (sender.get_family() != AF_UNSPEC) {
+		out_sender_address = sender.to_address();
+	}
+
+	return len;
+}
+
+size_t udp_socket::recieve(utki::span<uint8_t> buf, endpoint& out_sender, packet_info& out_packet_info)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::recieve(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	segmented_datagram_info info;
+	endpoint sender;
+	size_t len = this->receive_message(buf, sender, info, &out_packet_info);
+	if (sender.get_family() != AF_UNSPEC) {
+		out_sender = sender;
+	}
+	return len;
+#else
+	throw std::runtime_error("udp_socket::recieve(): packet info is not supported on this OS");
+#endif
+}
+
+size_t udp_socket::send(
+	utki::span<const uint8_t> buf,
+	const address& destination_address,
+	const packet_info& source_packet_info
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send(): socket is empty");
+	}
+
+	return this->send(buf, endpoint(destination_address), source_packet_info);
+}
+
+size_t udp_socket::send(
+	utki::span<const uint8_t> buf,
+	const endpoint& destination,
+	const packet_info& source_packet_info
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	endpoint mapped;
+	const auto& e = to_socket_family(destination, mapped, this->ipv4);
+
+	iovec iov{};
+	iov.iov_base = const_cast<uint8_t*>(buf.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	iov.iov_len = buf.size();
+
+	alignas(cmsghdr) std::array<uint8_t, CMSG_SPACE(sizeof(in6_pktinfo))> control{};
+
+	msghdr msg{};
+	// the message is only read by sendmsg()
+	msg.msg_name = const_cast<sockaddr*>(e.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	msg.msg_namelen = e.size();
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+
+	cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+
+	if (e.get_family() == AF_INET) {
+#	ifdef IP_PKTINFO
+		in_pktinfo pi{};
+		pi.ipi_ifindex = int(source_packet_info.interface_index);
+		pi.ipi_spec_dst.s_addr = htonl(source_packet_info.local_address.get_v4());
+
+		msg.msg_controllen = CMSG_SPACE(sizeof(pi));
+		cm->cmsg_level = IPPROTO_IP;
+		cm->cmsg_type = IP_PKTINFO;
+		cm->cmsg_len = CMSG_LEN(sizeof(pi));
+		memcpy(CMSG_DATA(cm), &pi, sizeof(pi));
+#	else
+		throw std::runtime_error("udp_socket::send(): IPv4 source address selection is not supported on this OS");
+#	endif
+	} else {
+		sockaddr_storage sa{};
+		make_socket_address(sa, address(source_packet_info.local_address, 0), false);
+		ASSERT(sa.ss_family == AF_INET6 || source_packet_info.local_address.is_v4())
+
+		in6_pktinfo pi{};
+		pi.ipi6_ifindex = source_packet_info.interface_index;
+		if (sa.ss_family == AF_INET6) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			pi.ipi6_addr = reinterpret_cast<const sockaddr_in6&>(sa).sin6_addr;
+		} else {
+			// the IPv4 source address of IPv4 destination on dual-stack socket,
+			// build IPv4-mapped IPv6 address
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			const auto& sa4 = reinterpret_cast<const sockaddr_in&>(sa);
+			pi.ipi6_addr.s6_addr[10] = 0xff; // NOLINT
+			pi.ipi6_addr.s6_addr[11] = 0xff; // NOLINT
+			memcpy(&pi.ipi6_addr.s6_addr[12], &sa4.sin_addr, sizeof(sa4.sin_addr)); // NOLINT
+		}
+
+		msg.msg_controllen = CMSG_SPACE(sizeof(pi));
+		cm->cmsg_level = IPPROTO_IPV6;
+		cm->cmsg_type = IPV6_PKTINFO;
+		cm->cmsg_len = CMSG_LEN(sizeof(pi));
+		memcpy(CMSG_DATA(cm), &pi, sizeof(pi));
+	}
+
+	while (true) {
+		ssize_t len = sendmsg(this->handle, &msg, 0);
+
+		if (len == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				// can't send more bytes, return 0 bytes sent
+				++this->stats.send_would_block;
+				return 0;
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(size_t(len) == buf.size())
+		++this->stats.datagrams_sent;
+		this->stats.bytes_sent += uint64_t(len);
+		return size_t(len);
+	}
+#else
+	throw std::runtime_error("udp_socket::send(): source address selection is not supported on this OS");
+#endif
+}
+
+void udp_socket::set_option(int level, int name, const void* value, size_t value_size, const char* error_message)
+{
+	if (setsockopt(
+#if CFG_OS == CFG_OS_WINDOWS
+			this->win_sock,
+#else
+			this->handle,
+#endif
+			level,
+			name,
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<const char*>(value),
+			socket_address_length_type(value_size)
+		) == socket_error)
+	{
+#if CFG_OS == CFG_OS_WINDOWS
+		int error_code = WSAGetLastError();
+#else
+		int error_code = errno;
+#endif
+		throw std::system_error(error_code, std::generic_category(), error_message);
+	}
+}
+
+void udp_socket::set_group_membership(
+	int option,
+	const address::ip& group,
+	const address::ip* source,
+	unsigned interface_index
+)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket: socket is empty");
+	}
+
+	// IPv4 groups are joined on IPv4 level even on dual-stack sockets
+	int level = group.is_v4() ? IPPROTO_IP : IPPROTO_IPV6;
+
+	if (source) {
+		if (source->is_v4() != group.is_v4()) {
+			throw std::invalid_argument("udp_socket: multicast source and group address families differ");
+		}
+
+		group_source_req req{};
+		req.gsr_interface = interface_index;
+		make_socket_address(req.gsr_group, address(group, 0), group.is_v4());
+		make_socket_address(req.gsr_source, address(*source, 0), source->is_v4());
+
+		this->set_option(level, option, &req, sizeof(req), "could not change multicast group membership, setsockopt() failed");
+	} else {
+		group_req req{};
+		req.gr_interface = interface_index;
+		make_socket_address(req.gr_group, address(group, 0), group.is_v4());
+
+		this->set_option(level, option, &req, sizeof(req), "could not change multicast group membership, setsockopt() failed");
+	}
+}
+
+void udp_socket::join_group(const address::ip& group, unsigned interface_index)
+{
+	this->set_group_membership(MCAST_JOIN_GROUP, group, nullptr, interface_index);
+}
+
+void udp_socket::join_group(const address::ip& group, const address::ip& source, unsigned interface_index)
+{
+	this->set_group_membership(MCAST_JOIN_SOURCE_GROUP, group, &source, interface_index);
+}
+
+void udp_socket::leave_group(const address::ip& group, unsigned interface_index)
+{
+	this->set_group_membership(MCAST_LEAVE_GROUP, group, nullptr, interface_index);
+}
+
+void udp_socket::leave_group(const address::ip& group, const address::ip& source, unsigned interface_index)
+{
+	this->set_group_membership(MCAST_LEAVE_SOURCE_GROUP, group, &source, interface_index);
+}
+
+void udp_socket::set_multicast_ttl(unsigned ttl)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_multicast_ttl(): socket is empty");
+	}
+
+	constexpr unsigned max_ttl = 255;
+	if (ttl > max_ttl) {
+		throw std::invalid_argument("udp_socket::set_multicast_ttl(): TTL is greater than 255");
+	}
+
+#if CFG_OS == CFG_OS_MACOSX
+	auto ttl_value = uint8_t(ttl);
+#else
+	int ttl_value = int(ttl);
+#endif
+	this->set_option(
+		IPPROTO_IP,
+		IP_MULTICAST_TTL,
+		&ttl_value,
+		sizeof(ttl_value),
+		"could not set IP_MULTICAST_TTL option, setsockopt() failed"
+	);
+
+	if (!this->ipv4) {
+		int hops = int(ttl);
+		this->set_option(
+			IPPROTO_IPV6,
+			IPV6_MULTICAST_HOPS,
+			&hops,
+			sizeof(hops),
+			"could not set IPV6_MULTICAST_HOPS option, setsockopt() failed"
+		);
+	}
+}
+
+void udp_socket::set_multicast_interface(unsigned interface_index)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_multicast_interface(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	ip_mreqn req{};
+	req.imr_ifindex = int(interface_index);
+	this->set_option(
+		IPPROTO_IP,
+		IP_MULTICAST_IF,
+		&req,
+		sizeof(req),
+		"could not set IP_MULTICAST_IF option, setsockopt() failed"
+	);
+#elif CFG_OS == CFG_OS_WINDOWS
+	// interface index is given as an address from 0.0.0.0/8 network in network byte order
+	DWORD index = htonl(interface_index);
+	this->set_option(
+		IPPROTO_IP,
+		IP_MULTICAST_IF,
+		&index,
+		sizeof(index),
+		"could not set IP_MULTICAST_IF option, setsockopt() failed"
+	);
+#elif defined(IP_MULTICAST_IFINDEX)
+	this->set_option(
+		IPPROTO_IP,
+		IP_MULTICAST_IFINDEX,
+		&interface_index,
+		sizeof(interface_index),
+		"could not set IP_MULTICAST_IFINDEX option, setsockopt() failed"
+	);
+#endif
+
+	if (!this->ipv4) {
+		this->set_option(
+			IPPROTO_IPV6,
+			IPV6_MULTICAST_IF,
+			&interface_index,
+			sizeof(interface_index),
+			"could not set IPV6_MULTICAST_IF option, setsockopt() failed"
+		);
+	}
+}
+
+void udp_socket::set_multicast_loopback(bool enable)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_multicast_loopback(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_MACOSX
+	uint8_t loop = enable ? 1 : 0;
+#else
+	int loop = enable ? 1 : 0;
+#endif
+	this->set_option(
+		IPPROTO_IP,
+		IP_MULTICAST_LOOP,
+		&loop,
+		sizeof(loop),
+		"could not set IP_MULTICAST_LOOP option, setsockopt() failed"
+	);
+
+	if (!this->ipv4) {
+		unsigned loop6 = enable ? 1 : 0;
+		this->set_option(
+			IPPROTO_IPV6,
+			IPV6_MULTICAST_LOOP,
+			&loop6,
+			sizeof(loop6),
+			"could not set IPV6_MULTICAST_LOOP option, setsockopt() failed"
+		);
+	}
+}
+
+void udp_socket::set_path_mtu_discovery(path_mtu_discovery mode)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_path_mtu_discovery(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	int value = [&]() {
+		switch (mode) {
+			case path_mtu_discovery::off:
+				return IP_PMTUDISC_DONT;
+			case path_mtu_discovery::want:
+				return IP_PMTUDISC_WANT;
+			case path_mtu_discovery::on:
+				return IP_PMTUDISC_DO;
+			case path_mtu_discovery::probe:
+				return IP_PMTUDISC_PROBE;
+		}
+		return IP_PMTUDISC_WANT;
+	}();
+
+	this->set_option(
+		IPPROTO_IP,
+		IP_MTU_DISCOVER,
+		&value,
+		sizeof(value),
+		"could not set IP_MTU_DISCOVER option, setsockopt() failed"
+	);
+
+	if (!this->ipv4) {
+		// IPV6_PMTUDISC_* values are the same as IP_PMTUDISC_* ones
+		this->set_option(
+			IPPROTO_IPV6,
+			IPV6_MTU_DISCOVER,
+			&value,
+			sizeof(value),
+			"could not set IPV6_MTU_DISCOVER option, setsockopt() failed"
+		);
+	}
+#else
+	// only "don't fragment" flag can be controlled on other systems
+#	if CFG_OS == CFG_OS_WINDOWS
+	DWORD dont_fragment = (mode == path_mtu_discovery::on || mode == path_mtu_discovery::probe) ? 1 : 0;
+	constexpr auto ip_dont_fragment_option = IP_DONTFRAGMENT;
+#	else
+	int dont_fragment = (mode == path_mtu_discovery::on || mode == path_mtu_discovery::probe) ? 1 : 0;
+	constexpr auto ip_dont_fragment_option = IP_DONTFRAG;
+#	endif
+
+	if (this->ipv4) {
+		this->set_option(
+			IPPROTO_IP,
+			ip_dont_fragment_option,
+			&dont_fragment,
+			sizeof(dont_fragment),
+			"could not set IP don't fragment option, setsockopt() failed"
+		);
+	} else {
+		this->set_option(
+			IPPROTO_IPV6,
+			IPV6_DONTFRAG,
+			&dont_fragment,
+			sizeof(dont_fragment),
+			"could not set IPV6_DONTFRAG option, setsockopt() failed"
+		);
+	}
+#endif
+}
+
+bool udp_socket::is_peer_v4()
+{
+	sockaddr_storage socket_address{};
+	socket_address_length_type socket_address_length = sizeof(socket_address);
+
+	if (getpeername(
+#if CFG_OS == CFG_OS_WINDOWS
+			this->win_sock,
+#else
+			this->handle,
+#endif
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<sockaddr*>(&socket_address),
+			&socket_address_length
+		) == socket_error)
+	{
+#if CFG_OS == CFG_OS_WINDOWS
+		int error_code = WSAGetLastError();
+#else
+		int error_code = errno;
+#endif
+		throw std::system_error(
+			error_code,
+			std::generic_category(),
+			"could not get peer address, getpeername() failed, socket is not connected?"
+		);
+	}
+
+	return make_address(socket_address).host.is_v4();
+}
+
+size_t udp_socket::get_path_mtu()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::get_path_mtu(): socket is empty");
+	}
+
+#if defined(IP_MTU) && (CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_WINDOWS)
+	int level = IPPROTO_IP;
+	int option = IP_MTU;
+
+	if (!this->ipv4 && !this->is_peer_v4()) {
+		level = IPPROTO_IPV6;
+		option = IPV6_MTU;
+	}
+
+#	if CFG_OS == CFG_OS_WINDOWS
+	DWORD mtu = 0;
+#	else
+	int mtu = 0;
+#	endif
+	socket_address_length_type mtu_size = sizeof(mtu);
+
+	if (getsockopt(
+#	if CFG_OS == CFG_OS_WINDOWS
+			this->win_sock,
+#	else
+			this->handle,
+#	endif
+			level,
+			option,
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<char*>(&mtu),
+			&mtu_size
+		) == socket_error)
+	{
+#	if CFG_OS == CFG_OS_WINDOWS
+		int error_code = WSAGetLastError();
+#	else
+		int error_code = errno;
+#	endif
+		throw std::system_error(
+			error_code,
+			std::generic_category(),
+			"could not get path MTU, getsockopt(IP_MTU) failed, socket is not connected?"
+		);
+	}
+
+	return size_t(mtu);
+#else
+	throw std::runtime_error("udp_socket::get_path_mtu(): not supported on this OS");
+#endif
+}
+
+size_t udp_socket::get_max_datagram_size()
+{
+	constexpr size_t max_ip_packet_size = 0xffff;
+	constexpr size_t udp_header_size = 8;
+	constexpr size_t ipv4_header_size = 20;
+	constexpr size_t ipv6_header_size = 40;
+
+	auto mtu = this->get_path_mtu();
+
+	// the whole IPv4 packet size including the header, or IPv6 payload size, is limited to 16 bits
+	if (this->ipv4 || this->is_peer_v4()) {
+		return std::min(mtu, max_ip_packet_size) - ipv4_header_size - udp_header_size;
+	} else {
+		return std::min(mtu - ipv6_header_size, max_ip_packet_size) - udp_header_size;
+	}
+}
+
+void udp_socket::set_max_pacing_rate(uint64_t bytes_per_second)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::set_max_pacing_rate(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX
+	this->set_option(
+		SOL_SOCKET,
+		SO_MAX_PACING_RATE,
+		&bytes_per_second,
+		sizeof(bytes_per_second),
+		"could not set SO_MAX_PACING_RATE option, setsockopt() failed"
+	);
+#else
+	throw std::runtime_error("udp_socket::set_max_pacing_rate(): pacing rate is not supported on this OS");
+#endif
+}
+
+void udp_socket::enable_scheduled_transmission()
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::enable_scheduled_transmission(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(SO_TXTIME)
+	sock_txtime config{};
+	config.clockid = CLOCK_MONOTONIC;
+	this->set_option(SOL_SOCKET, SO_TXTIME, &config, sizeof(config), "could not set SO_TXTIME option, setsockopt() failed");
+#else
+	throw std::runtime_error(
+		"udp_socket::enable_scheduled_transmission(): scheduled transmission is not supported on this OS"
+	);
+#endif
+}
+
+size_t udp_socket::send_at(utki::span<const uint8_t> buf, const address& destination_address, uint64_t transmit_time_ns)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_at(): socket is empty");
+	}
+
+	return this->send_at(buf, endpoint(destination_address), transmit_time_ns);
+}
+
+size_t udp_socket::send_at(utki::span<const uint8_t> buf, const endpoint& destination, uint64_t transmit_time_ns)
+{
+	if (this->is_empty()) {
+		throw std::logic_error("udp_socket::send_at(): socket is empty");
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(SCM_TXTIME)
+	endpoint mapped;
+	const auto& e = to_socket_family(destination, mapped, this->ipv4);
+
+	iovec iov{};
+	iov.iov_base = const_cast<uint8_t*>(buf.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	iov.iov_len = buf.size();
+
+	alignas(cmsghdr) std::array<uint8_t, CMSG_SPACE(sizeof(transmit_time_ns))> control{};
+
+	msghdr msg{};
+	// the message is only read by sendmsg()
+	msg.msg_name = const_cast<sockaddr*>(e.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	msg.msg_namelen = e.size();
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+
+	cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_TXTIME;
+	cm->cmsg_len = CMSG_LEN(sizeof(transmit_time_ns));
+	memcpy(CMSG_DATA(cm), &transmit_time_ns, sizeof(transmit_time_ns));
+
+	while (true) {
+		ssize_t len = sendmsg(this->handle, &msg, 0);
+
+		if (len == socket_error) {
+			int error_code = errno;
+			if (error_code == error_interrupted) {
+				continue;
+			} else if (error_code == error_again) {
+				// can't send more bytes, return 0 bytes sent
+				++this->stats.send_would_block;
+				return 0;
+			} else {
+				throw std::system_error(
+					error_code,
+					std::generic_category(),
+					"could not send data over UDP, sendmsg() failed"
+				);
+			}
+		}
+
+		ASSERT(size_t(len) == buf.size())
+		++this->stats.datagrams_sent;
+		this->stats.bytes_sent += uint64_t(len);
+		return size_t(len);
+	}
+#else
+	throw std::runtime_error("udp_socket::send_at(): scheduled transmission is not supported on this OS");
+#endif
 }
 
 #if CFG_OS == CFG_OS_WINDOWS
@@ -26,12 +26,15 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 
 #include <utki/config.hpp>
 #include <utki/span.hpp>
 
 #include "address.hpp"
+#include "endpoint.hpp"
 #include "socket.hpp"
 
 namespace setka {
@@ -44,8 +47,71 @@ namespace setka {
  */
 class udp_socket : public socket
 {
+	friend class udp_receive_group;
+
+public:
+	/**
+	 * @brief Socket statistics.
+	 * Counts the traffic passed through the socket since the socket creation or
+	 * since the last call to reset_statistics().
+	 */
+	struct statistics {
+		/**
+		 * @brief Number of datagrams sent.
+		 */
+		uint64_t datagrams_sent = 0;
+
+		/**
+		 * @brief Number of bytes sent.
+		 */
+		uint64_t bytes_sent = 0;
+
+		/**
+		 * @brief Number of datagrams received.
+		 */
+		uint64_t datagrams_received = 0;
+
+		/**
+		 * @brief Number of bytes received.
+		 */
+		uint64_t bytes_received = 0;
+
+		/**
+		 * @brief Number of send attempts which would block.
+		 */
+		uint64_t send_would_block = 0;
+
+		/**
+		 * @brief Number of receive attempts which found no datagrams.
+		 */
+		uint64_t receive_would_block = 0;
+
+		/**
+		 * @brief Number of received datagrams which did not fit the buffer.
+		 * Truncation is only detected on Linux.
+		 */
+		uint64_t truncated = 0;
+
+		/**
+		 * @brief Number of datagrams dropped by the OS because receive buffer of the socket was full.
+		 * This is the cumulative counter reported by the OS, it is only updated when the drop counter
+		 * is enabled with set_drop_counter(), and it is not affected by reset_statistics().
+		 */
+		uint32_t dropped = 0;
+	};
+
+private:
 	bool ipv4 = true;
 
+	// set to false once the OS has reported that UDP generic segmentation offload is not supported
+	bool gso_supported = true;
+
+	bool drop_counter_enabled = false;
+
+	bool timestamping_enabled = false;
+
+	statistics stats;
+
 public:
 	udp_socket() = default;
 
@@ -55,19 +121,41 @@ public:
 	 * @param port - IP port number on which the socket will listen for incoming datagrams.
 	 *               If 0 is passed then system will assign some free port if any. If there
 	 *               are no free ports, then it is an error and an exception will be thrown.
+	 * @param reuse_port - whether to allow several sockets to be bound to the same port (SO_REUSEPORT).
+	 *                     The OS then distributes incoming datagrams among all such sockets.
+	 *                     All the sockets sharing the port must be created with this flag.
+	 *                     Not supported on Windows.
 	 */
-	udp_socket(uint16_t port);
+	udp_socket(uint16_t port, bool reuse_port = false);
+
+	/**
+	 * @brief Create and open the socket bound to the given local endpoint.
+	 * Creates the socket of the endpoint's address family. If the endpoint holds the IPv6 any-address,
+	 * then the socket accepts both IPv4 and IPv6 datagrams, same as udp_socket(port).
+	 * @param local_endpoint - local address and port to bind the socket to.
+	 * @param reuse_port - whether to allow several sockets to be bound to the same port (SO_REUSEPORT).
+	 */
+	udp_socket(const endpoint& local_endpoint, bool reuse_port = false);
 
 	udp_socket(const udp_socket&) = delete;
 	udp_socket& operator=(const udp_socket&) = delete;
 
 	udp_socket(udp_socket&& s) noexcept :
-		socket(std::move(s))
+		socket(std::move(s)),
+		ipv4(s.ipv4),
+		gso_supported(s.gso_supported),
+		drop_counter_enabled(s.drop_counter_enabled),
+		timestamping_enabled(s.timestamping_enabled),
+		stats(s.stats)
 	{}
 
 	udp_socket& operator=(udp_socket&& s) noexcept
 	{
 		this->ipv4 = s.ipv4;
+		this->gso_supported = s.gso_supported;
+		this->drop_counter_enabled = s.drop_counter_enabled;
+		this->timestamping_enabled = s.timestamping_enabled;
+		this->stats = s.stats;
 		this->socket::operator=(std::move(s));
 		return *this;
 	}
@@ -91,6 +179,164 @@ public:
 	 */
 	size_t send(utki::span<const uint8_t> buf, const address& destination_address);
 
+	/**
+	 * @brief Send datagram to endpoint.
+	 * Same as send(buf, destination_address), but the destination is already in the OS native format,
+	 * so no address conversion is done.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination - the destination to send the datagram to.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send(utki::span<const uint8_t> buf, const endpoint& destination);
+
+	/**
+	 * @brief Result of a send attempt.
+	 */
+	enum class send_status {
+		/**
+		 * @brief The datagram was sent.
+		 */
+		sent,
+
+		/**
+		 * @brief The datagram could not be sent at the moment because sending would block.
+		 */
+		would_block,
+
+		/**
+		 * @brief The datagram is too large to be sent.
+		 * Either it exceeds the maximum UDP datagram size, or it exceeds the path MTU while the
+		 * path MTU discovery is on, see set_path_mtu_discovery().
+		 */
+		message_too_large
+	};
+
+	/**
+	 * @brief Try sending datagram.
+	 * Same as send(buf, destination_address), but reports oversized datagram as a status instead of
+	 * throwing an exception.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination_address - the destination IP address to send the datagram to.
+	 * @return result of the send attempt.
+	 */
+	send_status try_send(utki::span<const uint8_t> buf, const address& destination_address);
+
+	/**
+	 * @brief Try sending datagram to endpoint.
+	 * Same as try_send(buf, destination_address), but the destination is already in the OS native format.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination - the destination to send the datagram to.
+	 * @return result of the send attempt.
+	 */
+	send_status try_send(utki::span<const uint8_t> buf, const endpoint& destination);
+
+	/**
+	 * @brief Try sending datagram to the connected peer.
+	 * Same as send(buf), but reports oversized datagram as a status instead of
+	 * throwing an exception.
+	 * @param buf - buffer containing the datagram to send.
+	 * @return result of the send attempt.
+	 */
+	send_status try_send(utki::span<const uint8_t> buf);
+
+	/**
+	 * @brief Path MTU discovery mode.
+	 */
+	enum class path_mtu_discovery {
+		/**
+		 * @brief Never set the "don't fragment" flag, datagrams bigger than path MTU are fragmented.
+		 */
+		off,
+
+		/**
+		 * @brief Use path MTU discovery, but fragment datagrams bigger than the discovered path MTU.
+		 * This is the default mode on Linux.
+		 */
+		want,
+
+		/**
+		 * @brief Always set the "don't fragment" flag.
+		 * Sending datagrams bigger than known path MTU fails with send_status::message_too_large.
+		 */
+		on,
+
+		/**
+		 * @brief Set the "don't fragment" flag, but ignore the known path MTU.
+		 * Useful for probing the path with datagrams of different sizes.
+		 */
+		probe
+	};
+
+	/**
+	 * @brief Set path MTU discovery mode.
+	 * On Linux, sets IP_MTU_DISCOVER option (and IPV6_MTU_DISCOVER for dual-stack sockets).
+	 * On other systems only "don't fragment" flag is controlled, so that modes off and want
+	 * clear the flag, and modes on and probe set it.
+	 * @param mode - path MTU discovery mode.
+	 */
+	void set_path_mtu_discovery(path_mtu_discovery mode);
+
+	/**
+	 * @brief Get path MTU towards the connected peer.
+	 * The socket must be connected, see connect(). The path MTU is known by the OS once it has
+	 * sent something to the peer, initially it is the MTU of the outgoing network interface.
+	 * Supported on Linux and Windows (IP_MTU, IPV6_MTU).
+	 * @return path MTU in bytes, including IP headers.
+	 */
+	size_t get_path_mtu();
+
+	/**
+	 * @brief Get maximum size of datagram which can be sent to the connected peer without fragmentation.
+	 * It is the path MTU minus IP and UDP header sizes, but not more than maximum UDP datagram size.
+	 * The socket must be connected, see connect().
+	 * @return maximum datagram payload size in bytes.
+	 */
+	size_t get_max_datagram_size();
+
+	/**
+	 * @brief Limit the rate at which the OS transmits datagrams of this socket.
+	 * Sets SO_MAX_PACING_RATE option. The limit is only enforced when the outgoing network interface
+	 * uses the fq queueing discipline. Only supported on Linux.
+	 * @param bytes_per_second - maximum transmit rate in bytes per second.
+	 */
+	void set_max_pacing_rate(uint64_t bytes_per_second);
+
+	/**
+	 * @brief Enable scheduled transmission.
+	 * Sets SO_TXTIME option with CLOCK_MONOTONIC clock. Once enabled, datagrams sent with send_at()
+	 * are held by the OS until the given transmit time, while other datagrams are sent right away.
+	 * The transmit time is only honoured when the outgoing network interface uses fq or etf
+	 * queueing discipline. Only supported on Linux 4.19 and newer.
+	 */
+	void enable_scheduled_transmission();
+
+	/**
+	 * @brief Send datagram at the given time.
+	 * Same as send(buf, destination_address), but the datagram is transmitted by the OS not earlier
+	 * than the given time. Scheduled transmission should be enabled with enable_scheduled_transmission() beforehand.
+	 * Only supported on Linux.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination_address - the destination IP address to send the datagram to.
+	 * @param transmit_time_ns - transmit time in nanoseconds of CLOCK_MONOTONIC clock,
+	 *                           which is the clock of std::chrono::steady_clock on Linux.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send_at(utki::span<const uint8_t> buf, const address& destination_address, uint64_t transmit_time_ns);
+
+	/**
+	 * @brief Send datagram to endpoint at the given time.
+	 * Same as send_at(buf, destination_address, transmit_time_ns), but the destination is already
+	 * in the OS native format.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination - the destination to send the datagram to.
+	 * @param transmit_time_ns - transmit time in nanoseconds of CLOCK_MONOTONIC clock.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send_at(utki::span<const uint8_t> buf, const endpoint& destination, uint64_t transmit_time_ns);
+
 	/**
 	 * @brief Receive datagram.
 	 * Writes a datagram to the given buffer at once if it is available.
@@ -108,10 +354,592 @@ public:
 	 */
 	size_t recieve(utki::span<uint8_t> buf, address& out_sender_address);
 
-#if CFG_OS == CFG_OS_WINDOWS
+	/**
+	 * @brief Receive datagram along with the sender endpoint.
+	 * Same as recieve(buf, out_sender_address), but the sender is stored in the OS native format,
+	 * so no address conversion is done. On dual-stack sockets, IPv4 senders are reported as
+	 * IPv4 mapped IPv6 endpoints.
+	 * @param buf - reference to the buffer the received datagram will be stored to.
+	 * @param out_sender - where the sender endpoint will be stored.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t recieve(utki::span<uint8_t> buf, endpoint& out_sender);
+
+	/**
+	 * @brief Connect the socket to a peer.
+	 * After connecting, the datagrams can be sent to the peer without specifying the destination address,
+	 * and only datagrams coming from the peer are received. The routing decision is cached by the OS,
+	 * so sending to a connected peer is cheaper than sending to an address each time.
+	 * No packets are sent over the network by this call.
+	 * The socket can be connected to another peer by calling connect() again.
+	 * @param peer_address - address of the peer.
+	 */
+	void connect(const address& peer_address);
+
+	/**
+	 * @brief Connect the socket to a peer endpoint.
+	 * Same as connect(peer_address), but the peer is given in the OS native format.
+	 * @param peer - endpoint of the peer.
+	 */
+	void connect(const endpoint& peer);
+
+	/**
+	 * @brief Dissolve the association with the peer.
+	 * After disconnecting, the socket receives datagrams from any sender again.
+	 */
+	void disconnect();
+
+	/**
+	 * @brief Send datagram to the connected peer.
+	 * Same as send(buf, destination_address) but sends the datagram to the peer
+	 * given to connect().
+	 * @param buf - buffer containing the datagram to send.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send(utki::span<const uint8_t> buf);
+
+	/**
+	 * @brief Receive datagram from the connected peer.
+	 * Same as recieve(buf, out_sender_address) but does not report the sender address.
+	 * Intended for connected sockets, where the sender is always the connected peer.
+	 * @param buf - reference to the buffer the received datagram will be stored to.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t recieve(utki::span<uint8_t> buf);
+
+	/**
+	 * @brief Send a run of equally sized datagrams.
+	 * The buffer is split into datagrams of segment_size bytes each, the last datagram can be shorter.
+	 * All datagrams are sent to the same destination.
+	 * On Linux, the splitting is done by the kernel or network hardware using UDP generic segmentation
+	 * offload (UDP_SEGMENT), so that a large buffer is passed down the network stack at once.
+	 * If segmentation offload is not supported, the datagrams are sent one by one.
+	 * @param buf - buffer containing the data to send.
+	 * @param segment_size - size of each datagram, in bytes.
+	 * @param destination_address - the destination IP address to send the datagrams to.
+	 * @return number of bytes actually sent. It is either the whole buffer size or a number of bytes
+	 *         in whole datagrams sent before the sending would block or the kernel rejected the segmentation
+	 *         parameters.
+	 * @throw std::system_error - in case the kernel rejects the segmentation parameters for this call,
+	 *                            e.g. if segment size exceeds the path MTU, before any datagram is sent.
+	 */
+	size_t send_segmented(utki::span<const uint8_t> buf, size_t segment_size, const address& destination_address);
+
+	/**
+	 * @brief Send a run of equally sized datagrams to endpoint.
+	 * Same as send_segmented(buf, segment_size, destination_address), but the destination is already
+	 * in the OS native format.
+	 * @param buf - buffer containing the data to send.
+	 * @param segment_size - size of each datagram, in bytes.
+	 * @param destination - the destination to send the datagrams to.
+	 * @return number of bytes actually sent.
+	 * @throw std::system_error - in case the kernel rejects the segmentation parameters for this call.
+	 */
+	size_t send_segmented(utki::span<const uint8_t> buf, size_t segment_size, const endpoint& destination);
+
+	/**
+	 * @brief Maximum number of datagrams sent or received by one system call.
+	 * Batches of bigger size are split into several system calls.
+	 */
+	constexpr static const size_t max_batch_size = 64;
+
+	/**
+	 * @brief Send several datagrams at once.
+	 * On Linux, the datagrams are sent using sendmmsg(), which sends up to max_batch_size
+	 * datagrams per system call. On other systems the datagrams are sent one by one.
+	 * The datagrams are sent in order. If some datagram cannot be sent at the current moment,
+	 * the sending stops and the number of datagrams sent so far is returned.
+	 * @param bufs - buffers containing the datagrams to send.
+	 * @param destination_addresses - destination addresses of the datagrams, one per datagram.
+	 * @return number of datagrams sent.
+	 */
+	size_t send_batch(utki::span<const utki::span<const uint8_t>> bufs, utki::span<const address> destination_addresses);
+
+	/**
+	 * @brief Send several datagrams to endpoints at once.
+	 * Same as send_batch(bufs, destination_addresses), but the destinations are already in the OS native format.
+	 * @param bufs - buffers containing the datagrams to send.
+	 * @param destinations - destination endpoints of the datagrams, one per datagram.
+	 * @return number of datagrams sent.
+	 */
+	size_t send_batch(utki::span<const utki::span<const uint8_t>> bufs, utki::span<const endpoint> destinations);
+
+	/**
+	 * @brief Send one datagram to many destinations.
+	 * Sends the same datagram to each of the given destinations, in order.
+	 * On Linux, the datagrams are sent using sendmmsg(), up to max_batch_size destinations per system call,
+	 * all the messages refer to the same buffer, so the datagram data is not copied in user space.
+	 * On other systems the datagrams are sent one by one.
+	 * If sending to some destination would block, the sending stops, so the datagram is sent to the
+	 * first N destinations, where N is the returned value, and sending to the rest of the destinations
+	 * would have blocked.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination_addresses - destination addresses.
+	 * @return number of destinations the datagram was sent to.
+	 */
+	size_t send_fanout(utki::span<const uint8_t> buf, utki::span<const address> destination_addresses);
+
+	/**
+	 * @brief Send one datagram to many endpoints.
+	 * Same as send_fanout(buf, destination_addresses), but the destinations are already in the OS native format,
+	 * so that the per-destination address conversion is done once by the caller instead of on every call.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destinations - destination endpoints.
+	 * @return number of destinations the datagram was sent to.
+	 */
+	size_t send_fanout(utki::span<const uint8_t> buf, utki::span<const endpoint> destinations);
+
+	/**
+	 * @brief Information about received datagram.
+	 */
+	struct datagram_info {
+		/**
+		 * @brief Address of the datagram sender.
+		 */
+		address sender;
+
+		/**
+		 * @brief Number of bytes stored to the buffer.
+		 */
+		size_t size = 0;
+
+		/**
+		 * @brief Size of the datagram as it was sent.
+		 * Bigger than the size if the datagram was truncated. Only reported on Linux,
+		 * on other systems it is equal to the size.
+		 */
+		size_t original_size = 0;
+
+		/**
+		 * @brief Whether the datagram did not fit the buffer and its tail was lost.
+		 * Truncation is only detected on Linux.
+		 */
+		bool truncated = false;
+
+		/**
+		 * @brief Cumulative number of datagrams dropped by the OS on this socket.
+		 * Only reported when the drop counter is enabled with set_drop_counter(), otherwise 0.
+		 */
+		uint32_t dropped = 0;
+
+		/**
+		 * @brief Time when the datagram was received by the OS.
+		 * Nanoseconds since the Unix epoch. Only reported when timestamping is enabled
+		 * with set_timestamping(), otherwise 0.
+		 */
+		uint64_t timestamp_ns = 0;
+	};
+
+	/**
+	 * @brief Receive several datagrams at once.
+	 * On Linux, the datagrams are received using recvmmsg(), which receives up to max_batch_size
+	 * datagrams per system call. On other systems the datagrams are received one by one.
+	 * Receives as many datagrams as available at the moment, but not more than number of buffers given.
+	 * No memory allocation is done by this function.
+	 * @param bufs - buffers to store the received datagrams to, one datagram per buffer.
+	 * @param out_infos - array where information about received datagrams is stored,
+	 *                    one element per buffer.
+	 * @return number of datagrams received.
+	 */
+	size_t receive_batch(utki::span<const utki::span<uint8_t>> bufs, utki::span<datagram_info> out_infos);
+
+	/**
+	 * @brief Receive several datagrams at once along with the sender endpoints.
+	 * Same as receive_batch(bufs, out_infos), but the senders are stored in the OS native format,
+	 * so no address conversion is done. The sender field of the datagram infos is left untouched.
+	 * @param bufs - buffers to store the received datagrams to, one datagram per buffer.
+	 * @param out_infos - array where information about received datagrams is stored,
+	 *                    one element per buffer.
+	 * @param out_senders - array where the sender endpoints are stored, one element per buffer.
+	 * @return number of datagrams received.
+	 */
+	size_t receive_batch(
+		utki::span<const utki::span<uint8_t>> bufs,
+		utki::span<datagram_info> out_infos,
+		utki::span<endpoint> out_senders
+	);
+
+	/**
+	 * @brief Enable or disable UDP generic receive offload.
+	 * When enabled, the kernel may coalesce several consecutive datagrams of the same size from the same sender
+	 * into one buffer, which is then returned by a single receive_segmented() call.
+	 * Receiving datagrams with recieve() or receive_batch() when the receive offload is enabled will
+	 * return the coalesced buffers without segment sizes, so use receive_segmented() in this mode.
+	 * The receive offload is only supported on Linux (UDP_GRO), on other systems this function does nothing.
+	 * @param enable - whether to enable the receive offload.
+	 */
+	void set_gro(bool enable);
+
+	/**
+	 * @brief Information about received run of coalesced datagrams.
+	 */
+	struct segmented_datagram_info {
+		/**
+		 * @brief Address of the datagrams sender.
+		 */
+		address sender;
+
+		/**
+		 * @brief Number of bytes stored to the buffer.
+		 */
+		size_t size = 0;
+
+		/**
+		 * @brief Size of each datagram in the buffer.
+		 * The last datagram can be shorter. If the buffer holds a single datagram,
+		 * then the segment size is equal to the datagram size.
+		 */
+		size_t segment_size = 0;
+
+		/**
+		 * @brief Whether the data did not fit the buffer and its tail was lost.
+		 * Truncation is only detected on Linux.
+		 */
+		bool truncated = false;
+
+		/**
+		 * @brief Cumulative number of datagrams dropped by the OS on this socket.
+		 * Only reported when the drop counter is enabled with set_drop_counter(), otherwise 0.
+		 */
+		uint32_t dropped = 0;
+
+		/**
+		 * @brief Time when the data was received by the OS.
+		 * Nanoseconds since the Unix epoch. Only reported when timestamping is enabled
+		 * with set_timestamping(), otherwise 0.
+		 */
+		uint64_t timestamp_ns = 0;
+	};
+
+	/**
+	 * @brief Receive a run of coalesced datagrams.
+	 * If the generic receive offload is enabled with set_gro(), the kernel may return several datagrams
+	 * at once. Otherwise, this function receives a single datagram. Use datagram_segments to iterate
+	 * over individual datagrams in the received data.
+	 * The buffer should be large enough to hold the coalesced datagrams, up to 64 kilobytes.
+	 * @param buf - buffer to store the received data to.
+	 * @param out_info - information about received data.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t receive_segmented(utki::span<uint8_t> buf, segmented_datagram_info& out_info);
+
+	/**
+	 * @brief Receive a run of coalesced datagrams along with the sender endpoint.
+	 * Same as receive_segmented(buf, out_info), but the sender is stored in the OS native format.
+	 * The sender field of the datagram info is left untouched.
+	 * @param buf - buffer to store the received data to.
+	 * @param out_info - information about received data.
+	 * @param out_sender - where the sender endpoint will be stored.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t receive_segmented(utki::span<uint8_t> buf, segmented_datagram_info& out_info, endpoint& out_sender);
+
+	/**
+	 * @brief Local end information of a datagram.
+	 */
+	struct packet_info {
+		/**
+		 * @brief Local IP address.
+		 * For received datagrams it is the destination address of the datagram.
+		 * For sent datagrams it is the source address to send the datagram from,
+		 * zero address means that the source address is selected by the OS.
+		 */
+		address::ip local_address{0, 0, 0, 0};
+
+		/**
+		 * @brief Network interface index.
+		 * For received datagrams it is the index of the interface the datagram arrived on.
+		 * For sent datagrams it is the index of the interface to send the datagram through,
+		 * 0 means that the interface is selected by the OS.
+		 */
+		unsigned interface_index = 0;
+	};
+
+	/**
+	 * @brief Enable or disable reporting of local end information for received datagrams.
+	 * Needs to be enabled to receive local end information with recieve(buf, out_sender_address, out_packet_info).
+	 * Supported on Linux and macOS (IP_PKTINFO, IPV6_RECVPKTINFO).
+	 * @param enable - whether to report the local end information.
+	 */
+	void set_packet_info(bool enable);
+
+	/**
+	 * @brief Receive datagram along with the local end information.
+	 * Same as recieve(buf, out_sender_address), but also reports the destination address and the
+	 * network interface of the datagram. This allows a socket bound to the any-address to know which
+	 * local address the datagram was sent to, and reply from the same address.
+	 * The reporting should be enabled with set_packet_info() beforehand, otherwise the returned packet info
+	 * is zeroed. Supported on Linux and macOS.
+	 * @param buf - reference to the buffer the received datagram will be stored to.
+	 * @param out_sender_address - reference to the IP-address structure where the IP-address
+	 *                             of the sender will be stored.
+	 * @param out_packet_info - where the local end information of the datagram will be stored.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t recieve(utki::span<uint8_t> buf, address& out_sender_address, packet_info& out_packet_info);
+
+	/**
+	 * @brief Receive datagram along with the sender endpoint and the local end information.
+	 * Same as recieve(buf, out_sender_address, out_packet_info), but the sender is stored
+	 * in the OS native format.
+	 * @param buf - reference to the buffer the received datagram will be stored to.
+	 * @param out_sender - where the sender endpoint will be stored.
+	 * @param out_packet_info - where the local end information of the datagram will be stored.
+	 * @return number of bytes stored in the output buffer.
+	 */
+	size_t recieve(utki::span<uint8_t> buf, endpoint& out_sender, packet_info& out_packet_info);
+
+	/**
+	 * @brief Send datagram from the given local address.
+	 * Same as send(buf, destination_address), but the source address and the outgoing network
+	 * interface of the datagram are chosen by the caller. Supported on Linux and macOS.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination_address - the destination IP address to send the datagram to.
+	 * @param source_packet_info - source address and interface to send the datagram from.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send(
+		utki::span<const uint8_t> buf,
+		const address& destination_address,
+		const packet_info& source_packet_info
+	);
+
+	/**
+	 * @brief Send datagram to endpoint from the given local address.
+	 * Same as send(buf, destination_address, source_packet_info), but the destination is already
+	 * in the OS native format.
+	 * @param buf - buffer containing the datagram to send.
+	 * @param destination - the destination to send the datagram to.
+	 * @param source_packet_info - source address and interface to send the datagram from.
+	 * @return number of bytes actually sent. Actually it is either 0 or the size of the
+	 *         datagram passed in as argument.
+	 */
+	size_t send(utki::span<const uint8_t> buf, const endpoint& destination, const packet_info& source_packet_info);
+
+	/**
+	 * @brief Join multicast group.
+	 * After joining, the socket receives datagrams sent to the group address and the port the socket is bound to.
+	 * IPv4 and IPv6 groups are supported. IPv4 groups can be joined on dual-stack sockets as well.
+	 * @param group - multicast group address.
+	 * @param interface_index - index of the network interface to join the group on.
+	 *                          0 means that the interface is selected by the OS.
+	 */
+	void join_group(const address::ip& group, unsigned interface_index = 0);
+
+	/**
+	 * @brief Join source-specific multicast group.
+	 * After joining, the socket receives datagrams sent to the group address only from the given source.
+	 * @param group - multicast group address.
+	 * @param source - address of the multicast source.
+	 * @param interface_index - index of the network interface to join the group on.
+	 *                          0 means that the interface is selected by the OS.
+	 */
+	void join_group(const address::ip& group, const address::ip& source, unsigned interface_index = 0);
+
+	/**
+	 * @brief Leave multicast group.
+	 * @param group - multicast group address previously joined with join_group(group, interface_index).
+	 * @param interface_index - index of the network interface the group was joined on.
+	 */
+	void leave_group(const address::ip& group, unsigned interface_index = 0);
+
+	/**
+	 * @brief Leave source-specific multicast group.
+	 * @param group - multicast group address previously joined with join_group(group, source, interface_index).
+	 * @param source - address of the multicast source.
+	 * @param interface_index - index of the network interface the group was joined on.
+	 */
+	void leave_group(const address::ip& group, const address::ip& source, unsigned interface_index = 0);
+
+	/**
+	 * @brief Set time-to-live of outgoing multicast datagrams.
+	 * Sets IPv4 TTL and, for dual-stack sockets, IPv6 hop limit.
+	 * By default, the TTL is 1, i.e. multicast datagrams do not leave the local network.
+	 * @param ttl - time-to-live, from 0 to 255.
+	 */
+	void set_multicast_ttl(unsigned ttl);
+
+	/**
+	 * @brief Set network interface for outgoing multicast datagrams.
+	 * @param interface_index - index of the network interface. 0 means that the interface is selected by the OS.
+	 */
+	void set_multicast_interface(unsigned interface_index);
+
+	/**
+	 * @brief Enable or disable looping back of outgoing multicast datagrams.
+	 * If enabled, then sent multicast datagrams are also delivered to the sockets on the local host
+	 * which have joined the group, including this socket. Enabled by default.
+	 * @param enable - whether to loop back outgoing multicast datagrams.
+	 */
+	void set_multicast_loopback(bool enable);
+
+	/**
+	 * @brief Enable or disable reporting of dropped datagrams count.
+	 * When enabled, the OS reports the cumulative number of datagrams dropped on this socket
+	 * due to receive buffer overflow along with each received datagram.
+	 * The count is stored to the datagram infos and to the socket statistics.
+	 * Only supported on Linux (SO_RXQ_OVFL), on other systems this function does nothing.
+	 * @param enable - whether to report the dropped datagrams count.
+	 */
+	void set_drop_counter(bool enable);
+
+	/**
+	 * @brief Enable or disable receive timestamps.
+	 * When enabled, the OS reports the time each datagram was received at,
+	 * the time is stored to the datagram infos of receive_batch() and receive_segmented().
+	 * Only supported on Linux (SO_TIMESTAMPNS), on other systems this function does nothing.
+	 * @param enable - whether to report receive timestamps.
+	 */
+	void set_timestamping(bool enable);
+
+	/**
+	 * @brief Get socket statistics.
+	 * @return socket statistics.
+	 */
+	const statistics& get_statistics() const noexcept
+	{
+		return this->stats;
+	}
+
+	/**
+	 * @brief Reset socket statistics counters to zero.
+	 * The dropped datagrams counter is kept, as it is maintained by the OS.
+	 */
+	void reset_statistics() noexcept
+	{
+		auto dropped = this->stats.dropped;
+		this->stats = statistics();
+		this->stats.dropped = dropped;
+	}
 
 private:
+	bool is_peer_v4();
+
+	void set_option(int level, int name, const void* value, size_t value_size, const char* error_message);
+
+	void set_group_membership(int option, const address::ip& group, const address::ip* source, unsigned interface_index);
+
+	send_status send_to(utki::span<const uint8_t> buf, const sockaddr* socket_address, size_t socket_address_length);
+
+	size_t send_datagram(utki::span<const uint8_t> buf, const sockaddr* socket_address, size_t socket_address_length);
+
+	size_t receive_from(utki::span<uint8_t> buf, endpoint* out_sender);
+
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX || CFG_OS == CFG_OS_UNIX
+	// receive datagram with recvmsg() and parse control messages
+	size_t receive_message(
+		utki::span<uint8_t> buf,
+		endpoint& out_sender,
+		segmented_datagram_info& out_info,
+		packet_info* out_packet_info
+	);
+#endif
+
+#if CFG_OS == CFG_OS_WINDOWS
 	void set_waiting_flags(utki::flags<opros::ready> waiting_flags) override;
 #endif
 };
+
+/**
+ * @brief Range of datagrams in a run of coalesced datagrams.
+ * Splits the data received with udp_socket::receive_segmented() into individual datagrams.
+ * Usage:
+ * @code{.cpp}
+ * setka::udp_socket::segmented_datagram_info info;
+ * auto size = socket.receive_segmented(buf, info);
+ * for(auto datagram : setka::datagram_segments(utki::make_span(buf.data(), size), info.segment_size)){
+ *     // process datagram
+ * }
+ * @endcode
+ */
+class datagram_segments
+{
+	utki::span<const uint8_t> data;
+	size_t segment_size;
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param data - coalesced datagrams.
+	 * @param segment_size - size of each datagram, the last datagram can be shorter.
+	 *                       If 0, then the whole data is one datagram.
+	 */
+	datagram_segments(utki::span<const uint8_t> data, size_t segment_size) :
+		data(data),
+		segment_size(segment_size == 0 ? data.size() : segment_size)
+	{}
+
+	class iterator
+	{
+		friend class datagram_segments;
+
+		utki::span<const uint8_t> rest;
+		size_t segment_size;
+
+		iterator(utki::span<const uint8_t> rest, size_t segment_size) :
+			rest(rest),
+			segment_size(segment_size)
+		{}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = utki::span<const uint8_t>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		value_type operator*() const noexcept
+		{
+			return this->rest.subspan(0, std::min(this->rest.size(), this->segment_size));
+		}
+
+		iterator& operator++() noexcept
+		{
+			this->rest = this->rest.subspan(std::min(this->rest.size(), this->segment_size));
+			return *this;
+		}
+
+		iterator operator++(int) noexcept
+		{
+			auto ret = *this;
+			this->operator++();
+			return ret;
+		}
+
+		bool operator==(const iterator& i) const noexcept
+		{
+			return this->rest.data() == i.rest.data() && this->rest.size() == i.rest.size();
+		}
+
+		bool operator!=(const iterator& i) const noexcept
+		{
+			return !this->operator==(i);
+		}
+	};
+
+	iterator begin() const noexcept
+	{
+		return {this->data, this->segment_size};
+	}
+
+	iterator end() const noexcept
+	{
+		return {this->data.subspan(this->data.size()), this->segment_size};
+	}
+
+	/**
+	 * @brief Get number of datagrams.
+	 * @return number of datagrams.
+	 */
+	size_t size() const noexcept
+	{
+		if (this->segment_size == 0) {
+			return 0;
+		}
+		return (this->data.size() + this->segment_size - 1) / this->segment_size;
+	}
+};
+
 } // namespace setka
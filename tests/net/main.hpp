@@ -14,8 +14,33 @@ inline void test_setka_socket(){
 	basic_client_server_test::run();
 	basic_udp_sockets_test::run();
 	test_udp_socket_wait_for_writing::run();
+	test_udp_socket_batch::run();
+	test_udp_socket_segmented_send::run();
+	test_udp_socket_segmented_receive::run();
+	test_udp_socket_connect::run();
+	test_udp_socket_packet_info::run();
+	test_udp_socket_multicast::run();
+	test_udp_socket_statistics::run();
+	test_udp_socket_fanout::run();
+	test_udp_socket_path_mtu::run();
+	test_reliable_connection::run();
+	test_paced_udp_sender::run();
+	test_datagram_pool::run();
+	test_endpoint::run();
+	test_address_chars::run();
+	test_address_constexpr::run();
+	test_address_map::run();
+	test_prefix_table::run();
+	test_ip_list_parser::run();
+	test_udp_receive_group::run();
+	test_packet_capture_socket::run();
 	send_data_continuously_with_wait_set::run();
 	send_data_continuously::run();
+	test_tcp_socket_close::run();
+	test_tcp_socket_address_cache::run();
+	test_connection_table::run();
+	test_tcp_zerocopy_receive::run();
+	test_multipath_tcp::run();
 
 	test_simple_dns_lookup::run();
 	test_request_from_callback::run();
@@ -1,6 +1,17 @@
 #include "../../src/setka/tcp_socket.hpp"
 #include "../../src/setka/tcp_server_socket.hpp"
 #include "../../src/setka/udp_socket.hpp"
+#include "../../src/setka/connection_table.hpp"
+#include "../../src/setka/tcp_zerocopy_receiver.hpp"
+#include "../../src/setka/udp_receive_group.hpp"
+#include "../../src/setka/packet_capture_socket.hpp"
+#include "../../src/setka/reliable_connection.hpp"
+#include "../../src/setka/paced_udp_sender.hpp"
+#include "../../src/setka/datagram_pool.hpp"
+#include "../../src/setka/address_map.hpp"
+#include "../../src/setka/keyed_address_hash.hpp"
+#include "../../src/setka/prefix_table.hpp"
+#include "../../src/setka/ip_list_parser.hpp"
 
 #include <opros/wait_set.hpp>
 #include <nitki/thread.hpp>
@@ -11,8 +22,20 @@
 #include <utki/debug.hpp>
 #include <utki/util.hpp>
 
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "socket.hpp"
 
+#if CFG_OS == CFG_OS_LINUX
+#	include <net/if.h>
+#	include <netinet/udp.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
 #ifdef assert
 #	undef assert
 #endif
@@ -801,3 +824,2645 @@ void run(){
 	}
 }
 }
+
+namespace test_tcp_socket_close{
+namespace{
+std::pair<setka::tcp_socket, setka::tcp_socket> make_connection(setka::tcp_server_socket& server_sock){
+	setka::tcp_socket sock_c(setka::address("127.0.0.1", server_sock.get_local_port()));
+
+	setka::tcp_socket sock_s;
+	for(unsigned i = 0; i < 20 && sock_s.is_empty(); ++i){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		sock_s = server_sock.accept();
+	}
+	utki::assert_always(!sock_s.is_empty(), SL);
+
+	return std::make_pair(std::move(sock_c), std::move(sock_s));
+}
+}
+
+void run(){
+	setka::tcp_server_socket server_sock(13666);
+
+	// abortive close resets the connection
+	{
+		auto [sock_c, sock_s] = make_connection(server_sock);
+
+		sock_c.abort();
+		utki::assert_always(sock_c.is_empty(), SL);
+
+		bool reset = false;
+		for(unsigned i = 0; i < 20 && !reset; ++i){
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			try{
+				std::array<uint8_t, 4> buf; // NOLINT
+				sock_s.receive(utki::make_span(buf));
+				// NOLINTNEXTLINE(bugprone-empty-catch)
+			}catch(std::system_error&){
+				// connection reset by peer
+				reset = true;
+			}
+		}
+		utki::assert_always(reset, SL);
+	}
+
+	// graceful close when peer has closed the connection
+	{
+		auto [sock_c, sock_s] = make_connection(server_sock);
+
+		const std::array<uint8_t, 4> data = {'0', '1', '2', '4'};
+		utki::assert_always(sock_s.send(utki::make_span(data)) == data.size(), SL);
+		sock_s.disconnect();
+
+		utki::assert_always(sock_c.close_gracefully(3000), SL);
+		utki::assert_always(sock_c.is_empty(), SL);
+	}
+
+	// graceful close timeout when peer does not close the connection
+	{
+		auto [sock_c, sock_s] = make_connection(server_sock);
+
+		utki::assert_always(!sock_c.close_gracefully(300), SL);
+		utki::assert_always(sock_c.is_empty(), SL);
+	}
+}
+}
+
+namespace test_tcp_socket_address_cache{
+void run(){
+	setka::tcp_server_socket server_sock(13666);
+
+	setka::tcp_socket sock_c(setka::address("127.0.0.1", 13666));
+
+	// remote address is known right after connect() is initiated
+	utki::assert_always(sock_c.get_remote_address().host.get_v4() == 0x7f000001, SL);
+	utki::assert_always(sock_c.get_remote_address().port == 13666, SL);
+
+	setka::tcp_socket sock_s;
+	for(unsigned i = 0; i < 20 && sock_s.is_empty(); ++i){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		sock_s = server_sock.accept();
+	}
+	utki::assert_always(!sock_s.is_empty(), SL);
+
+	// remote address of accepted socket is obtained from accept()
+	auto remote = sock_s.get_remote_address();
+	utki::assert_always(remote.host.get_v4() == 0x7f000001, SL);
+	utki::assert_always(remote.port == sock_c.get_local_address().port, SL);
+
+	auto local = sock_s.get_local_address();
+	utki::assert_always(local.port == 13666, SL);
+
+	// re-query addresses from the system and check they are same as cached ones
+	sock_s.reset_address_cache();
+	utki::assert_always(sock_s.get_remote_address() == remote, SL);
+	utki::assert_always(sock_s.get_local_address() == local, SL);
+
+	// cached addresses are moved along with the socket
+	setka::tcp_socket moved_sock(std::move(sock_s));
+	utki::assert_always(moved_sock.get_remote_address() == remote, SL);
+}
+}
+
+namespace test_connection_table{
+void run(){
+	setka::tcp_server_socket server_sock(13666);
+
+	constexpr unsigned num_connections = 10;
+
+	std::vector<setka::tcp_socket> clients;
+	for(unsigned i = 0; i != num_connections; ++i){
+		clients.emplace_back(setka::address("127.0.0.1", 13666));
+	}
+
+	setka::connection_table table;
+	std::vector<setka::connection_table::id> ids;
+
+	for(unsigned i = 0; i < 50 && ids.size() != num_connections; ++i){
+		auto s = server_sock.accept();
+		if(s.is_empty()){
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+		ids.push_back(table.insert(std::move(s), unsigned(ids.size())));
+		utki::assert_always(s.is_empty(), SL);
+	}
+	utki::assert_always(ids.size() == num_connections, SL);
+	utki::assert_always(table.size() == num_connections, SL);
+
+	for(unsigned i = 0; i != num_connections; ++i){
+		utki::assert_always(table.contains(ids[i]), SL);
+		utki::assert_always(table.get_state(ids[i]) == i, SL);
+	}
+
+	// wait for data from the client on a table entry
+	{
+		setka::connection_table::waitable_entry entry(table, ids.front());
+
+		opros::wait_set ws(1);
+		ws.add(entry, utki::make_flags({opros::ready::read}), &entry);
+
+		uint8_t byte = 'a';
+		for(auto& c : clients){
+			utki::assert_always(c.send(utki::make_span(&byte, 1)) == 1, SL);
+		}
+
+		utki::assert_always(ws.wait(3000), SL);
+		utki::assert_always(ws.get_triggered().size() == 1, SL);
+		utki::assert_always(ws.get_triggered()[0].user_data == &entry, SL);
+
+		ws.remove(entry);
+	}
+
+	for(auto& i : ids){
+		std::array<uint8_t, 1> buf{};
+		size_t num_bytes_received = 0;
+		for(unsigned j = 0; j < 30 && num_bytes_received == 0; ++j){
+			num_bytes_received = table.receive(i, utki::make_span(buf));
+			if(num_bytes_received == 0){
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+		}
+		utki::assert_always(num_bytes_received == 1, SL);
+		utki::assert_always(buf[0] == 'a', SL);
+
+		uint8_t byte = 'b';
+		utki::assert_always(table.send(i, utki::make_span(&byte, 1)) == 1, SL);
+	}
+
+	// closed connection id becomes invalid and is not confused with a new connection reusing the slot
+	table.close(ids[3]);
+	utki::assert_always(!table.contains(ids[3]), SL);
+	utki::assert_always(table.size() == num_connections - 1, SL);
+
+	auto extracted = table.extract(ids[4]);
+	utki::assert_always(!extracted.is_empty(), SL);
+	utki::assert_always(!table.contains(ids[4]), SL);
+
+	auto new_id = table.insert(std::move(extracted));
+	utki::assert_always(table.contains(new_id), SL);
+	utki::assert_always(new_id != ids[4], SL);
+	utki::assert_always(!table.contains(ids[4]), SL);
+	utki::assert_always(table.size() == num_connections - 1, SL);
+
+	try{
+		table.get_state(ids[3]);
+		utki::assert_always(false, SL);
+		// NOLINTNEXTLINE(bugprone-empty-catch)
+	}catch(std::logic_error&){
+		// should get here
+	}
+
+	// moved-from table is empty and usable, move assignment closes connections of the target table
+	{
+		setka::connection_table moved(std::move(table));
+		// NOLINTNEXTLINE(bugprone-use-after-move, hicpp-invalid-access-moved)
+		utki::assert_always(table.size() == 0, SL);
+		utki::assert_always(!table.contains(new_id), SL);
+		utki::assert_always(moved.size() == num_connections - 1, SL);
+		utki::assert_always(moved.contains(new_id), SL);
+
+		setka::tcp_socket client(setka::address("127.0.0.1", 13666));
+		setka::tcp_socket accepted;
+		for(unsigned i = 0; i < 50 && accepted.is_empty(); ++i){
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			accepted = server_sock.accept();
+		}
+		utki::assert_always(!accepted.is_empty(), SL);
+
+		table.insert(std::move(accepted));
+		utki::assert_always(table.size() == 1, SL);
+
+		table = std::move(moved);
+		utki::assert_always(table.size() == num_connections - 1, SL);
+		utki::assert_always(table.contains(new_id), SL);
+		// NOLINTNEXTLINE(bugprone-use-after-move, hicpp-invalid-access-moved)
+		utki::assert_always(moved.size() == 0, SL);
+
+		// the connection held by the table before the assignment is closed,
+		// so the client socket becomes readable while there is no data to read
+		opros::wait_set ws(1);
+		ws.add(client, utki::make_flags({opros::ready::read}), &client);
+		utki::assert_always(ws.wait(3000), SL);
+		ws.remove(client);
+
+		std::array<uint8_t, 1> buf{};
+		utki::assert_always(client.receive(utki::make_span(buf)) == 0, SL);
+	}
+}
+}
+
+namespace test_tcp_zerocopy_receive{
+void run(){
+	setka::tcp_server_socket server_sock(13666);
+
+	setka::tcp_socket sock_s(setka::address("127.0.0.1", 13666));
+
+	setka::tcp_socket sock_r;
+	for(unsigned i = 0; i < 20 && sock_r.is_empty(); ++i){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		sock_r = server_sock.accept();
+	}
+	utki::assert_always(!sock_r.is_empty(), SL);
+
+	setka::tcp_zerocopy_receiver receiver(sock_r);
+
+	std::vector<uint8_t> data(utki::kilobyte * utki::kilobyte);
+	for(size_t i = 0; i != data.size(); ++i){
+		data[i] = uint8_t(i);
+	}
+
+	size_t num_bytes_sent = 0;
+	size_t num_bytes_received = 0;
+
+	uint32_t start_time = utki::get_ticks_ms();
+
+	while(num_bytes_received != data.size()){
+		utki::assert_always(utki::get_ticks_ms() - start_time < 10000, SL);
+
+		num_bytes_sent += sock_s.send(utki::make_span(data).subspan(num_bytes_sent));
+
+		auto received = receiver.receive();
+		if(received.size() == 0){
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		for(auto part : {received.mapped, received.copied}){
+			for(auto b : part){
+				utki::assert_always(num_bytes_received < data.size(), SL);
+				utki::assert_always(b == data[num_bytes_received], SL);
+				++num_bytes_received;
+			}
+		}
+
+		receiver.release();
+	}
+}
+}
+
+namespace test_multipath_tcp{
+void run(){
+	setka::tcp_server_socket server_sock(13666, false, setka::tcp_server_socket::max_pending_connections, true);
+
+	setka::tcp_socket sock_c(setka::address("127.0.0.1", 13666), false, true);
+
+	setka::tcp_socket sock_s;
+	for(unsigned i = 0; i < 20 && sock_s.is_empty(); ++i){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		sock_s = server_sock.accept();
+	}
+	utki::assert_always(!sock_s.is_empty(), SL);
+
+	// MPTCP might be not supported by the OS, then sockets fall back to plain TCP
+	bool multipath = sock_c.is_multipath();
+	utki::log([&](auto&o){o << "MPTCP supported = " << multipath << std::endl;});
+
+	const std::array<uint8_t, 4> data = {'0', '1', '2', '4'};
+	utki::assert_always(sock_c.send(utki::make_span(data)) == data.size(), SL);
+
+	std::array<uint8_t, 4> buf{};
+	size_t num_bytes_received = 0;
+	for(unsigned i = 0; i < 30 && num_bytes_received != buf.size(); ++i){
+		num_bytes_received += sock_s.receive(utki::make_span(buf).subspan(num_bytes_received));
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_bytes_received == buf.size(), SL);
+	utki::assert_always(buf == data, SL);
+
+	auto info = sock_c.get_multipath_info();
+	auto subflows = sock_c.get_multipath_subflows();
+
+	if(multipath){
+		utki::assert_always(sock_s.is_multipath(), SL);
+		utki::assert_always(!info.fallback, SL);
+		for(const auto& sf : subflows){
+			utki::assert_always(sf.remote.port == 13666, SL);
+		}
+	}else{
+		utki::assert_always(info.fallback, SL);
+		utki::assert_always(subflows.empty(), SL);
+	}
+}
+}
+
+namespace test_udp_socket_batch{
+void run(){
+	setka::udp_socket recv_sock(13666);
+	setka::udp_socket send_sock(0);
+
+	constexpr size_t num_datagrams = 100;
+
+	std::vector<std::array<uint8_t, 8>> datagrams(num_datagrams);
+	std::vector<utki::span<const uint8_t>> send_bufs;
+	std::vector<setka::address> destinations(num_datagrams, setka::address("127.0.0.1", 13666));
+	for(size_t i = 0; i != num_datagrams; ++i){
+		datagrams[i].fill(uint8_t(i));
+		send_bufs.emplace_back(utki::make_span(datagrams[i]));
+	}
+
+	size_t num_sent = 0;
+	for(unsigned i = 0; i < 10 && num_sent != num_datagrams; ++i){
+		num_sent += send_sock.send_batch(
+				utki::make_span(send_bufs).subspan(num_sent),
+				utki::make_span(destinations).subspan(num_sent)
+			);
+	}
+	utki::assert_always(num_sent == num_datagrams, SL);
+
+	// last buffer is too small to hold a datagram
+	std::vector<std::array<uint8_t, 8>> recv_storage(num_datagrams - 1);
+	std::array<uint8_t, 4> small_buf{};
+	std::vector<utki::span<uint8_t>> recv_bufs;
+	for(auto& b : recv_storage){
+		recv_bufs.emplace_back(utki::make_span(b));
+	}
+	recv_bufs.emplace_back(utki::make_span(small_buf));
+
+	std::vector<setka::udp_socket::datagram_info> infos(num_datagrams);
+
+	size_t num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received != num_datagrams; ++i){
+		num_received += recv_sock.receive_batch(
+				utki::make_span(recv_bufs).subspan(num_received),
+				utki::make_span(infos).subspan(num_received)
+			);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_received == num_datagrams, SL);
+
+	for(size_t i = 0; i != num_datagrams; ++i){
+		const auto& info = infos[i];
+		utki::assert_always(info.sender.host.get_v4() == 0x7f000001, SL);
+		utki::assert_always(info.sender.port == send_sock.get_local_port(), SL);
+		if(i == num_datagrams - 1){
+			utki::assert_always(info.size == small_buf.size(), SL);
+#if CFG_OS == CFG_OS_LINUX
+			utki::assert_always(info.truncated, SL);
+#endif
+		}else{
+			utki::assert_always(info.size == datagrams[i].size(), SL);
+			utki::assert_always(!info.truncated, SL);
+		}
+		for(size_t j = 0; j != info.size; ++j){
+			utki::assert_always(recv_bufs[i][j] == uint8_t(i), SL);
+		}
+	}
+}
+}
+
+#if CFG_OS == CFG_OS_LINUX && defined(UDP_SEGMENT)
+namespace test_udp_socket_segmented_send{
+// number of sendmsg() calls with UDP_SEGMENT to pass through before failing one with EINVAL, negative means never fail
+int num_segmented_sends_before_einval = -1;
+}
+
+// Intercepts sendmsg() calls of the library, so that failure of a particular segmented send can be simulated.
+extern "C" ssize_t sendmsg(int fd, const msghdr* msg, int flags){
+	for(auto cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(const_cast<msghdr*>(msg), cm)){
+		if(cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_SEGMENT){
+			auto& n = test_udp_socket_segmented_send::num_segmented_sends_before_einval;
+			if(n == 0){
+				n = -1;
+				errno = EINVAL;
+				return -1;
+			}
+			if(n > 0){
+				--n;
+			}
+			break;
+		}
+	}
+	return ssize_t(syscall(SYS_sendmsg, fd, msg, flags));
+}
+#endif
+
+namespace test_udp_socket_segmented_send{
+void run(){
+	setka::udp_socket recv_sock(13667);
+	setka::udp_socket send_sock(0);
+
+	constexpr size_t segment_size = 100;
+
+	std::vector<uint8_t> data(segment_size * 10 + 50);
+	for(size_t i = 0; i != data.size(); ++i){
+		data[i] = uint8_t(i / segment_size);
+	}
+
+	size_t num_sent = 0;
+	for(unsigned i = 0; i < 10 && num_sent != data.size(); ++i){
+		num_sent += send_sock.send_segmented(
+				utki::make_span(data).subspan(num_sent),
+				segment_size,
+				setka::address("127.0.0.1", 13667)
+			);
+	}
+	utki::assert_always(num_sent == data.size(), SL);
+
+	constexpr size_t num_datagrams = 11;
+
+	std::vector<std::array<uint8_t, segment_size * 2>> recv_storage(num_datagrams);
+	std::vector<utki::span<uint8_t>> recv_bufs;
+	for(auto& b : recv_storage){
+		recv_bufs.emplace_back(utki::make_span(b));
+	}
+	std::vector<setka::udp_socket::datagram_info> infos(num_datagrams);
+
+	size_t num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received != num_datagrams; ++i){
+		num_received += recv_sock.receive_batch(
+				utki::make_span(recv_bufs).subspan(num_received),
+				utki::make_span(infos).subspan(num_received)
+			);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_received == num_datagrams, SL);
+
+	for(size_t i = 0; i != num_datagrams; ++i){
+		utki::assert_always(infos[i].size == (i == num_datagrams - 1 ? 50 : segment_size), SL);
+		for(size_t j = 0; j != infos[i].size; ++j){
+			utki::assert_always(recv_bufs[i][j] == uint8_t(i), SL);
+		}
+	}
+
+#if CFG_OS == CFG_OS_LINUX && defined(UDP_SEGMENT)
+	// EINVAL on a later send reports the bytes sent so far, EINVAL on the first send throws
+	{
+		// 64 segments are sent per sendmsg() call
+		std::vector<uint8_t> big_data(segment_size * 64 * 2 + 50);
+
+		test_udp_socket_segmented_send::num_segmented_sends_before_einval = 1;
+		auto n = send_sock.send_segmented(big_data, segment_size, setka::address("127.0.0.1", 13667));
+		test_udp_socket_segmented_send::num_segmented_sends_before_einval = -1;
+
+		if(n == big_data.size()){
+			utki::log([](auto&o){o << "test_udp_socket_segmented_send: segmentation offload is not supported" << std::endl;});
+		}else{
+			utki::assert_always(n == segment_size * 64, [&](auto&o){o << "n = " << n;}, SL);
+
+			test_udp_socket_segmented_send::num_segmented_sends_before_einval = 0;
+			bool thrown = false;
+			try{
+				send_sock.send_segmented(big_data, segment_size, setka::address("127.0.0.1", 13667));
+			}catch(std::system_error& e){
+				thrown = e.code().value() == EINVAL;
+			}
+			test_udp_socket_segmented_send::num_segmented_sends_before_einval = -1;
+			utki::assert_always(thrown, SL);
+
+			// segmentation offload is still used
+			utki::assert_always(send_sock.send_segmented(big_data, segment_size, setka::address("127.0.0.1", 13667)) == big_data.size(), SL);
+		}
+	}
+#endif
+}
+}
+
+namespace test_udp_socket_segmented_receive{
+void run(){
+	setka::udp_socket recv_sock(13668);
+	setka::udp_socket send_sock(0);
+
+	recv_sock.set_gro(true);
+
+	constexpr size_t segment_size = 100;
+
+	std::vector<uint8_t> data(segment_size * 10 + 50);
+	for(size_t i = 0; i != data.size(); ++i){
+		data[i] = uint8_t(i / segment_size);
+	}
+
+	size_t num_sent = 0;
+	for(unsigned i = 0; i < 10 && num_sent != data.size(); ++i){
+		num_sent += send_sock.send_segmented(
+				utki::make_span(data).subspan(num_sent),
+				segment_size,
+				setka::address("127.0.0.1", 13668)
+			);
+	}
+	utki::assert_always(num_sent == data.size(), SL);
+
+	std::vector<uint8_t> buf(0xffff);
+
+	size_t num_datagrams = 0;
+	size_t num_bytes = 0;
+	for(unsigned i = 0; i < 30 && num_bytes != data.size();){
+		setka::udp_socket::segmented_datagram_info info;
+		auto size = recv_sock.receive_segmented(utki::make_span(buf), info);
+		if(size == 0){
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			++i;
+			continue;
+		}
+		utki::assert_always(info.sender.host.get_v4() == 0x7f000001, SL);
+		utki::assert_always(!info.truncated, SL);
+		utki::assert_always(info.segment_size == segment_size || info.segment_size == size, SL);
+
+		for(auto datagram : setka::datagram_segments(utki::make_span(buf.data(), size), info.segment_size)){
+			utki::assert_always(datagram.size() == (num_datagrams == 10 ? 50 : segment_size), SL);
+			for(auto b : datagram){
+				utki::assert_always(b == uint8_t(num_datagrams), SL);
+			}
+			++num_datagrams;
+			num_bytes += datagram.size();
+		}
+	}
+	utki::assert_always(num_bytes == data.size(), SL);
+	utki::assert_always(num_datagrams == 11, SL);
+}
+}
+
+namespace test_udp_socket_connect{
+void run(){
+	setka::udp_socket recv_sock(13669);
+	setka::udp_socket send_sock(0);
+	setka::udp_socket foreign_sock(0);
+
+	// connecting binds the socket to a local port
+	send_sock.connect(setka::address("127.0.0.1", 13669));
+	recv_sock.connect(setka::address("127.0.0.1", send_sock.get_local_port()));
+
+	std::array<uint8_t, 4> foreign_data = {{1, 1, 1, 1}};
+	std::array<uint8_t, 4> data = {{'a', 'b', 'c', 'd'}};
+
+	// datagram from a foreign sender is dropped by the connected socket
+	utki::assert_always(foreign_sock.send(foreign_data, setka::address("127.0.0.1", 13669)) == foreign_data.size(), SL);
+	utki::assert_always(send_sock.send(data) == data.size(), SL);
+
+	std::array<uint8_t, 8> buf{};
+	size_t num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+		num_received = recv_sock.recieve(buf);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_received == data.size(), SL);
+	utki::assert_always(std::equal(data.begin(), data.end(), buf.begin()), SL);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	utki::assert_always(recv_sock.recieve(buf) == 0, SL);
+
+	recv_sock.disconnect();
+
+	utki::assert_always(foreign_sock.send(foreign_data, setka::address("127.0.0.1", 13669)) == foreign_data.size(), SL);
+
+	setka::address sender;
+	num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+		num_received = recv_sock.recieve(buf, sender);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_received == foreign_data.size(), SL);
+	utki::assert_always(sender.port == foreign_sock.get_local_port(), SL);
+}
+}
+
+namespace test_udp_socket_packet_info{
+void run(){
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX
+	setka::udp_socket server_sock(13670);
+	setka::udp_socket client_sock(0);
+
+	server_sock.set_packet_info(true);
+
+	std::vector<setka::address::ip> local_addresses = {
+		setka::address::ip(0x7f000001),
+#	if CFG_OS == CFG_OS_LINUX
+		// whole 127.0.0.0/8 network is routed to loopback interface on Linux
+		setka::address::ip(0x7f000002),
+#	endif
+	};
+
+	for(const auto& local_address : local_addresses){
+		std::array<uint8_t, 4> data = {{'a', 'b', 'c', 'd'}};
+		utki::assert_always(client_sock.send(data, setka::address(local_address, 13670)) == data.size(), SL);
+
+		std::array<uint8_t, 8> buf{};
+		setka::address sender;
+		setka::udp_socket::packet_info pi;
+		size_t num_received = 0;
+		for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+			num_received = server_sock.recieve(buf, sender, pi);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		utki::assert_always(num_received == data.size(), SL);
+		utki::assert_always(sender.port == client_sock.get_local_port(), SL);
+		utki::assert_always(pi.local_address == local_address, SL);
+		utki::assert_always(pi.interface_index != 0, SL);
+
+		// reply from the address the request was sent to
+		utki::assert_always(server_sock.send(utki::make_span(buf.data(), num_received), sender, pi) == num_received, SL);
+
+		setka::address reply_sender;
+		num_received = 0;
+		for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+			num_received = client_sock.recieve(buf, reply_sender);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		utki::assert_always(num_received == data.size(), SL);
+		utki::assert_always(reply_sender.host == local_address, SL);
+		utki::assert_always(reply_sender.port == 13670, SL);
+	}
+#endif
+}
+}
+
+namespace test_udp_socket_multicast{
+void run(){
+	setka::udp_socket recv_sock(13671);
+	setka::udp_socket send_sock(0);
+
+	send_sock.set_multicast_interface(0);
+	send_sock.set_multicast_loopback(true);
+	send_sock.set_multicast_ttl(1);
+
+	auto receive = [&](utki::span<uint8_t> buf, setka::address& sender){
+		size_t num_received = 0;
+		for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+			num_received = recv_sock.recieve(buf, sender);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return num_received;
+	};
+
+	std::array<uint8_t, 4> data = {{'a', 'b', 'c', 'd'}};
+	std::array<uint8_t, 8> buf{};
+	setka::address sender;
+
+	// any-source multicast
+	{
+		setka::address::ip group(0xef010203); // 239.1.2.3
+		recv_sock.join_group(group);
+
+		try{
+			send_sock.send(data, setka::address(group, 13671));
+		}catch(std::system_error& e){
+			// loopback interface is not multicast capable on most systems, so the test needs a multicast route
+			utki::log([&](auto&o){o << "test_udp_socket_multicast: no multicast route, skip the test: " << e.what() << std::endl;});
+			return;
+		}
+		utki::assert_always(receive(buf, sender) == data.size(), SL);
+		utki::assert_always(sender.port == send_sock.get_local_port(), SL);
+
+		recv_sock.leave_group(group);
+
+		utki::assert_always(send_sock.send(data, setka::address(group, 13671)) == data.size(), SL);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		utki::assert_always(recv_sock.recieve(buf, sender) == 0, SL);
+	}
+
+	// source-specific multicast
+	{
+		// the multicast datagrams are sent from the address of the outgoing interface
+		auto source = sender.host;
+
+		setka::address::ip group(0xe8010203); // 232.1.2.3
+		recv_sock.join_group(group, source);
+
+		utki::assert_always(send_sock.send(data, setka::address(group, 13671)) == data.size(), SL);
+		utki::assert_always(receive(buf, sender) == data.size(), SL);
+		utki::assert_always(sender.host == source, SL);
+
+		recv_sock.leave_group(group, source);
+
+		// datagrams from other sources are not delivered
+		setka::address::ip other_source(source.get_v4() + 1);
+		recv_sock.join_group(group, other_source);
+		utki::assert_always(send_sock.send(data, setka::address(group, 13671)) == data.size(), SL);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		utki::assert_always(recv_sock.recieve(buf, sender) == 0, SL);
+		recv_sock.leave_group(group, other_source);
+	}
+}
+}
+
+namespace test_udp_socket_statistics{
+void run(){
+	setka::udp_socket recv_sock(13672);
+	setka::udp_socket send_sock(0);
+
+	recv_sock.set_drop_counter(true);
+
+	std::array<uint8_t, 8> buf{};
+	setka::address sender;
+
+	utki::assert_always(recv_sock.recieve(buf, sender) == 0, SL);
+	utki::assert_always(recv_sock.get_statistics().receive_would_block == 1, SL);
+
+	// send more datagrams than the receive buffer can hold
+	constexpr size_t num_datagrams = 2000;
+	std::vector<uint8_t> data(1000);
+	size_t num_sent = 0;
+	for(size_t i = 0; i != num_datagrams; ++i){
+		if(send_sock.send(data, setka::address("127.0.0.1", 13672)) != 0){
+			++num_sent;
+		}
+	}
+
+	const auto& send_stats = send_sock.get_statistics();
+	utki::assert_always(send_stats.datagrams_sent == num_sent, SL);
+	utki::assert_always(send_stats.bytes_sent == num_sent * data.size(), SL);
+	utki::assert_always(send_stats.send_would_block == num_datagrams - num_sent, SL);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	size_t num_received = 0;
+	for(; recv_sock.recieve(buf, sender) != 0; ++num_received){}
+
+	const auto& recv_stats = recv_sock.get_statistics();
+	utki::assert_always(num_received != 0, SL);
+	utki::assert_always(recv_stats.datagrams_received == num_received, SL);
+	utki::assert_always(recv_stats.bytes_received == num_received * buf.size(), SL);
+	utki::assert_always(recv_stats.receive_would_block == 2, SL);
+
+#if CFG_OS == CFG_OS_LINUX
+	utki::assert_always(recv_stats.truncated == num_received, SL);
+
+	// the drop counter is reported with datagrams queued after the drops
+	utki::assert_always(send_sock.send(data, setka::address("127.0.0.1", 13672)) == data.size(), SL);
+	std::array<utki::span<uint8_t>, 1> bufs = {{utki::make_span(buf)}};
+	std::array<setka::udp_socket::datagram_info, 1> infos;
+	for(unsigned i = 0; i < 30 && recv_sock.receive_batch(bufs, infos) == 0; ++i){
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(infos[0].dropped == num_sent - num_received, [&](auto&o){
+		o << "dropped = " << infos[0].dropped << ", sent = " << num_sent << ", received = " << num_received;
+	}, SL);
+	utki::assert_always(recv_stats.dropped == infos[0].dropped, SL);
+#endif
+
+	recv_sock.reset_statistics();
+	utki::assert_always(recv_stats.datagrams_received == 0, SL);
+	utki::assert_always(recv_stats.bytes_received == 0, SL);
+}
+}
+
+namespace test_udp_receive_group{
+void run(){
+#if CFG_OS == CFG_OS_LINUX || CFG_OS == CFG_OS_MACOSX
+	for(bool steer_by_cpu : {false, true}){
+#	if CFG_OS != CFG_OS_LINUX
+		if(steer_by_cpu){
+			continue;
+		}
+#	endif
+		uint16_t port = steer_by_cpu ? 13675 : 13674;
+
+		setka::udp_receive_group group(port, 4, steer_by_cpu);
+		utki::assert_always(group.size() == 4, SL);
+
+		constexpr size_t num_senders = 20;
+		constexpr size_t num_datagrams_per_sender = 5;
+
+		std::vector<setka::udp_socket> senders;
+		for(size_t i = 0; i != num_senders; ++i){
+			senders.emplace_back(0);
+		}
+
+		for(size_t j = 0; j != num_datagrams_per_sender; ++j){
+			for(size_t i = 0; i != num_senders; ++i){
+				std::array<uint8_t, 1> data = {{uint8_t(i)}};
+				utki::assert_always(senders[i].send(data, setka::address("127.0.0.1", port)) == data.size(), SL);
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		// index of the group socket which has received the datagrams of each sender
+		std::vector<size_t> receiver_of_sender(num_senders, group.size());
+
+		size_t num_received = 0;
+		for(size_t k = 0; k != group.size(); ++k){
+			std::array<uint8_t, 4> buf{};
+			setka::address sender;
+			while(group[k].recieve(buf, sender) != 0){
+				size_t i = buf[0];
+				utki::assert_always(i < num_senders, SL);
+				utki::assert_always(sender.port == senders[i].get_local_port(), SL);
+
+				// datagrams of one flow always go to the same socket when steering by hash,
+				// when steering by CPU the sending thread could migrate between CPUs
+				if(!steer_by_cpu){
+					utki::assert_always(receiver_of_sender[i] == group.size() || receiver_of_sender[i] == k, SL);
+				}
+				receiver_of_sender[i] = k;
+				++num_received;
+			}
+		}
+		utki::assert_always(num_received == num_senders * num_datagrams_per_sender, SL);
+	}
+#endif
+}
+}
+
+namespace test_packet_capture_socket{
+void run(){
+#if CFG_OS == CFG_OS_LINUX
+	unsigned loopback_index = if_nametoindex("lo");
+	utki::assert_always(loopback_index != 0, SL);
+
+	std::unique_ptr<setka::packet_capture_socket> capture_sock;
+	try{
+		capture_sock = std::make_unique<setka::packet_capture_socket>(loopback_index, utki::kilobyte * 64, 4);
+	}catch(std::system_error& e){
+		if(e.code().value() == EPERM){
+			utki::log([&](auto&o){o << "test_packet_capture_socket: no CAP_NET_RAW capability, skip the test" << std::endl;});
+			return;
+		}
+		throw;
+	}
+
+	setka::udp_socket recv_sock(13676);
+	setka::udp_socket send_sock(0);
+
+	std::array<uint8_t, 16> data = {{'s', 'e', 't', 'k', 'a', ' ', 'c', 'a', 'p', 't', 'u', 'r', 'e', ' ', 'm', 'e'}};
+	utki::assert_always(send_sock.send(data, setka::address("127.0.0.1", 13676)) == data.size(), SL);
+
+	opros::wait_set ws(1);
+	ws.add(*capture_sock, utki::make_flags({opros::ready::read}), capture_sock.get());
+
+	bool found = false;
+	for(unsigned i = 0; i != 30 && !found; ++i){
+		ws.wait(100);
+
+		for(auto block = capture_sock->get_block(); !block.empty(); block = capture_sock->get_block()){
+			for(const auto& f : block){
+				utki::assert_always(f.data.size() <= f.original_size, SL);
+				if(std::search(f.data.begin(), f.data.end(), data.begin(), data.end()) != f.data.end()){
+					found = true;
+				}
+			}
+		}
+	}
+	capture_sock->release_block();
+
+	ws.remove(*capture_sock);
+
+	utki::assert_always(found, SL);
+#endif
+}
+}
+
+namespace test_udp_socket_fanout{
+void run(){
+	constexpr size_t num_receivers = 100;
+
+	std::vector<setka::udp_socket> recv_socks;
+	std::vector<setka::address> destinations;
+	for(size_t i = 0; i != num_receivers; ++i){
+		auto port = uint16_t(13700 + i);
+		recv_socks.emplace_back(port);
+		destinations.emplace_back("127.0.0.1", port);
+	}
+
+	setka::udp_socket send_sock(0);
+
+	std::array<uint8_t, 4> data = {{'a', 'b', 'c', 'd'}};
+
+	size_t num_sent = 0;
+	for(unsigned i = 0; i < 10 && num_sent != num_receivers; ++i){
+		num_sent += send_sock.send_fanout(data, utki::make_span(destinations).subspan(num_sent));
+	}
+	utki::assert_always(num_sent == num_receivers, SL);
+	utki::assert_always(send_sock.get_statistics().datagrams_sent == num_receivers, SL);
+
+	for(auto& s : recv_socks){
+		std::array<uint8_t, 8> buf{};
+		setka::address sender;
+		size_t num_received = 0;
+		for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+			num_received = s.recieve(buf, sender);
+			if(num_received == 0){
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		utki::assert_always(num_received == data.size(), SL);
+		utki::assert_always(std::equal(data.begin(), data.end(), buf.begin()), SL);
+		utki::assert_always(sender.port == send_sock.get_local_port(), SL);
+	}
+}
+}
+
+namespace test_udp_socket_path_mtu{
+void run(){
+	setka::udp_socket recv_sock(13677);
+	setka::udp_socket send_sock(0);
+
+	std::vector<uint8_t> data(0x10000);
+
+	// datagram bigger than maximum UDP datagram size
+	utki::assert_always(
+			send_sock.try_send(data, setka::address("127.0.0.1", 13677)) == setka::udp_socket::send_status::message_too_large,
+			SL
+		);
+
+	bool thrown = false;
+	try{
+		send_sock.send(data, setka::address("127.0.0.1", 13677));
+	}catch(std::system_error&){
+		thrown = true;
+	}
+	utki::assert_always(thrown, SL);
+
+#if CFG_OS == CFG_OS_LINUX
+	send_sock.set_path_mtu_discovery(setka::udp_socket::path_mtu_discovery::on);
+	send_sock.connect(setka::address("127.0.0.1", 13677));
+
+	auto mtu = send_sock.get_path_mtu();
+	auto max_size = send_sock.get_max_datagram_size();
+	utki::assert_always(mtu != 0, SL);
+	utki::assert_always(max_size <= mtu - 28, SL);
+
+	utki::assert_always(
+			send_sock.try_send(utki::make_span(data).subspan(0, max_size)) == setka::udp_socket::send_status::sent,
+			SL
+		);
+	utki::assert_always(
+			send_sock.try_send(utki::make_span(data).subspan(0, max_size + 1)) == setka::udp_socket::send_status::message_too_large,
+			SL
+		);
+
+	std::vector<uint8_t> buf(data.size());
+	size_t num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received == 0; ++i){
+		num_received = recv_sock.recieve(buf);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	utki::assert_always(num_received == max_size, SL);
+#endif
+}
+}
+
+namespace test_reliable_connection{
+std::vector<uint8_t> make_message(uint16_t stream, size_t index){
+	std::vector<uint8_t> ret((index * 373 + stream * 101) % 3000 + 1); // NOLINT
+	for(size_t i = 0; i != ret.size(); ++i){
+		ret[i] = uint8_t(i + index + stream);
+	}
+	return ret;
+}
+
+// proxy between client and server which drops, duplicates and reorders datagrams
+class lossy_proxy{
+	uint16_t server_port;
+	unsigned loss_percent;
+	setka::address client_address;
+	std::mt19937 rng;
+	std::vector<std::pair<std::vector<uint8_t>, setka::address>> held;
+	std::vector<uint8_t> buf = std::vector<uint8_t>(0x10000);
+
+public:
+	setka::udp_socket socket;
+
+	// datagrams for which the filter returns true are dropped
+	std::function<bool(utki::span<const uint8_t>)> filter;
+
+	lossy_proxy(uint16_t port, uint16_t server_port, unsigned seed, unsigned loss_percent = 10) : // NOLINT
+			server_port(server_port),
+			loss_percent(loss_percent),
+			rng(seed),
+			socket(port)
+	{}
+
+	void forward(){
+		while(true){
+			setka::address sender;
+			size_t len = this->socket.recieve(this->buf, sender);
+			if(len == 0){
+				break;
+			}
+
+			setka::address dest;
+			if(sender.port == this->server_port){
+				dest = this->client_address;
+			}else{
+				this->client_address = sender;
+				dest = setka::address("127.0.0.1", this->server_port);
+			}
+
+			std::vector<uint8_t> datagram(this->buf.begin(), std::next(this->buf.begin(), len));
+
+			if(this->filter && this->filter(datagram)){
+				continue;
+			}
+
+			auto dice = this->rng() % 100; // NOLINT
+			if(dice < this->loss_percent){
+				// drop
+				continue;
+			}else if(dice < 2 * this->loss_percent){
+				// deliver after the next datagram
+				this->held.emplace_back(std::move(datagram), dest);
+				continue;
+			}
+
+			this->socket.send(datagram, dest);
+			if(dice < 2 * this->loss_percent + this->loss_percent / 2){
+				this->socket.send(datagram, dest);
+			}
+
+			for(const auto& h : this->held){
+				this->socket.send(h.first, h.second);
+			}
+			this->held.clear();
+		}
+	}
+};
+
+void run(){
+	constexpr size_t max_payload_size = 500;
+	constexpr size_t num_client_messages = 60;
+	constexpr size_t num_server_messages = 30;
+	const std::array<uint16_t, 3> client_streams = {{0, 1, 5}};
+	constexpr uint16_t server_stream = 7;
+
+	setka::reliable_connection server(setka::udp_socket(13680), max_payload_size);
+
+	lossy_proxy proxy(13681, 13680, 13681); // NOLINT
+
+	setka::reliable_connection client(setka::udp_socket(0), setka::address("127.0.0.1", 13681), max_payload_size);
+
+	for(size_t i = 0; i != num_client_messages; ++i){
+		for(auto s : client_streams){
+			client.send(s, make_message(s, i));
+		}
+	}
+	for(size_t i = 0; i != num_server_messages; ++i){
+		server.send(server_stream, make_message(server_stream, i));
+	}
+
+	std::map<uint16_t, size_t> num_received_by_server;
+	size_t num_received_by_client = 0;
+
+	opros::wait_set ws(3);
+	ws.add(client.get_socket(), utki::make_flags({opros::ready::read}), &client);
+	ws.add(server.get_socket(), utki::make_flags({opros::ready::read}), &server);
+	ws.add(proxy.socket, utki::make_flags({opros::ready::read}), &proxy);
+
+	uint32_t start_time = utki::get_ticks_ms();
+	while(true){
+		utki::assert_always(utki::get_ticks_ms() - start_time < 20000, SL);
+		utki::assert_always(client.get_state() != setka::reliable_connection::state::failed, SL);
+		utki::assert_always(server.get_state() != setka::reliable_connection::state::failed, SL);
+
+		bool all_received = num_received_by_client == num_server_messages;
+		for(auto s : client_streams){
+			all_received = all_received && num_received_by_server[s] == num_client_messages;
+		}
+		if(all_received && client.is_send_complete() && server.is_send_complete()){
+			break;
+		}
+
+		ws.wait(std::min(std::min(client.get_timeout_ms(), server.get_timeout_ms()), uint32_t(100)));
+
+		proxy.forward();
+
+		client.update();
+		server.update();
+
+		while(auto m = server.receive()){
+			auto& n = num_received_by_server[m->stream];
+			utki::assert_always(m->data == make_message(m->stream, n), SL);
+			++n;
+		}
+		while(auto m = client.receive()){
+			utki::assert_always(m->stream == server_stream, SL);
+			utki::assert_always(m->data == make_message(m->stream, num_received_by_client), SL);
+			++num_received_by_client;
+		}
+	}
+
+	utki::assert_always(client.get_statistics().packets_retransmitted != 0, SL);
+	utki::assert_always(server.get_statistics().packets_retransmitted != 0, SL);
+	utki::assert_always(server.get_statistics().duplicate_packets_received != 0, SL);
+
+	// the first close notification is lost, while the server has no data in flight to detect the loss of the client,
+	// the notification is repeated until the server acknowledges it
+	bool close_dropped = false;
+	proxy.filter = [&close_dropped](utki::span<const uint8_t> datagram){
+		constexpr uint8_t close_packet_type = 5;
+		if(close_dropped || datagram.empty() || datagram[0] != close_packet_type){
+			return false;
+		}
+		close_dropped = true;
+		return true;
+	};
+
+	client.close();
+	utki::assert_always(client.get_state() == setka::reliable_connection::state::closed, SL);
+
+	// the client stops repeating the notification once it is acknowledged
+	start_time = utki::get_ticks_ms();
+	while(
+		server.get_state() != setka::reliable_connection::state::closed ||
+		client.get_timeout_ms() != setka::reliable_connection::default_idle_timeout_ms
+	){
+		utki::assert_always(utki::get_ticks_ms() - start_time < 5000, SL);
+		utki::assert_always(server.get_state() != setka::reliable_connection::state::failed, SL);
+
+		ws.wait(std::min(std::min(client.get_timeout_ms(), server.get_timeout_ms()), uint32_t(100)));
+
+		proxy.forward();
+
+		client.update();
+		server.update();
+	}
+	utki::assert_always(close_dropped, SL);
+	utki::assert_always(client.get_state() == setka::reliable_connection::state::closed, SL);
+
+	ws.remove(proxy.socket);
+	ws.remove(server.get_socket());
+	ws.remove(client.get_socket());
+
+	// small receive window, messages of up to the window size fragments
+	for(unsigned seed = 0; seed != 3; ++seed){
+		constexpr size_t small_payload_size = 100;
+		constexpr size_t small_window = 4;
+		constexpr size_t num_messages = 200;
+
+		setka::reliable_connection small_server(setka::udp_socket(13686), small_payload_size, small_window);
+
+		// first run is over lossless link, but the first transmissions of the first data packet are dropped,
+		// so that the receive buffer gets filled with fragments of messages which cannot be delivered before it,
+		// other runs are over lossy link
+		lossy_proxy small_proxy(13687, 13686, seed, seed == 0 ? 0 : 10); // NOLINT
+		if(seed == 0){
+			small_proxy.filter = [num_drops = 0](utki::span<const uint8_t> datagram) mutable {
+				constexpr size_t packet_number_offset = 5;
+				constexpr uint8_t data_packet_type = 3;
+
+				// packet numbers start at the connection id
+				if(datagram.size() <= packet_number_offset + 4 || datagram[0] != data_packet_type ||
+						utki::deserialize32be(&datagram[packet_number_offset]) != utki::deserialize32be(&datagram[1]))
+				{
+					return false;
+				}
+				return num_drops++ < 2;
+			};
+		}
+
+		setka::reliable_connection small_client(
+				setka::udp_socket(0),
+				setka::address("127.0.0.1", 13687),
+				small_payload_size,
+				small_window
+			);
+
+		// message which can never fit the receive window
+		bool thrown = false;
+		try{
+			small_client.send(0, std::vector<uint8_t>(small_payload_size * small_window + 1));
+		}catch(std::invalid_argument&){
+			thrown = true;
+		}
+		utki::assert_always(thrown, SL);
+
+		// messages are sent over 2 streams alternately, first messages are of 3 fragments,
+		// so that the receive buffer gets filled with incomplete messages
+		auto make_small_message = [](size_t index){
+			size_t size = index < 4 ? small_payload_size * 3 : (index * 137) % (small_payload_size * small_window) + 1; // NOLINT
+			std::vector<uint8_t> ret(size);
+			for(size_t i = 0; i != ret.size(); ++i){
+				ret[i] = uint8_t(i + index);
+			}
+			return ret;
+		};
+
+		for(size_t i = 0; i != num_messages; ++i){
+			small_client.send(uint16_t(i % 2), make_small_message(i));
+		}
+
+		size_t num_received = 0;
+		std::array<size_t, 2> num_received_per_stream{};
+
+		opros::wait_set small_ws(3);
+		small_ws.add(small_client.get_socket(), utki::make_flags({opros::ready::read}), &small_client);
+		small_ws.add(small_server.get_socket(), utki::make_flags({opros::ready::read}), &small_server);
+		small_ws.add(small_proxy.socket, utki::make_flags({opros::ready::read}), &small_proxy);
+
+		start_time = utki::get_ticks_ms();
+		while(num_received != num_messages || !small_client.is_send_complete()){
+			utki::assert_always(
+					utki::get_ticks_ms() - start_time < 20000,
+					[&](auto&o){o << "seed = " << seed << ", num_received = " << num_received;},
+					SL
+				);
+			utki::assert_always(small_client.get_state() != setka::reliable_connection::state::failed, SL);
+
+			small_ws.wait(std::min(std::min(small_client.get_timeout_ms(), small_server.get_timeout_ms()), uint32_t(100)));
+
+			small_proxy.forward();
+
+			small_client.update();
+			small_server.update();
+
+			while(auto m = small_server.receive()){
+				utki::assert_always(m->stream < num_received_per_stream.size(), SL);
+				auto& n = num_received_per_stream[m->stream];
+				utki::assert_always(m->data == make_small_message(n * 2 + m->stream), SL);
+				++n;
+				++num_received;
+			}
+		}
+
+		small_ws.remove(small_proxy.socket);
+		small_ws.remove(small_server.get_socket());
+		small_ws.remove(small_client.get_socket());
+	}
+
+	// packet and message numbers start at the connection id, the client is simulated with a raw socket to use
+	// the connection id close to 2^32, so that the numbers wrap around on the wire
+	{
+		constexpr uint32_t id = std::numeric_limits<uint32_t>::max() - 100;
+		constexpr size_t num_messages = 300;
+		constexpr uint8_t syn_type = 1;
+		constexpr uint8_t data_type = 3;
+		constexpr uint8_t ack_type = 4;
+		constexpr size_t data_header_size = 19;
+		constexpr size_t ack_header_size = 14;
+		constexpr size_t ack_range_size = 8;
+
+		setka::reliable_connection wrap_server(setka::udp_socket(13690), 100); // NOLINT
+
+		setka::udp_socket peer(0);
+		setka::address server_address("127.0.0.1", 13690);
+
+		auto make_data = [](
+				uint32_t packet_number,
+				uint32_t message_number,
+				uint16_t index,
+				uint16_t count,
+				utki::span<const uint8_t> payload
+			){
+			std::vector<uint8_t> ret(data_header_size + payload.size());
+			ret[0] = data_type;
+			utki::serialize32be(id, &ret[1]);
+			utki::serialize32be(packet_number, &ret[5]);
+			utki::serialize16be(0, &ret[9]);
+			utki::serialize32be(message_number, &ret[11]);
+			utki::serialize16be(index, &ret[15]);
+			utki::serialize16be(count, &ret[17]);
+			std::copy(payload.begin(), payload.end(), std::next(ret.begin(), data_header_size));
+			return ret;
+		};
+
+		auto make_wrap_message = [](size_t index){
+			return std::vector<uint8_t>(index % 50 + 1, uint8_t(index)); // NOLINT
+		};
+
+		// messages of 1 and 2 fragments from the client
+		std::vector<std::vector<uint8_t>> packets;
+		for(size_t i = 0; i != num_messages; ++i){
+			auto msg = make_wrap_message(i);
+			uint16_t count = uint16_t(1 + i % 2);
+			for(uint16_t f = 0; f != count; ++f){
+				auto half = msg.size() / 2;
+				auto payload = count == 1 ? utki::make_span(msg)
+						: f == 0 ? utki::make_span(msg).subspan(0, half) : utki::make_span(msg).subspan(half);
+				packets.push_back(make_data(uint32_t(id + packets.size()), uint32_t(id + i), f, count, payload));
+			}
+		}
+
+		std::vector<bool> acked(packets.size(), false);
+		auto ack_range = [&](uint32_t start, uint32_t end){
+			for(uint32_t i = start - id; i != uint32_t(end - id) && i < acked.size(); ++i){
+				acked[i] = true;
+			}
+		};
+
+		opros::wait_set wrap_ws(2);
+		wrap_ws.add(wrap_server.get_socket(), utki::make_flags({opros::ready::read}), &wrap_server);
+		wrap_ws.add(peer, utki::make_flags({opros::ready::read}), &peer);
+
+		std::vector<uint8_t> buf(0x10000);
+
+		std::array<uint8_t, 5> syn{{syn_type}};
+		utki::serialize32be(id, &syn[1]);
+		peer.send(syn, server_address);
+
+		size_t num_received = 0;
+		uint32_t last_send_time = 0;
+		start_time = utki::get_ticks_ms();
+		while(num_received != num_messages || std::find(acked.begin(), acked.end(), false) != acked.end()){
+			utki::assert_always(
+					utki::get_ticks_ms() - start_time < 20000,
+					[&](auto&o){o << "num_received = " << num_received;},
+					SL
+				);
+			utki::assert_always(wrap_server.get_state() != setka::reliable_connection::state::failed, SL);
+
+			// send unacknowledged packets periodically, reversing the order within groups of 7,
+			// every 10th packet is duplicated
+			if(utki::get_ticks_ms() - last_send_time >= 50){
+				last_send_time = utki::get_ticks_ms();
+				constexpr size_t group_size = 7;
+				for(size_t g = 0; g < packets.size(); g += group_size){
+					for(size_t i = std::min(g + group_size, packets.size()); i != g; --i){
+						if(acked[i - 1]){
+							continue;
+						}
+						peer.send(packets[i - 1], server_address);
+						if((i - 1) % 10 == 0){
+							peer.send(packets[i - 1], server_address);
+						}
+					}
+				}
+			}
+
+			wrap_ws.wait(std::min(wrap_server.get_timeout_ms(), uint32_t(50)));
+
+			wrap_server.update();
+
+			while(auto m = wrap_server.receive()){
+				utki::assert_always(m->stream == 0, SL);
+				utki::assert_always(m->data == make_wrap_message(num_received), SL);
+				++num_received;
+			}
+
+			while(size_t len = peer.recieve(buf)){
+				if(len < ack_header_size || buf[0] != ack_type){
+					continue;
+				}
+				ack_range(id, utki::deserialize32be(&buf[5]));
+				for(size_t r = 0; r != buf[13] && ack_header_size + (r + 1) * ack_range_size <= len; ++r){
+					ack_range(
+							utki::deserialize32be(&buf[ack_header_size + r * ack_range_size]),
+							utki::deserialize32be(&buf[ack_header_size + r * ack_range_size + 4])
+						);
+				}
+			}
+		}
+
+		utki::assert_always(wrap_server.get_statistics().duplicate_packets_received != 0, SL);
+
+		// messages from the server, first transmissions of several packets around the wrap are dropped
+		for(size_t i = 0; i != num_messages; ++i){
+			wrap_server.send(0, make_wrap_message(i));
+		}
+
+		std::vector<std::optional<std::vector<uint8_t>>> received(num_messages);
+		std::set<size_t> drops = {99, 100, 101, 150};
+
+		start_time = utki::get_ticks_ms();
+		auto first_missing = [&](){
+			return size_t(std::distance(received.begin(), std::find(received.begin(), received.end(), std::nullopt)));
+		};
+
+		while(first_missing() != received.size() || !wrap_server.is_send_complete()){
+			utki::assert_always(utki::get_ticks_ms() - start_time < 20000, SL);
+			utki::assert_always(wrap_server.get_state() != setka::reliable_connection::state::failed, SL);
+
+			wrap_ws.wait(std::min(wrap_server.get_timeout_ms(), uint32_t(50)));
+
+			wrap_server.update();
+
+			bool ack_needed = false;
+			while(size_t len = peer.recieve(buf)){
+				if(len < data_header_size || buf[0] != data_type){
+					continue;
+				}
+				ack_needed = true;
+
+				uint32_t index = utki::deserialize32be(&buf[5]) - id;
+				utki::assert_always(index < num_messages, [&](auto&o){o << "index = " << index;}, SL);
+
+				// one fragment messages are sent one per packet
+				utki::assert_always(utki::deserialize32be(&buf[11]) - id == index, SL);
+				utki::assert_always(utki::deserialize16be(&buf[17]) == 1, SL);
+
+				if(drops.erase(index) != 0){
+					continue;
+				}
+				received[index] =
+						std::vector<uint8_t>(std::next(buf.begin(), data_header_size), std::next(buf.begin(), len));
+			}
+
+			if(!ack_needed){
+				continue;
+			}
+
+			std::vector<uint8_t> ack(ack_header_size);
+			ack[0] = ack_type;
+			utki::serialize32be(id, &ack[1]);
+			size_t cumulative = first_missing();
+			utki::serialize32be(uint32_t(id + cumulative), &ack[5]);
+			utki::serialize32be(uint32_t(setka::reliable_connection::default_receive_window), &ack[9]);
+			for(size_t i = cumulative; i != received.size();){
+				if(!received[i]){
+					++i;
+					continue;
+				}
+				size_t end = i;
+				for(; end != received.size() && received[end]; ++end){}
+				std::array<uint8_t, ack_range_size> range{};
+				utki::serialize32be(uint32_t(id + i), &range[0]);
+				utki::serialize32be(uint32_t(id + end), &range[4]);
+				ack.insert(ack.end(), range.begin(), range.end());
+				++ack[13];
+				i = end;
+			}
+			peer.send(ack, server_address);
+		}
+
+		for(size_t i = 0; i != num_messages; ++i){
+			utki::assert_always(received[i] == make_wrap_message(i), SL);
+		}
+		utki::assert_always(wrap_server.get_statistics().packets_retransmitted != 0, SL);
+
+		wrap_ws.remove(peer);
+		wrap_ws.remove(wrap_server.get_socket());
+	}
+}
+}
+
+namespace test_paced_udp_sender{
+void run(){
+	constexpr size_t num_datagrams = 20;
+	constexpr size_t datagram_size = 1000;
+
+	for(auto method : {setka::paced_udp_sender::pacing::user_space, setka::paced_udp_sender::pacing::kernel}){
+		setka::udp_socket recv_sock(13682);
+
+		// 100 kB/s, so that each datagram takes 10 ms
+		setka::paced_udp_sender sender(setka::udp_socket(0), 100000, 0, method); // NOLINT
+
+#if CFG_OS != CFG_OS_LINUX
+		utki::assert_always(sender.get_pacing() == setka::paced_udp_sender::pacing::user_space, SL);
+#endif
+
+		utki::assert_always(sender.get_timeout_ms() == std::numeric_limits<uint32_t>::max(), SL);
+
+		std::vector<uint8_t> data(datagram_size);
+		for(size_t i = 0; i != num_datagrams; ++i){
+			data[0] = uint8_t(i);
+			sender.send(data, setka::address("127.0.0.1", 13682));
+		}
+		utki::assert_always(sender.get_queue_size() == num_datagrams, SL);
+
+		uint32_t start_time = utki::get_ticks_ms();
+
+		sender.update();
+		if(method == setka::paced_udp_sender::pacing::user_space){
+			// only the first datagram is sent right away
+			utki::assert_always(sender.get_queue_size() == num_datagrams - 1, SL);
+			utki::assert_always(sender.get_timeout_ms() != 0, SL);
+		}
+
+		std::vector<uint8_t> buf(datagram_size);
+		size_t num_received = 0;
+		while(num_received != num_datagrams){
+			utki::assert_always(utki::get_ticks_ms() - start_time < 5000, SL);
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(std::min(sender.get_timeout_ms(), uint32_t(5))));
+			sender.update();
+
+			while(recv_sock.recieve(buf) == datagram_size){
+				utki::assert_always(buf[0] == num_received, SL);
+				++num_received;
+			}
+		}
+		utki::assert_always(sender.is_send_complete(), SL);
+
+		if(method == setka::paced_udp_sender::pacing::user_space){
+			utki::assert_always(utki::get_ticks_ms() - start_time >= (num_datagrams - 1) * 10, SL);
+		}
+	}
+
+	// maximum burst size at the lowest rate
+	{
+		setka::paced_udp_sender sender(setka::udp_socket(0), 1, setka::paced_udp_sender::max_burst_size);
+		sender.update();
+		utki::assert_always(sender.is_send_complete(), SL);
+	}
+
+	// too big burst size
+	if(sizeof(size_t) > sizeof(uint32_t)){
+		bool thrown = false;
+		try{
+			setka::paced_udp_sender sender(setka::udp_socket(0), 1, setka::paced_udp_sender::max_burst_size + 1);
+		}catch(std::invalid_argument&){
+			thrown = true;
+		}
+		utki::assert_always(thrown, SL);
+	}
+}
+}
+
+namespace test_datagram_pool{
+void run(){
+	constexpr size_t num_buffers = 8;
+	constexpr size_t buffer_size = 100;
+	constexpr size_t num_datagrams = 6;
+
+	setka::udp_socket recv_sock(13683);
+	recv_sock.set_timestamping(true);
+	setka::udp_socket send_sock(0);
+
+	setka::datagram_pool pool(num_buffers, buffer_size);
+
+	utki::assert_always(pool.receive(recv_sock).empty(), SL);
+
+	// last datagram does not fit the buffer
+	for(size_t i = 0; i != num_datagrams; ++i){
+		std::vector<uint8_t> data(i == num_datagrams - 1 ? buffer_size + 50 : i + 1, uint8_t(i));
+		utki::assert_always(send_sock.send(data, setka::address("127.0.0.1", 13683)) == data.size(), SL);
+	}
+
+	std::array<setka::pooled_datagram, num_datagrams> datagrams;
+	size_t num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received != num_datagrams; ++i){
+		num_received += pool.receive(recv_sock, utki::make_span(datagrams).subspan(num_received));
+		if(num_received != num_datagrams){
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	utki::assert_always(num_received == num_datagrams, SL);
+
+	for(size_t i = 0; i != num_datagrams; ++i){
+		const auto& d = datagrams[i];
+		utki::assert_always(!d.empty(), SL);
+		utki::assert_always(d.get_info().sender.port == send_sock.get_local_port(), SL);
+		for(auto b : d.data()){
+			utki::assert_always(b == i, SL);
+		}
+		if(i == num_datagrams - 1){
+			utki::assert_always(d.data().size() == buffer_size, SL);
+#if CFG_OS == CFG_OS_LINUX
+			utki::assert_always(d.get_info().truncated, SL);
+			utki::assert_always(d.get_info().original_size == buffer_size + 50, SL);
+#endif
+		}else{
+			utki::assert_always(d.data().size() == i + 1, SL);
+			utki::assert_always(!d.get_info().truncated, SL);
+		}
+#if CFG_OS == CFG_OS_LINUX
+		utki::assert_always(d.get_info().timestamp_ns != 0, SL);
+#endif
+	}
+
+	// hand the datagrams over to a worker thread, which releases them back to the pool
+	setka::mpmc_queue<setka::pooled_datagram> queue(num_buffers);
+	std::atomic<size_t> num_processed{0};
+	std::thread worker([&](){
+		while(num_processed != num_datagrams){
+			if(auto d = queue.pop()){
+				d->release();
+				++num_processed;
+			}else{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	for(auto& d : datagrams){
+		utki::assert_always(queue.push(std::move(d)), SL);
+		utki::assert_always(d.empty(), SL);
+	}
+
+	worker.join();
+	utki::assert_always(!queue.pop(), SL);
+
+	// all buffers are back in the pool, so that it can be exhausted again
+	for(size_t i = 0; i != num_buffers + 1; ++i){
+		std::array<uint8_t, 1> data = {{uint8_t(i)}};
+		utki::assert_always(send_sock.send(data, setka::address("127.0.0.1", 13683)) == data.size(), SL);
+	}
+
+	std::vector<setka::pooled_datagram> held(num_buffers + 1);
+	num_received = 0;
+	for(unsigned i = 0; i < 30 && num_received != num_buffers; ++i){
+		num_received += pool.receive(recv_sock, utki::make_span(held).subspan(num_received));
+		if(num_received != num_buffers){
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	utki::assert_always(num_received == num_buffers, SL);
+	utki::assert_always(held.back().empty(), SL);
+
+	// pool is exhausted, the datagram stays in the socket
+	utki::assert_always(pool.receive(recv_sock).empty(), SL);
+
+	held.front().release();
+	auto d = pool.receive(recv_sock);
+	utki::assert_always(!d.empty(), SL);
+	utki::assert_always(d.data().size() == 1 && d.data()[0] == num_buffers, SL);
+}
+}
+
+
+
+namespace test_endpoint{
+void run(){
+	// round trip address -> endpoint -> address
+	{
+		setka::address a("127.0.0.1", 1234);
+		setka::endpoint e(a);
+		utki::assert_always(e.get_family() == AF_INET, SL);
+		utki::assert_always(e.get_port() == 1234, SL);
+		utki::assert_always(e.to_address() == a, SL);
+
+		auto m = e.to_v6_mapped();
+		utki::assert_always(m.get_family() == AF_INET6, SL);
+		utki::assert_always(m.to_address() == a, SL);
+	}
+	{
+		setka::address a("[1:2:3:4:5:6:7:8]:4321");
+		setka::endpoint e(a);
+		utki::assert_always(e.get_family() == AF_INET6, SL);
+		utki::assert_always(e.get_port() == 4321, SL);
+		utki::assert_always(e.to_address() == a, SL);
+		utki::assert_always(e == setka::endpoint(a), SL);
+		utki::assert_always(e != setka::endpoint(), SL);
+	}
+	{
+		setka::endpoint e;
+		utki::assert_always(e.empty(), SL);
+		bool thrown = false;
+		try{
+			e.to_address();
+		}catch(std::logic_error&){
+			thrown = true;
+		}
+		utki::assert_always(thrown, SL);
+	}
+
+	// UDP send and receive with endpoints
+	{
+		setka::udp_socket recv_sock(setka::endpoint(setka::address("127.0.0.1", 13684)));
+		setka::udp_socket send_sock(0);
+
+		std::array<setka::endpoint, 3> destinations;
+		destinations.fill(setka::endpoint(setka::address("127.0.0.1", 13684)));
+
+		std::array<uint8_t, 4> data = {'a', 'b', 'c', 'd'};
+		utki::assert_always(send_sock.send(data, destinations.front()) == data.size(), SL);
+		utki::assert_always(send_sock.send_fanout(data, destinations) == destinations.size(), SL);
+
+		std::array<uint8_t, 16> buf{};
+		for(unsigned num_received = 0, num_tries = 0; num_received != destinations.size() + 1; ++num_tries){
+			utki::assert_always(num_tries < 200, SL);
+			setka::endpoint sender;
+			auto size = recv_sock.recieve(buf, sender);
+			if(size == 0){
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+			utki::assert_always(size == data.size(), SL);
+			utki::assert_always(std::equal(data.begin(), data.end(), buf.begin()), SL);
+			utki::assert_always(sender.to_address().host.get_v4() == 0x7f000001, SL);
+			utki::assert_always(sender.get_port() == send_sock.get_local_port(), SL);
+			++num_received;
+		}
+
+		// batch and segmented sends, batch receive
+		std::array<utki::span<const uint8_t>, 2> send_bufs = {utki::make_span(data), utki::make_span(data)};
+		utki::assert_always(send_sock.send_batch(send_bufs, utki::make_span(destinations.data(), send_bufs.size())) == send_bufs.size(), SL);
+		std::array<uint8_t, 8> segmented_data = {'a', 'b', 'c', 'd', 'a', 'b', 'c', 'd'};
+		utki::assert_always(send_sock.send_segmented(segmented_data, data.size(), destinations.front()) == segmented_data.size(), SL);
+
+		std::array<std::array<uint8_t, 16>, 4> recv_bufs{};
+		std::array<utki::span<uint8_t>, recv_bufs.size()> recv_spans;
+		for(size_t i = 0; i != recv_bufs.size(); ++i){
+			recv_spans[i] = recv_bufs[i];
+		}
+		std::array<setka::udp_socket::datagram_info, recv_bufs.size()> infos;
+		std::array<setka::endpoint, recv_bufs.size()> senders;
+		for(size_t num_received = 0, num_tries = 0; num_received != recv_bufs.size(); ++num_tries){
+			utki::assert_always(num_tries < 200, SL);
+			auto n = recv_sock.receive_batch(
+				utki::make_span(recv_spans).subspan(num_received),
+				utki::make_span(infos).subspan(num_received),
+				utki::make_span(senders).subspan(num_received)
+			);
+			if(n == 0){
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+			num_received += n;
+		}
+		for(size_t i = 0; i != recv_bufs.size(); ++i){
+			utki::assert_always(infos[i].size == data.size(), SL);
+			utki::assert_always(std::equal(data.begin(), data.end(), recv_bufs[i].begin()), SL);
+			utki::assert_always(senders[i].get_port() == send_sock.get_local_port(), SL);
+		}
+	}
+
+	// IPv4 endpoint equals IPv4 mapped IPv6 endpoint
+	{
+		setka::endpoint e(setka::address("127.0.0.1", 1234));
+		auto m = e.to_v6_mapped();
+		utki::assert_always(m == e, SL);
+		utki::assert_always(e == m, SL);
+		utki::assert_always(m != setka::endpoint(setka::address("127.0.0.1", 1235)), SL);
+		utki::assert_always(m != setka::endpoint(setka::address("127.0.0.2", 1234)), SL);
+		utki::assert_always(m != setka::endpoint(), SL);
+		utki::assert_always(setka::endpoint(setka::address("[::1]:1234")) != e, SL);
+	}
+
+	// sender received by dual-stack socket equals endpoint created from its IPv4 address
+	{
+		setka::udp_socket recv_sock(13689);
+		setka::udp_socket send_sock(setka::endpoint(setka::address("127.0.0.1", 0)));
+
+		std::array<uint8_t, 4> data = {'a', 'b', 'c', 'd'};
+		utki::assert_always(send_sock.send(data, setka::endpoint(setka::address("127.0.0.1", 13689))) == data.size(), SL);
+
+		std::array<uint8_t, 16> buf{};
+		setka::endpoint sender;
+		for(unsigned num_tries = 0; recv_sock.recieve(buf, sender) == 0; ++num_tries){
+			utki::assert_always(num_tries < 200, SL);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		setka::endpoint expected(setka::address("127.0.0.1", send_sock.get_local_port()));
+		utki::assert_always(sender == expected, [&](auto&o){o << "sender family = " << sender.get_family();}, SL);
+	}
+
+	// TCP connect and listen with endpoints
+	{
+		setka::tcp_server_socket server_sock(setka::endpoint(setka::address("127.0.0.1", 13685)));
+		setka::tcp_socket client_sock(setka::endpoint(setka::address("127.0.0.1", 13685)));
+
+		setka::tcp_socket accepted_sock;
+		for(unsigned num_tries = 0; accepted_sock.is_empty(); ++num_tries){
+			utki::assert_always(num_tries < 200, SL);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			accepted_sock = server_sock.accept();
+		}
+
+		utki::assert_always(accepted_sock.get_remote_address().host.get_v4() == 0x7f000001, SL);
+		utki::assert_always(accepted_sock.get_local_address().port == 13685, SL);
+	}
+}
+}//~namespace
+
+
+
+namespace test_address_chars{
+std::string to_string(const setka::address& a){
+	std::array<char, setka::address::max_chars> buf{};
+	auto res = a.to_chars(buf.data(), buf.data() + buf.size());
+	utki::assert_always(res.ec == std::errc(), SL);
+	return std::string(buf.data(), res.ptr);
+}
+
+void run(){
+	// RFC 5952 canonical form
+	{
+		std::vector<std::pair<std::string_view, std::string_view>> samples = {
+			{"1.2.3.4", "1.2.3.4"},
+			{"255.255.255.255", "255.255.255.255"},
+			{"0:0:0:0:0:ffff:7f00:1", "127.0.0.1"},
+			{"::ffff:127.0.0.1", "127.0.0.1"},
+			{"2001:0DB8:0000:0000:0000:0000:0000:0001", "2001:db8::1"},
+			{"2001:db8:0:0:1:0:0:1", "2001:db8::1:0:0:1"},
+			{"2001:db8:0:1:1:1:1:1", "2001:db8:0:1:1:1:1:1"},
+			{"2001:0:0:1:0:0:0:1", "2001:0:0:1::1"},
+			{"1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8"},
+			{"::", "::"},
+			{"::1", "::1"},
+			{"1::", "1::"},
+			{"fe80::1:2", "fe80::1:2"},
+			{"::2:3:4:5:6:7:8", "0:2:3:4:5:6:7:8"},
+			{"64:ff9b::192.0.2.33", "64:ff9b::c000:221"},
+		};
+
+		for(const auto& s : samples){
+			auto ip = setka::address::ip::parse(s.first);
+			auto str = ip.to_string();
+			utki::assert_always(str == s.second, [&](auto&o){o << s.first << " -> " << str;}, SL);
+			utki::assert_always(setka::address::ip::parse(str) == ip, SL);
+		}
+	}
+
+	// malformed addresses
+	{
+		std::vector<std::string_view> samples = {
+			"",
+			"1.2.3",
+			"1.2.3.256",
+			"1.2.3.04",
+			"1.2.3.4.",
+			"1.2.3.4 ",
+			"1:2:3:4:5:6:7",
+			"1:2:3:4:5:6:7:8:9",
+			"1::2::3",
+			"12345::",
+			":1::",
+			"1:",
+			"1:2:3:4:5:6:7::8",
+			"::1.2.3",
+			"1:2:3:4:5:6:7:1.2.3.4",
+			"g::",
+		};
+
+		for(const auto& s : samples){
+			setka::address::ip ip(1);
+			auto res = setka::address::ip::from_chars(s.data(), s.data() + s.size(), ip);
+			bool error = res.ec != std::errc() || res.ptr != s.data() + s.size();
+			utki::assert_always(error, [&](auto&o){o << "'" << s << "'";}, SL);
+			if(res.ec != std::errc()){
+				utki::assert_always(res.ptr == s.data(), SL);
+				utki::assert_always(ip == setka::address::ip(1), SL);
+			}
+
+			bool thrown = false;
+			try{
+				setka::address::ip::parse(s);
+			}catch(std::runtime_error&){
+				thrown = true;
+			}
+			utki::assert_always(thrown, [&](auto&o){o << "'" << s << "'";}, SL);
+		}
+	}
+
+	// parsing stops at the end of the address
+	{
+		std::string_view str = "10.0.0.1,fe80::1 x";
+		setka::address::ip ip;
+		auto res = setka::address::ip::from_chars(str.data(), str.data() + str.size(), ip);
+		utki::assert_always(res.ec == std::errc(), SL);
+		utki::assert_always(ip == setka::address::ip(0x0a000001), SL);
+		utki::assert_always(*res.ptr == ',', SL);
+
+		res = setka::address::ip::from_chars(res.ptr + 1, str.data() + str.size(), ip);
+		utki::assert_always(res.ec == std::errc(), SL);
+		utki::assert_always(ip == setka::address::ip(0xfe800000, 0, 0, 1), SL);
+		utki::assert_always(*res.ptr == ' ', SL);
+	}
+
+	// addresses with port
+	{
+		std::vector<std::pair<std::string_view, setka::address>> samples = {
+			{"127.0.0.1:80", setka::address(127, 0, 0, 1, 80)},
+			{"127.0.0.1:", setka::address(127, 0, 0, 1, 0)},
+			{"127.0.0.1", setka::address(127, 0, 0, 1, 0)},
+			{"127.0.0.1:65535", setka::address(127, 0, 0, 1, 65535)},
+			{"127.0.0.1:00080", setka::address(127, 0, 0, 1, 80)},
+			{"[42f4:234a::23]:432", setka::address(setka::address::ip(0x42f4234a, 0, 0, 0x23), 432)},
+			{"[42f4:234a::23]", setka::address(setka::address::ip(0x42f4234a, 0, 0, 0x23), 0)},
+			{"42f4:234a::23", setka::address(setka::address::ip(0x42f4234a, 0, 0, 0x23), 0)},
+		};
+
+		for(const auto& s : samples){
+			setka::address a;
+			auto res = setka::address::from_chars(s.first.data(), s.first.data() + s.first.size(), a);
+			utki::assert_always(res.ec == std::errc(), [&](auto&o){o << s.first;}, SL);
+			utki::assert_always(res.ptr == s.first.data() + s.first.size(), [&](auto&o){o << s.first;}, SL);
+			utki::assert_always(a == s.second, [&](auto&o){o << s.first;}, SL);
+			utki::assert_always(setka::address(s.first) == s.second, [&](auto&o){o << s.first;}, SL);
+
+			// round trip
+			utki::assert_always(setka::address(to_string(a)) == a, [&](auto&o){o << s.first;}, SL);
+		}
+
+		utki::assert_always(to_string(setka::address(127, 0, 0, 1, 80)) == "127.0.0.1:80", SL);
+		utki::assert_always(to_string(setka::address("[::1]:65535")) == "[::1]:65535", SL);
+
+		// characters after the port number are ignored by the constructor
+		utki::assert_always(setka::address("127.0.0.1:80abc") == setka::address(127, 0, 0, 1, 80), SL);
+
+		for(std::string_view s : {"127.0.0.1:65536", "127.0.0.1:123456", "[::1]:99999"}){
+			setka::address a;
+			auto res = setka::address::from_chars(s.data(), s.data() + s.size(), a);
+			utki::assert_always(res.ec == std::errc::result_out_of_range, [&](auto&o){o << s;}, SL);
+			utki::assert_always(res.ptr == s.data() + s.size(), SL);
+		}
+
+		for(std::string_view s : {"", "127.0.0.1x", "[::1]x", "[::1", "::1:x", "127.0.0.1:65536", "127.0.0.1:123456"}){
+			bool thrown = false;
+			try{
+				setka::address a(s);
+			}catch(std::runtime_error&){
+				thrown = true;
+			}
+			utki::assert_always(thrown, [&](auto&o){o << "'" << s << "'";}, SL);
+		}
+	}
+
+	// buffer too small
+	{
+		setka::address a("[1234:5678:9abc:def0:1234:5678:9abc:def0]:65535");
+		std::array<char, setka::address::max_chars> buf{};
+		auto res = a.to_chars(buf.data(), buf.data() + buf.size());
+		utki::assert_always(res.ec == std::errc(), SL);
+		utki::assert_always(res.ptr == buf.data() + buf.size(), SL);
+
+		res = a.to_chars(buf.data(), buf.data() + buf.size() - 1);
+		utki::assert_always(res.ec == std::errc::value_too_large, SL);
+		utki::assert_always(res.ptr == buf.data() + buf.size() - 1, SL);
+
+		res = a.host.to_chars(buf.data(), buf.data() + setka::address::ip::max_chars);
+		utki::assert_always(res.ec == std::errc(), SL);
+		utki::assert_always(res.ptr == buf.data() + setka::address::ip::max_chars, SL);
+	}
+}
+}//~namespace
+
+
+
+namespace test_address_constexpr{
+using namespace setka::literals;
+
+constexpr auto server_address = "[2001:db8::1]:443"_addr;
+static_assert(server_address.port == 443, "");
+static_assert(server_address.host == setka::address::ip(0x20010db8, 0, 0, 1), "");
+
+constexpr auto local_address = "127.0.0.1:8080"_addr;
+static_assert(local_address == setka::address(127, 0, 0, 1, 8080), "");
+static_assert(local_address.host.is_v4(), "");
+static_assert(local_address.host.is_loopback(), "");
+static_assert(!local_address.host.is_private(), "");
+
+static_assert("::1"_ip.is_loopback(), "");
+static_assert("::"_ip.is_unspecified(), "");
+static_assert("0.0.0.0"_ip.is_unspecified(), "");
+static_assert(!"::"_ip.is_valid(), "");
+static_assert("10.1.2.3"_ip.is_private(), "");
+static_assert("172.31.255.255"_ip.is_private(), "");
+static_assert(!"172.32.0.0"_ip.is_private(), "");
+static_assert("192.168.0.1"_ip.is_private(), "");
+static_assert("fd00::1"_ip.is_private(), "");
+static_assert("224.0.0.251"_ip.is_multicast(), "");
+static_assert("ff02::fb"_ip.is_multicast(), "");
+static_assert(!"223.255.255.255"_ip.is_multicast(), "");
+static_assert("169.254.1.1"_ip.is_link_local(), "");
+static_assert("fe80::1"_ip.is_link_local(), "");
+static_assert("febf::1"_ip.is_link_local(), "");
+static_assert(!"fec0::1"_ip.is_link_local(), "");
+static_assert("::ffff:1.2.3.4"_ip == setka::address::ip(0x01020304), "");
+static_assert(setka::address::ip::parse_v6("1:2:3:4:5:6:7:8") == setka::address::ip(1, 2, 3, 4, 5, 6, 7, 8), "");
+
+// access control table constant-initialized at compile time
+constexpr std::array<setka::address::ip, 3> trusted_hosts = {
+	"10.0.0.1"_ip,
+	"10.0.0.2"_ip,
+	"2001:db8::7"_ip,
+};
+
+constexpr bool is_trusted(const setka::address::ip& h){
+	for(const auto& t : trusted_hosts){
+		if(t == h){
+			return true;
+		}
+	}
+	return false;
+}
+
+static_assert(is_trusted("2001:db8::7"_ip), "");
+static_assert(!is_trusted("10.0.0.3"_ip), "");
+
+constexpr bool from_chars_fails(std::string_view str){
+	setka::address a;
+	return setka::address::from_chars(str.data(), str.data() + str.size(), a).ec != std::errc();
+}
+
+static_assert(from_chars_fails("1.2.3"), "");
+static_assert(from_chars_fails("127.0.0.1:65536"), "");
+static_assert(!from_chars_fails("127.0.0.1:65535"), "");
+
+void run(){
+	// same parsing is available at run time
+	std::string str = "[2001:db8::1]:443";
+	utki::assert_always(setka::address(str) == server_address, SL);
+
+	bool thrown = false;
+	try{
+		auto a = "1.2.3.4:99999"_addr;
+		utki::assert_always(false, [&](auto&o){o << a.port;}, SL);
+	}catch(std::runtime_error&){
+		thrown = true;
+	}
+	utki::assert_always(thrown, SL);
+}
+}//~namespace
+
+
+
+namespace test_address_map{
+void run(){
+	// ordering
+	{
+		std::vector<setka::address> addresses = {
+			setka::address("[::1]:80"),
+			setka::address("10.0.0.2:80"),
+			setka::address("10.0.0.1:81"),
+			setka::address("10.0.0.1:80"),
+			setka::address("[2001:db8::1]:1"),
+			setka::address("9.255.255.255:65535"),
+		};
+		std::sort(addresses.begin(), addresses.end());
+
+		std::vector<setka::address> expected = {
+			setka::address("[::1]:80"),
+			setka::address("9.255.255.255:65535"),
+			setka::address("10.0.0.1:80"),
+			setka::address("10.0.0.1:81"),
+			setka::address("10.0.0.2:80"),
+			setka::address("[2001:db8::1]:1"),
+		};
+		utki::assert_always(addresses == expected, SL);
+
+		static_assert(setka::address::ip(1) < setka::address::ip(2), "");
+		static_assert(setka::address::ip(2) >= setka::address::ip(2), "");
+		static_assert(setka::address::ip(0xffffffff) < setka::address::ip(1, 0, 0, 0), "");
+		static_assert(setka::address(1, 2) != setka::address(1, 3), "");
+		static_assert(setka::address(1, 3) > setka::address(1, 2), "");
+	}
+
+	// SipHash-2-4 reference test vectors
+	{
+		setka::keyed_address_hash::key_type key = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+		std::array<uint8_t, 15> data{};
+		for(size_t i = 0; i != data.size(); ++i){
+			data[i] = uint8_t(i);
+		}
+		utki::assert_always(setka::keyed_address_hash::sip_hash(key, utki::span<const uint8_t>()) == 0x726fdb47dd0e0e31ULL, SL);
+		utki::assert_always(setka::keyed_address_hash::sip_hash(key, data) == 0xa129ca6149be45e5ULL, SL);
+
+		setka::keyed_address_hash h1;
+		setka::keyed_address_hash h2;
+		setka::address a("10.0.0.1:80");
+		utki::assert_always(h1(a) == h1(a), SL);
+		utki::assert_always(h1(a) != h2(a), SL);
+		utki::assert_always(h1(a) != h1(setka::address("10.0.0.1:81")), SL);
+		utki::assert_always(h1(a.host) != h2(a.host), SL);
+	}
+
+	// std::hash does not collide for neighbouring IPv4 addresses and ports
+	{
+		std::unordered_set<size_t> hashes;
+		for(uint32_t h = 0; h != 256; ++h){
+			for(uint16_t p = 0; p != 256; ++p){
+				hashes.insert(std::hash<setka::address>()(setka::address(0x0a000000 + h, p)));
+			}
+		}
+		utki::assert_always(hashes.size() == 256 * 256, SL);
+	}
+
+	// address_map behaves same as std::unordered_map
+	{
+		std::mt19937 rng(1);
+		auto random_address = [&](){
+			// small address space to have many repeated keys
+			if(rng() % 4 == 0){
+				return setka::address(setka::address::ip(0x20010db8, 0, 0, rng() % 1024), uint16_t(rng() % 4));
+			}
+			return setka::address(0x0a000000 + rng() % 4096, uint16_t(rng() % 4));
+		};
+
+		setka::address_map<uint32_t, setka::address, std::hash<setka::address>> map;
+		setka::address_map<uint32_t> keyed_map;
+		std::unordered_map<setka::address, uint32_t> reference;
+
+		for(uint32_t i = 0; i != 200000; ++i){
+			auto a = random_address();
+			switch(rng() % 3){
+				case 0:
+				{
+					auto res = map.try_emplace(a, i);
+					auto keyed_res = keyed_map.try_emplace(a, i);
+					auto ref_res = reference.try_emplace(a, i);
+					utki::assert_always(res.second == ref_res.second, SL);
+					utki::assert_always(keyed_res.second == ref_res.second, SL);
+					utki::assert_always(*res.first == ref_res.first->second, SL);
+					break;
+				}
+				case 1:
+				{
+					bool erased = map.erase(a);
+					utki::assert_always(keyed_map.erase(a) == erased, SL);
+					utki::assert_always((reference.erase(a) != 0) == erased, SL);
+					break;
+				}
+				default:
+				{
+					auto v = map.find(a);
+					auto ref = reference.find(a);
+					utki::assert_always((v != nullptr) == (ref != reference.end()), SL);
+					if(v){
+						utki::assert_always(*v == ref->second, SL);
+						utki::assert_always(*keyed_map.find(a) == ref->second, SL);
+						++map[a];
+						++keyed_map[a];
+						++ref->second;
+					}
+					break;
+				}
+			}
+			utki::assert_always(map.size() == reference.size(), SL);
+		}
+
+		size_t count = 0;
+		std::as_const(map).for_each([&](const setka::address& a, const uint32_t& v){
+			++count;
+			utki::assert_always(reference.at(a) == v, SL);
+		});
+		utki::assert_always(count == reference.size(), SL);
+
+		auto moved = std::move(map);
+		utki::assert_always(map.empty(), SL);
+		utki::assert_always(moved.size() == reference.size(), SL);
+		moved.clear();
+		utki::assert_always(moved.empty(), SL);
+		utki::assert_always(!moved.contains(reference.begin()->first), SL);
+	}
+
+	// values with non-trivial destructor
+	{
+		setka::address_map<std::shared_ptr<int>, setka::address::ip> map;
+		auto p = std::make_shared<int>(1);
+		for(uint32_t i = 0; i != 1000; ++i){
+			map.try_emplace(setka::address::ip(i), p);
+		}
+		utki::assert_always(p.use_count() == 1001, SL);
+		for(uint32_t i = 0; i != 1000; i += 2){
+			utki::assert_always(map.erase(setka::address::ip(i)), SL);
+		}
+		utki::assert_always(p.use_count() == 501, SL);
+		for(uint32_t i = 1; i < 1000; i += 2){
+			utki::assert_always(map.find(setka::address::ip(i)) != nullptr, SL);
+		}
+		map = setka::address_map<std::shared_ptr<int>, setka::address::ip>();
+		utki::assert_always(p.use_count() == 1, SL);
+	}
+
+	// colliding keys do not make the map grow without bound
+	{
+		// std::hash mixes the lower half of IPv6 address by multiplying it with an odd constant,
+		// so for any upper half there is a lower half giving the same hash value
+		constexpr uint64_t multiplier = 0xff51afd7ed558ccdULL;
+		uint64_t inverse = multiplier;
+		for(unsigned i = 0; i != 5; ++i){
+			inverse *= 2 - multiplier * inverse;
+		}
+		utki::assert_always(multiplier * inverse == 1, SL);
+
+		std::vector<setka::address::ip> keys;
+		for(uint64_t high = 1; high != 1001; ++high){
+			uint64_t low = high * inverse;
+			keys.emplace_back(uint32_t(high >> 32), uint32_t(high), uint32_t(low >> 32), uint32_t(low));
+		}
+		std::hash<setka::address::ip> h;
+		utki::assert_always(h(keys.front()) == h(keys.back()), SL);
+
+		setka::address_map<size_t, setka::address::ip, std::hash<setka::address::ip>> map;
+		size_t num_inserted = 0;
+		bool thrown = false;
+		for(const auto& k : keys){
+			try{
+				map.try_emplace(k, num_inserted);
+			}catch(std::runtime_error&){
+				thrown = true;
+				break;
+			}
+			++num_inserted;
+		}
+		utki::assert_always(thrown, SL);
+		utki::assert_always(map.size() == num_inserted, SL);
+		utki::assert_always(map.capacity() <= 1024, [&](auto&o){o << "capacity = " << map.capacity();}, SL);
+		for(size_t i = 0; i != num_inserted; ++i){
+			utki::assert_always(*map.find(keys[i]) == i, SL);
+		}
+		utki::assert_always(!map.contains(keys[num_inserted]), SL);
+
+		setka::address_map<size_t, setka::address::ip> keyed_map;
+		for(size_t i = 0; i != keys.size(); ++i){
+			keyed_map.try_emplace(keys[i], i);
+		}
+		utki::assert_always(keyed_map.size() == keys.size(), SL);
+	}
+
+	// lookups of random addresses give same values as std::unordered_map
+	{
+		constexpr size_t num_peers = 10000;
+		constexpr size_t num_lookups = 100000;
+
+		std::mt19937 rng(2);
+		std::vector<setka::address> peers;
+		for(size_t i = 0; i != num_peers; ++i){
+			peers.emplace_back(uint32_t(rng()), uint16_t(rng()));
+		}
+
+		auto fill = [&](auto& map){
+			for(size_t i = 0; i != peers.size(); ++i){
+				map[peers[i]] = uint32_t(i);
+			}
+		};
+
+		setka::address_map<uint32_t, setka::address, std::hash<setka::address>> map;
+		setka::address_map<uint32_t> keyed_map;
+		std::unordered_map<setka::address, uint32_t> reference;
+
+		fill(map);
+		fill(keyed_map);
+		fill(reference);
+
+		utki::assert_always(map.size() == reference.size(), SL);
+		utki::assert_always(keyed_map.size() == reference.size(), SL);
+
+		for(size_t i = 0; i != num_lookups; ++i){
+			// every other lookup is of an address which is most likely not in the map
+			auto a = i % 2 == 0 ? peers[rng() % peers.size()] : setka::address(uint32_t(rng()), uint16_t(rng()));
+			auto ref = reference.find(a);
+			auto v = map.find(a);
+			auto keyed_v = keyed_map.find(a);
+			utki::assert_always((v != nullptr) == (ref != reference.end()), SL);
+			utki::assert_always((keyed_v != nullptr) == (ref != reference.end()), SL);
+			if(v){
+				utki::assert_always(*v == ref->second, SL);
+				utki::assert_always(*keyed_v == ref->second, SL);
+			}
+		}
+	}
+}
+}//~namespace
+
+
+
+namespace test_prefix_table{
+using namespace setka::literals;
+
+static_assert("10.1.2.3/8"_subnet == setka::subnet(setka::address::ip(0x0a000000), 8), "");
+static_assert("10.1.2.3/8"_subnet.get_host() == setka::address::ip(0x0a000000), "");
+static_assert("10.0.0.0/8"_subnet.is_v4(), "");
+static_assert("10.0.0.0/8"_subnet.contains("10.255.0.1"_ip), "");
+static_assert(!"10.0.0.0/8"_subnet.contains("11.0.0.1"_ip), "");
+static_assert("0.0.0.0/0"_subnet.contains("1.2.3.4"_ip), "");
+static_assert(!"0.0.0.0/0"_subnet.contains("::1"_ip), "");
+static_assert(!"::/0"_subnet.contains("1.2.3.4"_ip), "");
+static_assert("::/0"_subnet.contains("2001:db8::1"_ip), "");
+static_assert("2001:db8::/32"_subnet.contains("2001:db8:ffff::1"_ip), "");
+static_assert(!"2001:db8::/32"_subnet.contains("2001:db9::1"_ip), "");
+static_assert("2001:db8::/32"_subnet.contains("2001:db8:1::/48"_subnet), "");
+static_assert(!"2001:db8:1::/48"_subnet.contains("2001:db8::/32"_subnet), "");
+static_assert("::ffff:10.0.0.0/104"_subnet == "10.0.0.0/8"_subnet, "");
+static_assert(!"::ffff:10.0.0.0/64"_subnet.is_v4(), "");
+static_assert("1.2.3.4"_subnet.get_prefix_length() == 32, "");
+static_assert("::1"_subnet.get_prefix_length() == 128, "");
+static_assert("10.0.0.0/8"_subnet < "10.0.0.0/16"_subnet, "");
+
+// finds longest matching subnet by checking every subnet
+uint32_t lookup_linear(const std::vector<std::pair<setka::subnet, uint32_t>>& subnets, const setka::address::ip& h){
+	int best_length = -1;
+	uint32_t ret = setka::prefix_table::no_value;
+	for(const auto& s : subnets){
+		if(s.first.contains(h) && int(s.first.get_prefix_length()) > best_length){
+			best_length = s.first.get_prefix_length();
+			ret = s.second;
+		}
+	}
+	return ret;
+}
+
+void run(){
+	// subnet parsing and formatting
+	{
+		for(std::string_view s : {"10.0.0.0/8", "0.0.0.0/0", "1.2.3.4/32", "2001:db8::/32", "::/0", "::1/128", "fe80::/10"}){
+			setka::subnet sn(s);
+			utki::assert_always(sn.to_string() == s, [&](auto&o){o << s << " -> " << sn.to_string();}, SL);
+		}
+
+		for(std::string_view s : {"10.0.0.0/33", "::/129", "10.0.0.0/1000", "::ffff:1.2.3.4/129"}){
+			setka::subnet sn;
+			auto res = setka::subnet::from_chars(s.data(), s.data() + s.size(), sn);
+			utki::assert_always(res.ec == std::errc::result_out_of_range, [&](auto&o){o << s;}, SL);
+		}
+
+		for(std::string_view s : {"", "10.0.0.0/", "10.0.0.0/x", "10.0.0/8", "10.0.0.0/8/8"}){
+			bool thrown = false;
+			try{
+				setka::subnet sn(s);
+			}catch(std::runtime_error&){
+				thrown = true;
+			}
+			utki::assert_always(thrown, [&](auto&o){o << "'" << s << "'";}, SL);
+		}
+
+		bool thrown = false;
+		try{
+			setka::subnet sn(setka::address::ip(1), 33);
+		}catch(std::invalid_argument&){
+			thrown = true;
+		}
+		utki::assert_always(thrown, SL);
+	}
+
+	// simple table
+	{
+		setka::prefix_table table;
+		utki::assert_always(table.lookup("10.0.0.1"_ip) == setka::prefix_table::no_value, SL);
+
+		table.insert("0.0.0.0/0"_subnet, 0);
+		table.insert("10.0.0.0/8"_subnet, 1);
+		table.insert("10.1.0.0/16"_subnet, 2);
+		table.insert("10.1.2.0/24"_subnet, 3);
+		table.insert("10.1.2.128/25"_subnet, 4);
+		table.insert("10.1.2.3/32"_subnet, 5);
+		table.insert("2001:db8::/32"_subnet, 6);
+		table.insert("2001:db8:0:1::/64"_subnet, 7);
+		table.insert("2001:db8:0:1::1/128"_subnet, 8);
+
+		// not visible until build
+		utki::assert_always(table.lookup("10.0.0.1"_ip) == setka::prefix_table::no_value, SL);
+		table.build();
+
+		utki::assert_always(table.size() == 9, SL);
+		utki::assert_always(table.lookup("11.0.0.1"_ip) == 0, SL);
+		utki::assert_always(table.lookup("10.0.0.1"_ip) == 1, SL);
+		utki::assert_always(table.lookup("10.1.0.1"_ip) == 2, SL);
+		utki::assert_always(table.lookup("10.1.2.1"_ip) == 3, SL);
+		utki::assert_always(table.lookup("10.1.2.200"_ip) == 4, SL);
+		utki::assert_always(table.lookup("10.1.2.3"_ip) == 5, SL);
+		utki::assert_always(table.lookup("10.1.2.2"_ip) == 3, SL);
+		utki::assert_always(table.lookup("10.1.2.4"_ip) == 3, SL);
+		utki::assert_always(table.lookup("2001:db8::1"_ip) == 6, SL);
+		utki::assert_always(table.lookup("2001:db8:0:1::2"_ip) == 7, SL);
+		utki::assert_always(table.lookup("2001:db8:0:1::1"_ip) == 8, SL);
+		utki::assert_always(table.lookup("2001:db9::1"_ip) == setka::prefix_table::no_value, SL);
+
+		utki::assert_always(table.erase("10.1.2.3/32"_subnet), SL);
+		utki::assert_always(!table.erase("10.1.2.3/32"_subnet), SL);
+		table.insert("10.0.0.0/8"_subnet, 10);
+		table.build();
+		utki::assert_always(table.lookup("10.1.2.3"_ip) == 3, SL);
+		utki::assert_always(table.lookup("10.0.0.1"_ip) == 10, SL);
+	}
+
+	// compare with linear search on random subnets
+	for(bool ip_v6 : {false, true}){
+		std::mt19937 rng(3);
+
+		auto random_ip = [&](){
+			// addresses close to each other to have many nested subnets
+			if(ip_v6){
+				return setka::address::ip(0x20010db8, rng() % 4, rng() & 0xff0000ff, rng());
+			}
+			return setka::address::ip(0x0a000000 | (rng() & 0x00ff0fff));
+		};
+
+		std::vector<std::pair<setka::subnet, uint32_t>> subnets;
+		setka::prefix_table table;
+		for(uint32_t i = 0; i != 3000; ++i){
+			auto h = random_ip();
+			auto max_length = ip_v6 ? 128 : 32;
+			setka::subnet s(h, uint8_t(rng() % (max_length + 1)));
+			auto existing = std::find_if(subnets.begin(), subnets.end(), [&](const auto& e){return e.first == s;});
+			if(existing != subnets.end()){
+				existing->second = i;
+			}else{
+				subnets.emplace_back(s, i);
+			}
+			table.insert(s, i);
+		}
+		table.build();
+
+		std::vector<setka::address::ip> hosts;
+		for(unsigned i = 0; i != 20000; ++i){
+			hosts.push_back(i % 2 == 0 ? random_ip() : subnets[rng() % subnets.size()].first.get_host());
+		}
+		// addresses of the other family do not match
+		hosts.push_back(ip_v6 ? "10.0.0.1"_ip : "2001:db8::1"_ip);
+
+		std::vector<uint32_t> values(hosts.size());
+		table.lookup(hosts, values);
+
+		for(size_t i = 0; i != hosts.size(); ++i){
+			auto expected = lookup_linear(subnets, hosts[i]);
+			utki::assert_always(table.lookup(hosts[i]) == expected, [&](auto&o){o << hosts[i].to_string();}, SL);
+			utki::assert_always(values[i] == expected, SL);
+		}
+	}
+
+	// compare with linear search on IPv4 subnets spread over the whole address space
+	{
+		std::mt19937 rng(4);
+
+		std::vector<std::pair<setka::subnet, uint32_t>> subnets;
+		setka::prefix_table table;
+		for(uint32_t i = 0; i != 4000; ++i){
+			// prefix lengths distribution similar to Internet routing table, mostly /24
+			auto r = rng() % 100;
+			uint8_t length = r < 60 ? 24 : r < 80 ? uint8_t(16 + rng() % 8) : r < 95 ? uint8_t(8 + rng() % 8) : 32;
+			setka::subnet s(setka::address::ip(uint32_t(rng())), length);
+			auto existing = std::find_if(subnets.begin(), subnets.end(), [&](const auto& e){return e.first == s;});
+			if(existing != subnets.end()){
+				existing->second = i;
+			}else{
+				subnets.emplace_back(s, i);
+			}
+			table.insert(s, i);
+		}
+		table.build();
+		utki::assert_always(table.size() == subnets.size(), SL);
+
+		std::vector<setka::address::ip> hosts;
+		for(unsigned i = 0; i != 10000; ++i){
+			if(i % 2 == 0){
+				hosts.emplace_back(uint32_t(rng()));
+			}else{
+				// random address within one of the subnets
+				const auto& s = subnets[rng() % subnets.size()].first;
+				auto host_bits = uint32_t((uint64_t(1) << (32 - s.get_prefix_length())) - 1);
+				hosts.emplace_back(s.get_host().get_v4() | (uint32_t(rng()) & host_bits));
+			}
+		}
+
+		std::vector<uint32_t> values(hosts.size());
+		table.lookup(hosts, values);
+
+		for(size_t i = 0; i != hosts.size(); ++i){
+			auto expected = lookup_linear(subnets, hosts[i]);
+			utki::assert_always(table.lookup(hosts[i]) == expected, [&](auto&o){o << hosts[i].to_string();}, SL);
+			utki::assert_always(values[i] == expected, SL);
+		}
+	}
+}
+}//~namespace
+
+
+
+namespace test_ip_list_parser{
+void run(){
+	// expected result of parsing a single item
+	auto parse_reference = [](std::string_view item){
+		setka::address::ip host;
+		auto res = setka::address::ip::from_chars(item.data(), item.data() + item.size(), host);
+		if(res.ec != std::errc() || res.ptr != item.data() + item.size()){
+			return std::make_pair(setka::address::ip(), std::errc::invalid_argument);
+		}
+		return std::make_pair(host, std::errc());
+	};
+
+	std::vector<std::string> items = {
+		"127.0.0.1",
+		"0.0.0.0",
+		"255.255.255.255",
+		"10.20.30.40",
+		"256.0.0.1",
+		"1.2.3",
+		"1.2.3.4.5",
+		"1..2.3",
+		"01.2.3.4",
+		"1.2.3.4 ",
+		" 1.2.3.4",
+		"",
+		"1234.1.1.1",
+		"::",
+		"::1",
+		"1::",
+		"2001:db8::ff00:42:8329",
+		"2001:0DB8:0000:0000:0000:ff00:0042:8329",
+		"1:2:3:4:5:6:7:8",
+		"1:2:3:4:5:6:7:8:9",
+		"1:2:3:4:5:6:7::8",
+		"1::2::3",
+		"1:2:3:4:5:6:7:",
+		":1:2:3:4:5:6:7",
+		"12345::",
+		"abcg::",
+		"::ffff:10.0.0.1",
+		"64:ff9b::192.0.2.33",
+		"::ffff:10.0.0",
+		"fe80::1%eth0",
+		"[::1]",
+		"1.2.3.4:80",
+		"2001:db8:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:1",
+		"not an address",
+	};
+
+	// all items in one text, with and without trailing delimiter
+	for(bool trailing_delimiter : {false, true}){
+		std::string text;
+		for(const auto& i : items){
+			text.append(i).push_back('\n');
+		}
+		if(!trailing_delimiter){
+			text.pop_back();
+		}
+
+		std::vector<setka::address::ip> hosts(items.size() + 1);
+		std::vector<std::errc> errors(hosts.size());
+		auto res = setka::parse_ip_list(text, '\n', hosts, errors);
+
+		utki::assert_always(res.num_items == items.size(), [&](auto&o){o << "res.num_items = " << res.num_items;}, SL);
+		utki::assert_always(res.num_consumed == text.size(), SL);
+
+		for(size_t i = 0; i != items.size(); ++i){
+			auto expected = parse_reference(items[i]);
+			utki::assert_always(hosts[i] == expected.first, [&](auto&o){o << "item = " << items[i];}, SL);
+			utki::assert_always(errors[i] == expected.second, [&](auto&o){o << "item = " << items[i];}, SL);
+		}
+	}
+
+	// resume parsing when output is full
+	{
+		std::string_view text = "1.1.1.1,2.2.2.2,bad,::4,5.5.5.5";
+		std::array<setka::address::ip, 2> hosts;
+		std::array<std::errc, 2> errors{};
+
+		auto res = setka::parse_ip_list(text, ',', hosts, errors);
+		utki::assert_always(res.num_items == 2, SL);
+		utki::assert_always(text.substr(res.num_consumed) == "bad,::4,5.5.5.5", SL);
+		utki::assert_always(hosts[1] == setka::address::ip(0x02020202), SL);
+
+		text = text.substr(res.num_consumed);
+		res = setka::parse_ip_list(text, ',', hosts, errors);
+		utki::assert_always(res.num_items == 2, SL);
+		utki::assert_always(errors[0] == std::errc::invalid_argument, SL);
+		utki::assert_always(hosts[0] == setka::address::ip(), SL);
+		utki::assert_always(errors[1] == std::errc(), SL);
+		utki::assert_always(hosts[1] == setka::address::ip(0, 0, 0, 4), SL);
+
+		text = text.substr(res.num_consumed);
+		res = setka::parse_ip_list(text, ',', hosts, errors);
+		utki::assert_always(res.num_items == 1, SL);
+		utki::assert_always(res.num_consumed == text.size(), SL);
+		utki::assert_always(hosts[0] == setka::address::ip(0x05050505), SL);
+
+		// empty text
+		res = setka::parse_ip_list(std::string_view(), ',', hosts, errors);
+		utki::assert_always(res.num_items == 0 && res.num_consumed == 0, SL);
+
+		// output spans of different size
+		bool thrown = false;
+		try{
+			setka::parse_ip_list(text, ',', hosts, utki::make_span(errors).subspan(1));
+		}catch(std::invalid_argument&){
+			thrown = true;
+		}
+		utki::assert_always(thrown, SL);
+	}
+
+	// random items, including random garbage, compared with reference parser
+	{
+		std::mt19937 rng(5);
+		const std::string_view alphabet = "0123456789abcdefABCDEFxX.:: ";
+		std::vector<std::string> random_items;
+		for(unsigned i = 0; i != 20000; ++i){
+			std::array<char, setka::address::ip::max_chars> buf{};
+			switch(rng() % 4){
+				case 0:
+				case 1:
+					{
+						setka::address::ip ip = rng() % 2 == 0 ? setka::address::ip(uint32_t(rng())) :
+								setka::address::ip(uint32_t(rng()), 0, rng() % 2 == 0 ? 0 : uint32_t(rng()), uint32_t(rng()));
+						auto res = ip.to_chars(buf.data(), buf.data() + buf.size());
+						random_items.emplace_back(buf.data(), res.ptr);
+					}
+					break;
+				default:
+					{
+						std::string s;
+						for(auto n = rng() % 50; n != 0; --n){
+							s.push_back(alphabet[rng() % alphabet.size()]);
+						}
+						random_items.push_back(std::move(s));
+					}
+					break;
+			}
+		}
+
+		std::string text;
+		for(const auto& i : random_items){
+			text.append(i).push_back(';');
+		}
+
+		std::vector<setka::address::ip> hosts(random_items.size());
+		std::vector<std::errc> errors(hosts.size());
+		auto res = setka::parse_ip_list(text, ';', hosts, errors);
+		utki::assert_always(res.num_items == random_items.size(), SL);
+
+		for(size_t i = 0; i != random_items.size(); ++i){
+			auto expected = parse_reference(random_items[i]);
+			utki::assert_always(hosts[i] == expected.first, [&](auto&o){o << "item = " << random_items[i];}, SL);
+			utki::assert_always(errors[i] == expected.second, [&](auto&o){o << "item = " << random_items[i];}, SL);
+		}
+	}
+
+	// IPv4 addresses give same results as address::ip::parse()
+	{
+		std::mt19937 rng(6);
+		constexpr size_t num_items = 10000;
+
+		std::string text;
+		for(size_t i = 0; i != num_items; ++i){
+			text.append(setka::address::ip(uint32_t(rng())).to_string()).push_back('\n');
+		}
+
+		std::vector<setka::address::ip> hosts(num_items);
+		std::vector<std::errc> errors(num_items);
+		auto res = setka::parse_ip_list(text, '\n', hosts, errors);
+		utki::assert_always(res.num_items == num_items, SL);
+		utki::assert_always(res.num_consumed == text.size(), SL);
+
+		std::vector<setka::address::ip> reference_hosts;
+		for(std::string_view t = text; !t.empty();){
+			auto end = t.find('\n');
+			reference_hosts.push_back(setka::address::ip::parse(t.substr(0, end)));
+			t = t.substr(end + 1);
+		}
+
+		utki::assert_always(hosts == reference_hosts, SL);
+		utki::assert_always(std::all_of(errors.begin(), errors.end(), [](auto e){return e == std::errc();}), SL);
+	}
+}
+}//~namespace
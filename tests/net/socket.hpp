@@ -49,3 +49,203 @@ namespace test_udp_socket_wait_for_writing{
 void run();
 
 }//~namespace
+
+
+
+namespace test_tcp_socket_close{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_tcp_socket_address_cache{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_connection_table{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_tcp_zerocopy_receive{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_multipath_tcp{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_batch{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_segmented_send{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_segmented_receive{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_connect{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_packet_info{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_multicast{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_statistics{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_receive_group{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_packet_capture_socket{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_fanout{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_udp_socket_path_mtu{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_reliable_connection{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_paced_udp_sender{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_datagram_pool{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_endpoint{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_address_chars{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_address_constexpr{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_address_map{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_prefix_table{
+
+void run();
+
+}//~namespace
+
+
+
+namespace test_ip_list_parser{
+
+void run();
+
+}//~namespace